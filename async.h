@@ -0,0 +1,25 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include "internals/async_task.h"
+
+#ifdef WINLAMB_COROUTINES
+namespace wl {
+
+// Fire-and-forget coroutine, bound to the window it's a member of.
+using async_task = _wli::async_task;
+
+// Handle to the UI thread of a window, which can outlive the window itself.
+using ui_context = _wli::ui_context;
+
+using _wli::resume_background;
+using _wli::resume_ui;
+using _wli::run_background;
+
+}//namespace wl
+#endif
@@ -6,9 +6,13 @@
  */
 
 #pragma once
+#include <memory>
+#include <string_view>
 #include "internals/base_native_ctrl_pubm.h"
+#include "internals/search_index.h"
 #include "internals/styler.h"
 #include "str.h"
+#include "subclass.h"
 #include "wnd.h"
 
 namespace wl {
@@ -24,13 +28,26 @@ public:
 private:
 	HWND                   _hWnd = nullptr;
 	_wli::base_native_ctrl _baseNativeCtrl{_hWnd};
+	subclass               _subclass; // installed only for the search index
+	std::unique_ptr<_wli::search_index> _pSearchIndex;
 
 public:
 	// Wraps window style changes done by Get/SetWindowLongPtr.
 	_wli::styler<combobox> style{this};
 
-	combobox() noexcept :
-		wnd(_hWnd), base_native_ctrl_pubm(_baseNativeCtrl) { }
+	combobox() :
+		wnd(_hWnd), base_native_ctrl_pubm(_baseNativeCtrl)
+	{
+		this->_subclass.on_message({CB_ADDSTRING, CB_INSERTSTRING, CB_DELETESTRING,
+			CB_RESETCONTENT},
+			[this](params p) -> LRESULT
+		{
+			if (!this->_pSearchIndex) { // no search index, nothing to keep in sync
+				return DefSubclassProc(this->_hWnd, p.message, p.wParam, p.lParam);
+			}
+			return this->_process_search_index_msg(p);
+		});
+	}
 
 	combobox(combobox&&) = default;
 	combobox& operator=(combobox&&) = default; // movable only
@@ -82,12 +99,20 @@ public:
 
 	std::wstring get_text(size_t index) const {
 		std::wstring buf;
-		size_t len = SendMessageW(this->_hWnd, CB_GETLBTEXTLEN, index, 0);
-		if (len) {
-			buf.resize(len, L'\0');
-			SendMessageW(this->_hWnd, CB_GETLBTEXT, index, reinterpret_cast<LPARAM>(&buf[0]));
-			buf.resize(len);
+		this->get_text(index, buf);
+		return buf;
+	}
+
+	// Retrieves the text into the given buffer, reusing its memory, and returns a view to it.
+	std::wstring_view get_text(size_t index, std::wstring& buf) const {
+		LRESULT len = SendMessageW(this->_hWnd, CB_GETLBTEXTLEN, index, 0);
+		if (len <= 0) { // empty or CB_ERR
+			buf.clear();
+			return buf;
 		}
+		buf.resize(len + 1, L'\0'); // room for terminating null
+		SendMessageW(this->_hWnd, CB_GETLBTEXT, index, reinterpret_cast<LPARAM>(&buf[0]));
+		buf.resize(len);
 		return buf;
 	}
 
@@ -99,6 +124,79 @@ public:
 		SendMessageW(this->_hWnd, CB_SETCURSEL, index, 0);
 		return *this;
 	}
+
+	// Keeps an index of the entries, so searches are case- and diacritic-insensitive and
+	// don't query the control. It's kept in sync as entries are added or removed.
+	// CB_FINDSTRING and CB_FINDSTRINGEXACT are not affected, and keep the native
+	// matching, which ignores case only. The combobox must have been created.
+	combobox& enable_search_index(bool enable = true) {
+		if (!enable) {
+			this->_pSearchIndex.reset();
+			return *this;
+		}
+
+		DWORD styles = static_cast<DWORD>(GetWindowLongPtrW(this->_hWnd, GWL_STYLE));
+		if ((styles & (CBS_OWNERDRAWFIXED | CBS_OWNERDRAWVARIABLE)) && !(styles & CBS_HASSTRINGS)) {
+			throw std::logic_error("Owner-drawn combobox without strings can't be indexed.");
+		}
+		if (!this->_subclass.hwnd()) {
+			this->_subclass.install_subclass(*this);
+		}
+
+		if (!this->_pSearchIndex) {
+			this->_pSearchIndex.reset(new _wli::search_index);
+			size_t numEntries = this->count();
+			this->_pSearchIndex->reserve(numEntries);
+			for (size_t i = 0; i < numEntries; ++i) {
+				this->_pSearchIndex->push_back(this->get_text(i));
+			}
+		}
+		return *this;
+	}
+
+	// Returns the index of the first entry, starting at the given one, which begins
+	// with the given text, or -1 if none is found. Requires the search index.
+	size_t find_prefix(const wchar_t* prefix, size_t startIndex = 0) const {
+		return this->_search_index().find_prefix(prefix, startIndex);
+	}
+
+	// Returns the index of the first entry, starting at the given one, which is the
+	// given text, or -1 if none is found. Requires the search index.
+	size_t find_exact(const wchar_t* text, size_t startIndex = 0) const {
+		return this->_search_index().find(text, false, startIndex);
+	}
+
+	// Returns the indexes of all entries which contain the given text. Requires the search index.
+	std::vector<size_t> find_substring(const wchar_t* text) const {
+		return this->_search_index().find_substring(text);
+	}
+
+private:
+	const _wli::search_index& _search_index() const {
+		if (!this->_pSearchIndex) {
+			throw std::logic_error("Search index is not enabled.");
+		}
+		return *this->_pSearchIndex;
+	}
+
+	LRESULT _process_search_index_msg(params p) {
+		LRESULT ret = DefSubclassProc(this->_hWnd, p.message, p.wParam, p.lParam);
+		switch (p.message) {
+		case CB_ADDSTRING:
+		case CB_INSERTSTRING:
+			if (ret >= 0) { // not CB_ERR or CB_ERRSPACE
+				this->_pSearchIndex->insert(static_cast<size_t>(ret),
+					reinterpret_cast<const wchar_t*>(p.lParam));
+			}
+			break;
+		case CB_DELETESTRING:
+			if (ret != CB_ERR) this->_pSearchIndex->erase(p.wParam);
+			break;
+		case CB_RESETCONTENT:
+			this->_pSearchIndex->clear();
+		}
+		return ret;
+	}
 };
 
 }//namespace wl
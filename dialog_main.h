@@ -7,7 +7,7 @@
 
 #pragma once
 #include "internals/base_dialog.h"
-#include "internals/base_loop.h"
+#include "internals/base_loop_pubm.h"
 #include "internals/base_msg_pubm.h"
 #include "internals/base_text_pubm.h"
 #include "internals/base_thread_pubm.h"
@@ -16,16 +16,17 @@
 #include "wnd.h"
 
 namespace wl {
-namespace _wli { class dialog_modeless; } // friend forward declaration
+class dialog_modeless; // friend forward declaration
 
 // Inherit from this class to have a dialog as the main window for your application.
 class dialog_main :
 	public wnd,
 	public _wli::base_msg_pubm<INT_PTR>,
 	public _wli::base_thread_pubm<INT_PTR, TRUE>,
+	public _wli::base_loop_pubm,
 	public _wli::base_text_pubm<dialog_main>
 {
-	friend _wli::dialog_modeless; // needs to access _baseLoop
+	friend dialog_modeless; // needs to access _baseLoop
 
 protected:
 	// Variables to be set by user, used only during window creation.
@@ -50,7 +51,8 @@ public:
 
 protected:
 	dialog_main() :
-		wnd(_hWnd), base_msg_pubm(_baseMsg), base_thread_pubm(_baseThread), base_text_pubm(_hWnd)
+		wnd(_hWnd), base_msg_pubm(_baseMsg), base_thread_pubm(_baseThread), base_loop_pubm(_baseLoop),
+		base_text_pubm(_hWnd)
 	{
 		this->base_msg_pubm::on_message(WM_CLOSE, [this](params) noexcept -> INT_PTR {
 			DestroyWindow(this->_hWnd);
@@ -65,7 +65,7 @@ public:
 				"CreateDialogParam failed for modeless dialog");
 		}
 
-		this->_pParentBaseLoop = parent->_baseLoop; // parent must have us as friend
+		this->_pParentBaseLoop = &parent->_baseLoop; // parent must have us as friend
 		this->_pParentBaseLoop->add_modeless(this->_hWnd);
 		ShowWindow(this->_hWnd, SW_SHOW);
 	}
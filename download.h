@@ -7,6 +7,7 @@
 
 #pragma once
 #include <functional>
+#include "internals/async_task.h"
 #include "internals/download_session.h"
 #include "internals/download_url.h"
 #include "insert_order_map.h"
@@ -106,11 +107,39 @@ public:
 		return this->abort(); // cleanup
 	}
 
+#ifdef WINLAMB_COROUTINES
+	// Awaitable which runs start() in a thread from the pool, resuming in the UI thread.
+	// Note that on_start() and on_progress() callbacks will run in the pool thread.
+	auto start_async() {
+		return _wli::run_background([this]() -> void {
+			this->start();
+		});
+	}
+#endif
+
 	const insert_order_map<std::wstring, std::wstring>& get_request_headers() const noexcept  { return this->_requestHeaders; }
 	const insert_order_map<std::wstring, std::wstring>& get_response_headers() const noexcept { return this->_responseHeaders; }
 	size_t get_content_length() const noexcept   { return this->_contentLength; }
 	size_t get_total_downloaded() const noexcept { return this->_totalGot; }
 
+	// Decodes the received data to a string, using the charset informed by the server,
+	// if any and if there's no BOM; otherwise the encoding is guessed.
+	std::wstring get_data_as_string() const {
+		if (this->data.empty()) return {};
+		str::encoding_info enc = str::get_encoding(this->data);
+		const std::wstring* contType = this->_responseHeaders.get_if_exists(L"Content-Type");
+		if (!enc.bomSize && contType) {
+			if (str::findi(*contType, L"charset=utf-8") != std::wstring::npos) {
+				enc.encType = str::encoding::UTF8;
+			} else if (str::findi(*contType, L"charset=iso-8859-1") != std::wstring::npos ||
+				str::findi(*contType, L"charset=windows-1252") != std::wstring::npos)
+			{
+				enc.encType = str::encoding::WIN1252; // superset of ISO-8859-1
+			}
+		}
+		return str::to_wstring(&this->data[0] + enc.bomSize, this->data.size() - enc.bomSize, enc.encType);
+	}
+
 	// If server informed content length, returns a value between 0 and 100.
 	float get_percent() const noexcept {
 		return this->_contentLength ?
@@ -147,15 +176,20 @@ private:
 	}
 
 	void _contact_server() {
-		// Add the request headers to request handle.
-		std::wstring rhTmp;
-		rhTmp.reserve(20);
-		for (const insert_order_map<std::wstring, std::wstring>::entry& rh : this->_requestHeaders) {
-			rhTmp = rh.key;
-			rhTmp += L": ";
-			rhTmp += rh.value;
-
-			if (!WinHttpAddRequestHeaders(this->_hRequest, rhTmp.c_str(), static_cast<ULONG>(-1L), WINHTTP_ADDREQ_FLAG_ADD)) {
+		// Add the request headers to request handle, all at once, separated by CRLF.
+		if (!this->_requestHeaders.empty()) {
+			size_t rhLen = 0;
+			for (const insert_order_map<std::wstring, std::wstring>::entry& entry : this->_requestHeaders) {
+				rhLen += entry.key.length() + entry.value.length() + 4; // key: value\r\n
+			}
+
+			str::builder rh(rhLen);
+			for (const insert_order_map<std::wstring, std::wstring>::entry& entry : this->_requestHeaders) {
+				rh.append(entry.key).append(L": ").append(entry.value).append(L"\r\n");
+			}
+			std::wstring rhAll = rh.str();
+
+			if (!WinHttpAddRequestHeaders(this->_hRequest, rhAll.c_str(), static_cast<ULONG>(rhAll.length()), WINHTTP_ADDREQ_FLAG_ADD)) {
 				this->_abort_and_throw(GetLastError(), "WinHttpAddRequestHeaders failed");
 			}
 		}
@@ -187,26 +221,25 @@ private:
 
 		// Parse the raw response headers into an associative array.
 		this->_responseHeaders.clear();
-		std::vector<std::wstring> lines = str::split_lines(rawReh);
+		str::trim_nulls(rawReh);
 
-		for (const std::wstring& line : lines) {
+		for (std::wstring_view line : str::split_lines_view(rawReh)) { // lines aren't copied
 			if (line.empty()) {
 				continue;
 			}
-			size_t colonIdx = line.find_first_of(L':');
-			if (colonIdx == std::wstring::npos) { // not a key/value pair, probably response line
+			size_t colonIdx = line.find(L':');
+			if (colonIdx == std::wstring_view::npos) { // not a key/value pair, probably response line
 				this->_responseHeaders[L""] = line; // empty key
 			} else {
-				std::wstring kk = line.substr(0, colonIdx);
-				std::wstring vv = line.substr(colonIdx + 1, line.length() - (colonIdx + 1));
-				this->_responseHeaders[str::trim(kk)] = str::trim(vv);
+				this->_responseHeaders[std::wstring{str::trim_view(line.substr(0, colonIdx))}] =
+					str::trim_view(line.substr(colonIdx + 1));
 			}
 		}
 
 		// Retrieve content length, if informed by server.
 		const std::wstring* contLen = this->_responseHeaders.get_if_exists(L"Content-Length");
-		if (contLen && str::is_uint(*contLen)) { // yes, server informed content length
-			this->_contentLength = std::stoul(*contLen);
+		if (contLen) { // yes, server informed content length
+			str::parse_int(*contLen, this->_contentLength); // stays zero if invalid
 		}
 	}
 
@@ -6,10 +6,18 @@
  */
 
 #pragma once
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <system_error>
 #include <vector>
 #include "datetime.h"
+#include "internals/async_task.h"
+#include "internals/dir_walker.h"
+#include "internals/file_aio.h"
+#include "internals/file_atomic.h"
+#include "internals/file_metadata_cache.h"
+#include "internals/file_write_behind.h"
 #include <Shellapi.h>
 
 namespace wl {
@@ -20,6 +28,10 @@ public:
 	// File access type.
 	enum class access { READONLY, READWRITE };
 
+	// How the file does I/O. ASYNC opens it with FILE_FLAG_OVERLAPPED, so asynchronous
+	// requests really run at once; they can't be made on a SYNC file.
+	enum class io { SYNC, ASYNC };
+
 	// Date information of a file.
 	struct dates final {
 		datetime creation;
@@ -27,10 +39,28 @@ public:
 		datetime lastWrite;
 	};
 
+	// Outcome of an asynchronous read or write.
+	using async_result = _wli::file_aio::result;
+
+	// A file or directory found by util::walk_dir(), with size, attributes and dates.
+	using dir_entry = _wli::dir_entry;
+
+	// Thread-safe cache of file metadata, invalidated by the caller or by age.
+	using metadata_cache = _wli::file_metadata_cache;
+
+	// How much of an atomic write survives a power loss.
+	using durability = _wli::file_atomic_backend::durability;
+
 private:
-	HANDLE _hFile = nullptr;
-	access _access = access::READONLY;
-	size_t _sz = -1;
+	// Sequential reads and writes are split in calls of this size, so the DWORD count never overflows.
+	static constexpr size_t _MAX_IO_CHUNK = 0x40000000;
+
+	HANDLE   _hFile = nullptr;
+	access   _access = access::READONLY;
+	io       _io = io::SYNC;
+	size_t   _sz = -1;
+	uint64_t _pos = 0; // of sequential reads and writes on an ASYNC file, whose handle has no file pointer
+	std::unique_ptr<_wli::file_aio> _aio; // created at the first asynchronous request
 
 public:
 	~file() {
@@ -44,11 +74,15 @@ public:
 		this->close();
 		std::swap(this->_hFile, other._hFile);
 		std::swap(this->_access, other._access);
+		std::swap(this->_io, other._io);
 		std::swap(this->_sz, other._sz);
+		std::swap(this->_pos, other._pos);
+		std::swap(this->_aio, other._aio);
 		return *this;
 	}
 
-	// Returns the handle to the file.
+	// Returns the handle to the file. If opened with io::ASYNC, it has FILE_FLAG_OVERLAPPED,
+	// so direct ReadFile and WriteFile calls must pass an OVERLAPPED with the offset.
 	HANDLE hfile() const noexcept {
 		return this->_hFile;
 	}
@@ -58,13 +92,21 @@ public:
 		return this->_access;
 	}
 
-	// Closes the file, wrapper to CloseHandle.
+	// Tells if the file was opened for synchronous or asynchronous I/O.
+	io io_type() const noexcept {
+		return this->_io;
+	}
+
+	// Closes the file, wrapper to CloseHandle; waits for any asynchronous requests in flight.
 	file& close() noexcept {
 		if (this->_hFile) {
+			this->_aio.reset(); // its destructor waits
 			CloseHandle(this->_hFile);
 			this->_hFile = nullptr;
 			this->_access = access::READONLY;
+			this->_io = io::SYNC;
 			this->_sz = -1; // http://stackoverflow.com/a/19483690
+			this->_pos = 0;
 		}
 		return *this;
 	}
@@ -72,14 +114,17 @@ public:
 	// Retrieve the file size in bytes.
 	size_t size() noexcept {
 		if (this->_sz == -1) {
-			this->_sz = GetFileSize(this->_hFile, nullptr); // cache
+			LARGE_INTEGER sz{};
+			if (GetFileSizeEx(this->_hFile, &sz)) {
+				this->_sz = static_cast<size_t>(sz.QuadPart); // cache
+			}
 		}
 		return this->_sz;
 	}
 
 private:
 	file& _raw_open(const std::wstring& filePath, DWORD desiredAccess,
-		DWORD shareMode, DWORD creationDisposition)
+		DWORD shareMode, DWORD creationDisposition, io ioType)
 	{
 		if (filePath.empty()) {
 			throw std::invalid_argument("No file path specified.");
@@ -88,8 +133,10 @@ private:
 		this->close();
 		bool isReadWrite = (desiredAccess & GENERIC_WRITE) != 0;
 
-		this->_hFile = CreateFileW(filePath.c_str(), desiredAccess, shareMode,
-			nullptr, creationDisposition, 0, nullptr);
+		// A second handle for asynchronous requests could not be opened, since read-write
+		// files are not shared, so on an ASYNC file all reads and writes are positional.
+		this->_hFile = CreateFileW(filePath.c_str(), desiredAccess, shareMode, nullptr,
+			creationDisposition, ioType == io::ASYNC ? FILE_FLAG_OVERLAPPED : 0, nullptr);
 		if (this->_hFile == INVALID_HANDLE_VALUE) {
 			this->_hFile = nullptr;
 			throw std::system_error(GetLastError(), std::system_category(),
@@ -100,34 +147,35 @@ private:
 
 		this->_access = isReadWrite ?
 			access::READWRITE : access::READONLY; // keep for future checks
+		this->_io = ioType;
 		return *this;
 	}
 
 public:
 	// Opens a file, throwing an exception if it doesn't exist.
-	file& open_existing(const wchar_t* filePath, access accessType) {
+	file& open_existing(const wchar_t* filePath, access accessType, io ioType = io::SYNC) {
 		if (!util::exists(filePath)) {
 			throw std::invalid_argument("File doesn't exist.");
 		}
 		return this->_raw_open(filePath,
 			GENERIC_READ | (accessType == access::READWRITE ? GENERIC_WRITE : 0),
 			(accessType == access::READWRITE) ? 0 : FILE_SHARE_READ,
-			OPEN_EXISTING); // fails if file doesn't exist
+			OPEN_EXISTING, ioType); // fails if file doesn't exist
 	}
 
 	// Opens a file, throwing an exception if it doesn't exist.
-	file& open_existing(const std::wstring& filePath, access accessType) {
-		return this->open_existing(filePath.c_str(), accessType);
+	file& open_existing(const std::wstring& filePath, access accessType, io ioType = io::SYNC) {
+		return this->open_existing(filePath.c_str(), accessType, ioType);
 	}
 
 	// Opens a file as read/write, creates if it doesn't exist.
-	file& open_or_create(const wchar_t* filePath) {
-		return this->_raw_open(filePath, GENERIC_READ | GENERIC_WRITE, 0, OPEN_ALWAYS);
+	file& open_or_create(const wchar_t* filePath, io ioType = io::SYNC) {
+		return this->_raw_open(filePath, GENERIC_READ | GENERIC_WRITE, 0, OPEN_ALWAYS, ioType);
 	}
 
 	// Opens a file as read/write, creates if it doesn't exist.
-	file& open_or_create(const std::wstring& filePath) {
-		return this->open_or_create(filePath.c_str());
+	file& open_or_create(const std::wstring& filePath, io ioType = io::SYNC) {
+		return this->open_or_create(filePath.c_str(), ioType);
 	}
 
 private:
@@ -143,6 +191,12 @@ private:
 		}
 	}
 
+	void _check_file_async() const {
+		if (this->_io == io::SYNC) {
+			throw std::logic_error("File was not opened for asynchronous I/O.");
+		}
+	}
+
 public:
 	// Truncates or expands the file, according to the new size; zero will empty the file.
 	file& set_new_size(size_t numBytes) {
@@ -155,20 +209,21 @@ public:
 			throw std::system_error(err, std::system_category(), msg);
 		};
 
-		DWORD r = SetFilePointer(this->_hFile, static_cast<LONG>(numBytes), nullptr, FILE_BEGIN);
-		if (r == INVALID_SET_FILE_POINTER) {
-			tooBad(GetLastError(), "SetFilePointer failed when setting new file size");
+		LARGE_INTEGER newSize{};
+		newSize.QuadPart = static_cast<LONGLONG>(numBytes);
+		if (!SetFilePointerEx(this->_hFile, newSize, nullptr, FILE_BEGIN)) {
+			tooBad(GetLastError(), "SetFilePointerEx failed when setting new file size");
 		}
 
 		if (!SetEndOfFile(this->_hFile)) {
 			tooBad(GetLastError(), "SetEndOfFile failed when setting new file size");
 		}
 
-		r = SetFilePointer(this->_hFile, 0, nullptr, FILE_BEGIN); // rewind
-		if (r == INVALID_SET_FILE_POINTER) {
+		if (SetFilePointer(this->_hFile, 0, nullptr, FILE_BEGIN) == INVALID_SET_FILE_POINTER) { // rewind
 			tooBad(GetLastError(), "SetFilePointer failed to rewind the file pointer when setting new file size");
 		}
 
+		this->_pos = 0;
 		this->_sz = numBytes; // update
 		return *this;
 	}
@@ -180,6 +235,7 @@ public:
 			throw std::system_error(GetLastError(), std::system_category(),
 				"SetFilePointer failed to rewind the file");
 		}
+		this->_pos = 0;
 		return *this;
 	}
 
@@ -187,11 +243,29 @@ public:
 	file& read_to_buffer(std::vector<BYTE>& buf) {
 		this->_check_file_opened();
 		buf.resize(this->size());
-		DWORD bytesRead = 0;
-		if (!ReadFile(this->_hFile, &buf[0], static_cast<DWORD>(buf.size()), &bytesRead, nullptr)) {
-			throw std::system_error(GetLastError(), std::system_category(),
-				"ReadFile failed");
+
+		size_t totRead = 0; // less than the size if the file was truncated meanwhile
+		if (this->_io == io::ASYNC) {
+			std::error_code err = _wli::file_aio_backend::read_at(this->_hFile, this->_pos,
+				buf.data(), buf.size(), totRead);
+			if (err) {
+				throw std::system_error(err, "ReadFile failed");
+			}
+			this->_pos += totRead;
+		} else {
+			while (totRead < buf.size()) {
+				DWORD bytesRead = 0;
+				if (!ReadFile(this->_hFile, &buf[totRead],
+					static_cast<DWORD>(std::min(buf.size() - totRead, _MAX_IO_CHUNK)), &bytesRead, nullptr))
+				{
+					throw std::system_error(GetLastError(), std::system_category(),
+						"ReadFile failed");
+				}
+				if (!bytesRead) break; // file was truncated meanwhile
+				totRead += bytesRead;
+			}
 		}
+		buf.resize(totRead);
 		return *this;
 	}
 
@@ -209,11 +283,27 @@ public:
 
 		// File boundary will be expanded if needed.
 		// Internal file pointer will move forward.
-		DWORD dwWritten = 0;
-		if (!WriteFile(this->_hFile, pData, static_cast<DWORD>(sz), &dwWritten, nullptr)) {
-			throw std::system_error(GetLastError(), std::system_category(),
-				"WriteFile failed");
+		size_t totWritten = 0;
+		if (this->_io == io::ASYNC) {
+			std::error_code err = _wli::file_aio_backend::write_at(this->_hFile, this->_pos,
+				pData, sz, totWritten);
+			this->_pos += totWritten;
+			if (err) {
+				throw std::system_error(err, "WriteFile failed");
+			}
+		} else {
+			while (totWritten < sz) {
+				DWORD dwWritten = 0;
+				if (!WriteFile(this->_hFile, pData + totWritten,
+					static_cast<DWORD>(std::min(sz - totWritten, _MAX_IO_CHUNK)), &dwWritten, nullptr))
+				{
+					throw std::system_error(GetLastError(), std::system_category(),
+						"WriteFile failed");
+				}
+				totWritten += dwWritten;
+			}
 		}
+		this->_sz = -1; // file may have grown
 		return *this;
 	}
 
@@ -222,6 +312,64 @@ public:
 		return this->write(&data[0], data.size());
 	}
 
+	// Reads sz bytes at the given offset, without blocking; the file must have been opened
+	// with io::ASYNC. Many requests can be in flight at once, and big ones run in parallel chunks. The buffer must stay valid
+	// until onDone is called in the UI thread; if the window is gone, it's not called.
+	file& read_async(uint64_t offset, BYTE* pDest, size_t sz,
+		const _wli::ui_context& ctx, _wli::callable<void(async_result)> onDone)
+	{
+		this->_async_engine().read(offset, pDest, sz, ctx, std::move(onDone));
+		return *this;
+	}
+
+	// Reads sz bytes at the given offset, without blocking. The buffer must stay valid
+	// until onDone is called, in a thread from the pool.
+	file& read_async(uint64_t offset, BYTE* pDest, size_t sz, _wli::callable<void(async_result)> onDone) {
+		this->_async_engine().read(offset, pDest, sz, std::move(onDone));
+		return *this;
+	}
+
+	// Writes sz bytes at the given offset, expanding the file if needed, without
+	// blocking. The buffer must stay valid until onDone is called in the UI thread; if
+	// the window is gone, it's not called.
+	file& write_async(uint64_t offset, const BYTE* pSrc, size_t sz,
+		const _wli::ui_context& ctx, _wli::callable<void(async_result)> onDone)
+	{
+		this->_check_file_read_only();
+		this->_sz = -1; // file may grow
+		this->_async_engine().write(offset, pSrc, sz, ctx, std::move(onDone));
+		return *this;
+	}
+
+	// Writes sz bytes at the given offset, expanding the file if needed, without
+	// blocking. The buffer must stay valid until onDone is called, in a thread from the pool.
+	file& write_async(uint64_t offset, const BYTE* pSrc, size_t sz, _wli::callable<void(async_result)> onDone) {
+		this->_check_file_read_only();
+		this->_sz = -1;
+		this->_async_engine().write(offset, pSrc, sz, std::move(onDone));
+		return *this;
+	}
+
+	// Number of asynchronous requests not yet completed.
+	size_t async_in_flight() const noexcept {
+		return this->_aio ? this->_aio->in_flight() : 0;
+	}
+
+	// Blocks until all asynchronous requests are completed; must not be called from a completion callback.
+	file& wait_async() noexcept {
+		if (this->_aio) this->_aio->wait();
+		return *this;
+	}
+
+private:
+	_wli::file_aio& _async_engine() {
+		this->_check_file_opened();
+		this->_check_file_async();
+		if (!this->_aio) this->_aio.reset(new _wli::file_aio(this->_hFile));
+		return *this->_aio;
+	}
+
+public:
 	// Gets creation, last access and last write dates, wrapper to GetFileTime.
 	dates get_dates() const {
 		this->_check_file_opened();
@@ -264,6 +412,15 @@ public:
 			return read(filePath.c_str());
 		}
 
+#ifdef WINLAMB_COROUTINES
+		// Awaitable which retrieves all file content in a thread from the pool, resuming in the UI thread.
+		static auto read_async(std::wstring filePath) {
+			return _wli::run_background([filePath = std::move(filePath)]() -> std::vector<BYTE> {
+				return read(filePath);
+			});
+		}
+#endif
+
 		// Writes all content to file at once.
 		static void write(const wchar_t* filePath, const BYTE* pData, size_t sz) {
 			file fout;
@@ -287,11 +444,63 @@ public:
 			write(filePath.c_str(), &data[0], data.size());
 		}
 
+		// Replaces the file content at once, through a temporary file which is renamed
+		// over it, so a crash leaves either the old content or the new one.
+		static void write_atomic(const std::wstring& filePath, const BYTE* pData, size_t sz,
+			durability dur = durability::DATA)
+		{
+			std::error_code err = _wli::file_atomic_backend::write(filePath, pData, sz, dur);
+			if (err) {
+				throw std::system_error(err, "Failed to atomically write file");
+			}
+		}
+
+		// Replaces the file content at once, through a temporary file which is renamed
+		// over it, so a crash leaves either the old content or the new one.
+		static void write_atomic(const std::wstring& filePath, const std::vector<BYTE>& data,
+			durability dur = durability::DATA)
+		{
+			write_atomic(filePath, data.data(), data.size(), dur);
+		}
+
+		// Queues an atomic write, run in a background thread after a short delay;
+		// further writes of the same path in the meantime replace it. Queued writes are
+		// done before the program exits; flush_writes() waits for them.
+		static void write_behind(const std::wstring& filePath, std::vector<BYTE> data,
+			durability dur = durability::DATA)
+		{
+			_wli::file_write_behind::instance().write(filePath, std::move(data), dur);
+		}
+
+		// Blocks until all writes queued by write_behind() are done, throwing the first
+		// error which happened since the last call, if any.
+		static void flush_writes() {
+			_wli::file_write_behind::instance().flush();
+		}
+
+		// Retrieves size, attributes and dates at once, without opening the file.
+		static dir_entry get_entry(const std::wstring& fileOrFolder) {
+			dir_entry entry;
+			std::error_code err = _wli::dir_scan_backend::stat(fileOrFolder, entry);
+			if (err.value() == ERROR_FILE_NOT_FOUND || err.value() == ERROR_PATH_NOT_FOUND) {
+				throw std::invalid_argument("File doesn't exist.");
+			} else if (err) {
+				throw std::system_error(err, "GetFileAttributesEx failed");
+			}
+			return entry;
+		}
+
+		// Converts the dates of an entry.
+		static dates get_dates(const dir_entry& entry) noexcept {
+			auto toFt = [](uint64_t ticks) noexcept -> FILETIME {
+				return {static_cast<DWORD>(ticks & 0xFFFF'FFFF), static_cast<DWORD>(ticks >> 32)};
+			};
+			return {toFt(entry.creation), toFt(entry.lastAccess), toFt(entry.lastWrite)};
+		}
+
 		// Retrieves the file size in bytes.
 		static size_t get_size(const wchar_t* filePath) {
-			file ff;
-			ff.open_existing(filePath, file::access::READONLY);
-			return ff.size();
+			return static_cast<size_t>(get_entry(filePath).size);
 		}
 
 		// Retrieves the file size in bytes.
@@ -301,9 +510,7 @@ public:
 
 		// Gets creation, last access and last write dates.
 		static dates get_dates(const wchar_t* filePath) {
-			file ff;
-			ff.open_existing(filePath, file::access::READONLY);
-			return ff.get_dates();
+			return get_dates(get_entry(filePath));
 		}
 
 		// Gets creation, last access and last write dates.
@@ -382,8 +589,9 @@ public:
 		static std::vector<std::wstring> list_dir(const std::wstring& pathAndPattern) {
 			std::vector<std::wstring> files;
 
-			WIN32_FIND_DATA wfd{};
-			HANDLE hFind = FindFirstFileW(pathAndPattern.c_str(), &wfd);
+			WIN32_FIND_DATAW wfd{};
+			HANDLE hFind = FindFirstFileExW(pathAndPattern.c_str(), FindExInfoBasic, &wfd,
+				FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
 			if (hFind == INVALID_HANDLE_VALUE) {
 				DWORD err = GetLastError();
 				if (err == ERROR_FILE_NOT_FOUND) {
@@ -401,8 +609,10 @@ public:
 					&& lstrcmpiW(wfd.cFileName, L".") // do not add current and parent paths
 					&& lstrcmpiW(wfd.cFileName, L".."))
 				{
-					files.emplace_back(pathPat);
-					files.back().append(L"\\").append(wfd.cFileName);
+					size_t nameLen = lstrlenW(wfd.cFileName);
+					files.emplace_back();
+					files.back().reserve(pathPat.size() + 1 + nameLen);
+					files.back().append(pathPat).append(1, L'\\').append(wfd.cFileName, nameLen);
 				}
 			} while (FindNextFileW(hFind, &wfd));
 
@@ -417,6 +627,22 @@ public:
 			pathAndPattern.append(pattern);
 			return list_dir(pathAndPattern);
 		}
+
+		// Lists all files and directories under the directory, recursively, in no
+		// particular order. Subdirectories are scanned in parallel, and size, attributes
+		// and dates come from the listing itself. Subdirectories which can't be read are
+		// skipped; symbolic links and junctions aren't followed.
+		static std::vector<dir_entry> walk_dir(const std::wstring& dirPath) {
+			return _wli::dir_walker::walk(dirPath, [](const dir_entry&) noexcept -> bool { return true; });
+		}
+
+		// Lists files and directories under the directory, recursively, in no particular
+		// order. If filter(const dir_entry&) returns false, the entry is left out and, if
+		// a directory, not descended into; it's called from many threads at once.
+		template<typename filterT>
+		static std::vector<dir_entry> walk_dir(const std::wstring& dirPath, filterT&& filter) {
+			return _wli::dir_walker::walk(dirPath, std::forward<filterT>(filter));
+		}
 	};
 };
 
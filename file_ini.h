@@ -9,12 +9,19 @@
 #include "file_mapped.h"
 #include "insert_order_map.h"
 #include "str.h"
+#include "internals/ini_parser.h"
 
 namespace wl {
 
 // Wrapper to INI file.
 class file_ini final {
 public:
+	// INI contents packed in a single arena, with hashed lookup of sections and keys,
+	// and the line numbers of malformed lines; see load_document().
+	using document = _wli::ini_document;
+
+	// Sections and keys in file order. Lookups here are linear, which is fine for usual
+	// settings files; for many thousands of keys, load_document() has hashed ones.
 	insert_order_map<std::wstring, insert_order_map<std::wstring, std::wstring>> sections;
 
 	const insert_order_map<std::wstring, std::wstring>& operator[](const std::wstring& sectionName) const {
@@ -25,64 +32,40 @@ public:
 		return this->sections.operator[](sectionName);
 	}
 
-	file_ini& load_from_file(const wchar_t* filePath) {
-		std::wstring content = str::to_wstring(file_mapped::util::read(filePath));
-		std::vector<std::wstring> lines = str::split_lines(content);
-		insert_order_map<std::wstring, std::wstring>* curSection = nullptr; // section-less keys will be ignored
-		std::wstring tmpName, tmpValue; // temporary buffers
-
-		for (std::wstring& line : lines) {
-			if (str::trim(line).empty()) { // skip blank lines
-				continue;
-			} else if (line[0] == L'[' && line.back() == L']') { // begin of section found
-				tmpName.clear();
-				tmpName.insert(0, &line[1], line.length() - 2); // extract section name
-				curSection = &this->sections[str::trim(tmpName)]; // if inexistent, will be inserted
-			} else if (curSection && line[0] != L';' && line[0] != L'#') { // lines starting with ; or # will be ignored
-				size_t idxEq = line.find_first_of(L'=');
-				if (idxEq != std::wstring::npos) {
-					tmpName.clear();
-					tmpName.insert(0, &line[0], idxEq); // extract key name
-					tmpValue.clear();
-					tmpValue.insert(0, &line[idxEq + 1], line.length() - (idxEq + 1)); // extract value
-					(*curSection)[tmpName] = tmpValue;
-				}
-			}
-		}
+	// Parses the file straight from the mapped memory. Malformed lines are skipped, and
+	// listed in document::issues(). Lookups are fast even with many thousands of keys.
+	static document load_document(const std::wstring& filePath) {
+		file_mapped fin;
+		fin.open(filePath, file::access::READONLY);
+		document doc;
+		doc.parse(fin.p_mem(), fin.size());
+		return doc;
+	}
 
+	// Loads the file, merging with any sections already present, in linear time.
+	file_ini& load_from_file(const wchar_t* filePath) {
+		load_document(filePath).merge_into(this->sections);
 		return *this;
 	}
 
-	void save_to_file(const wchar_t* filePath) const {
-		file::util::write(filePath,
-			str::to_utf8_blob(this->serialize(), str::write_bom::YES));
+	// Saves atomically, so a crash never leaves a half-written file.
+	void save_to_file(const std::wstring& filePath, file::durability dur = file::durability::DATA) const {
+		file::util::write_atomic(filePath, this->_to_blob(), dur);
+	}
+
+	// Queues the save to a background thread, so frequent saves are cheap: the ones of
+	// the same file made within a short time are coalesced. See file::util::write_behind().
+	void save_to_file_behind(const std::wstring& filePath, file::durability dur = file::durability::DATA) const {
+		file::util::write_behind(filePath, this->_to_blob(), dur);
 	}
 
-	file_ini& load_from_file(const std::wstring& filePath)     { return this->load_from_file(filePath.c_str()); }
-	void      save_to_file(const std::wstring& filePath) const { this->save_to_file(filePath.c_str()); }
+	file_ini& load_from_file(const std::wstring& filePath) { return this->load_from_file(filePath.c_str()); }
 
 	// Returns the INI contents as a string, ready to be written to a file.
 	std::wstring serialize() const {
-		std::wstring out;
-		bool isFirst = true;
-
-		using sectionT = insert_order_map<std::wstring, insert_order_map<std::wstring, std::wstring>>::entry;
-		using entryT = insert_order_map<std::wstring, std::wstring>::entry;
-
-		for (const sectionT& sectionEntry : this->sections) {
-			if (isFirst) {
-				isFirst = false;
-			} else {
-				out.append(L"\r\n");
-			}
-			out.append(L"[").append(sectionEntry.key).append(L"]\r\n");
-
-			for (const entryT& keyEntry : sectionEntry.value) {
-				out.append(keyEntry.key).append(L"=")
-					.append(keyEntry.value).append(L"\r\n");
-			}
-		}
-		return out;
+		str::builder out(this->_serialized_length());
+		this->_serialize(out);
+		return out.str();
 	}
 
 	// Checks INI file structure against "[section1]keyA,keyB,keyC[section2]keyX,keyY".
@@ -99,6 +82,43 @@ public:
 	}
 
 private:
+	using _sectionT = insert_order_map<std::wstring, insert_order_map<std::wstring, std::wstring>>::entry;
+	using _entryT = insert_order_map<std::wstring, std::wstring>::entry;
+
+	size_t _serialized_length() const noexcept {
+		size_t len = 0;
+		for (const _sectionT& sectionEntry : this->sections) {
+			len += sectionEntry.key.length() + 6; // [section]\r\n plus the blank line
+			for (const _entryT& keyEntry : sectionEntry.value) {
+				len += keyEntry.key.length() + keyEntry.value.length() + 3; // key=value\r\n
+			}
+		}
+		return len;
+	}
+
+	void _serialize(str::builder& out) const {
+		bool isFirst = true;
+		for (const _sectionT& sectionEntry : this->sections) {
+			if (isFirst) {
+				isFirst = false;
+			} else {
+				out.append(L"\r\n");
+			}
+			out.append(L'[').append(sectionEntry.key).append(L"]\r\n");
+
+			for (const _entryT& keyEntry : sectionEntry.value) {
+				out.append(keyEntry.key).append(L'=')
+					.append(keyEntry.value).append(L"\r\n");
+			}
+		}
+	}
+
+	std::vector<BYTE> _to_blob() const {
+		str::builder out(this->_serialized_length());
+		this->_serialize(out);
+		return str::to_utf8_blob(out, str::write_bom::YES); // no intermediary string
+	}
+
 	insert_order_map<std::wstring, std::vector<std::wstring>> _parse_structure(const std::wstring& structure) const {
 		using strvecT = std::vector<std::wstring>;
 		insert_order_map<std::wstring, strvecT> parsed;
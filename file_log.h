@@ -0,0 +1,195 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "file_mapped.h"
+#include "internals/log_format.h"
+
+namespace wl {
+
+// Append-only log of binary records, written to a memory-mapped file, which grows
+// geometrically so appends are just memory copies. Each record has its length and a
+// checksum, so when the file is reopened after a crash, a record torn in the middle
+// of a write is detected and discarded, along with anything after it. Only records
+// before a commit() are guaranteed to be on the disk. Not thread-safe.
+//
+// A mapped view of a file can't be extended in place, so growing unmaps the file and
+// maps it again: record offsets are stable, but pointers into the log, like those
+// given by for_each(), are valid only until the next append() that grows it. When
+// the size is known, reserve() maps it up front, so appends never remap.
+class file_log final {
+private:
+	static constexpr size_t _MIN_CAPACITY = 64 * 1024; // file grows in multiples of this
+
+	file_mapped _map;
+	uint64_t    _end = 0; // past the last record
+	uint64_t    _committed = 0; // everything before this is on the disk
+	size_t      _numRecords = 0;
+
+public:
+	~file_log() {
+		this->close();
+	}
+
+	file_log() = default;
+	file_log(file_log&& other) noexcept { this->operator=(std::move(other)); }
+
+	file_log& operator=(file_log&& other) noexcept {
+		this->close();
+		std::swap(this->_map, other._map);
+		std::swap(this->_end, other._end);
+		std::swap(this->_committed, other._committed);
+		std::swap(this->_numRecords, other._numRecords);
+		return *this;
+	}
+
+	uint64_t size() const noexcept        { return this->_end; } // bytes used, including the header
+	uint64_t capacity() const noexcept    { return this->_map.size64(); }
+	uint64_t committed() const noexcept   { return this->_committed; }
+	size_t   num_records() const noexcept { return this->_numRecords; }
+
+	// Closes the file, trimming the unused space at its end.
+	file_log& close() noexcept {
+		if (this->_end) {
+			try {
+				this->_map.set_new_size(static_cast<size_t>(this->_end));
+			} catch (...) { } // the zeros at the end will be ignored when reopening
+		}
+		this->_map.close();
+		this->_end = 0;
+		this->_committed = 0;
+		this->_numRecords = 0;
+		return *this;
+	}
+
+	// Opens the log, creating the file if it doesn't exist. Records torn by a crash
+	// are discarded.
+	file_log& open(const std::wstring& filePath) {
+		this->close();
+
+		{
+			file fout;
+			fout.open_or_create(filePath);
+			if (fout.size() < _wli::log_format::HEADER_SIZE) {
+				if (fout.size()) {
+					throw std::invalid_argument("File is not a log.");
+				}
+				fout.set_new_size(_MIN_CAPACITY); // a new file is all zeros
+			}
+		}
+
+		this->_map.open(filePath, file::access::READWRITE);
+		BYTE* p = this->_map.p_mem();
+		uint64_t cap = this->_map.size64();
+
+		if (_wli::log_format::is_blank(p)) {
+			_wli::log_format::write_header(p);
+			this->_map.flush(0, _wli::log_format::HEADER_SIZE);
+		} else if (!_wli::log_format::has_header(p)) {
+			this->_map.close();
+			throw std::invalid_argument("File is not a log.");
+		}
+
+		uint64_t zeroedEnd = 0;
+		this->_end = _wli::log_format::recover(p, cap, this->_numRecords, zeroedEnd);
+		if (zeroedEnd > this->_end) { // discarded records must be gone from the disk too
+			this->_map.flush(this->_end, static_cast<size_t>(zeroedEnd - this->_end));
+		}
+		this->_committed = this->_end;
+		return *this;
+	}
+
+	// Appends a record, returning its offset, which is stable and can be used with
+	// for_each(). The record isn't on the disk until commit() is called.
+	uint64_t append(const void* pData, size_t numBytes) {
+		this->_check_log_opened();
+		if (numBytes > _wli::log_format::MAX_PAYLOAD) {
+			throw std::invalid_argument("Record is too big.");
+		}
+
+		uint64_t recSz = _wli::log_format::record_size(numBytes);
+		if (this->_end + recSz > this->_map.size64()) {
+			this->_grow(std::max(this->_map.size64() * 2, this->_end + recSz)); // doubling, so remaps are rare
+		}
+		uint64_t offset = this->_end;
+		_wli::log_format::write_record(this->_map.p_mem() + offset, pData, numBytes);
+		this->_end += recSz;
+		++this->_numRecords;
+		return offset;
+	}
+
+	uint64_t append(const std::vector<BYTE>& data) {
+		return this->append(data.data(), data.size());
+	}
+
+	// Grows the file to hold at least the given number of bytes, including the header,
+	// so the appends until then don't remap it.
+	file_log& reserve(uint64_t numBytes) {
+		this->_check_log_opened();
+		if (numBytes > this->_map.size64()) {
+			this->_grow(numBytes);
+		}
+		return *this;
+	}
+
+	// Writes all records appended since the last commit to the disk, returning only
+	// when done; these will survive a crash.
+	file_log& commit() {
+		this->_check_log_opened();
+		if (this->_end > this->_committed) {
+			this->_map.flush(this->_committed, static_cast<size_t>(this->_end - this->_committed));
+			this->_committed = this->_end;
+		}
+		return *this;
+	}
+
+	// Writes a range of the log to the disk, returning only when done. Unlike commit(),
+	// it doesn't move the commit point.
+	file_log& flush(uint64_t offset, size_t numBytes) {
+		this->_check_log_opened();
+		this->_map.flush(offset, numBytes);
+		return *this;
+	}
+
+	// Calls the function for each record, in order, with no copies:
+	// func(uint64_t offset, const BYTE* pData, size_t numBytes). The pointer is valid
+	// until the log grows; the function must not append.
+	template<typename funcT>
+	void for_each(funcT&& func) const {
+		this->_check_log_opened();
+		const BYTE* p = this->_map.p_mem();
+		const BYTE* pPayload = nullptr;
+		size_t payloadSz = 0;
+		for (uint64_t offset = _wli::log_format::HEADER_SIZE, next = 0;
+			_wli::log_format::read_record(p, this->_end, offset, pPayload, payloadSz, next);
+			offset = next)
+		{
+			func(offset, pPayload, payloadSz);
+		}
+	}
+
+private:
+	void _check_log_opened() const {
+		if (!this->_end) {
+			throw std::logic_error("Log has not been opened.");
+		}
+	}
+
+	void _grow(uint64_t minCapacity) {
+		uint64_t newCap = (minCapacity + _MIN_CAPACITY - 1) / _MIN_CAPACITY * _MIN_CAPACITY;
+		if (newCap > SIZE_MAX) {
+			throw std::length_error("Log is too big to be mapped.");
+		}
+		this->_map.set_new_size(static_cast<size_t>(newCap)); // new space is all zeros; p_mem() changes
+	}
+};
+
+}//namespace wl
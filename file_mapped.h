@@ -6,16 +6,29 @@
  */
 
 #pragma once
+#include <memory>
 #include "file.h"
+#include "internals/file_view_cache.h"
 
 namespace wl {
 
-// Wrapper to a memory-mapped file.
+// Wrapper to a memory-mapped file. By default the whole file is mapped at once; in
+// windowed mode, views of it are mapped on demand, so files of any size can be used.
 class file_mapped final {
+public:
+	// Range of the file which stays mapped while the object is alive; it must not
+	// outlive the file_mapped.
+	using pinned_view = _wli::file_view_cache::pinned;
+
+	// How the mapped memory is expected to be accessed.
+	using access_pattern = _wli::file_map_backend::pattern;
+
 private:
-	file   _file;
-	HANDLE _hMap = nullptr;
-	void*  _pMem = nullptr;
+	file     _file;
+	HANDLE   _hMap = nullptr;
+	void*    _pMem = nullptr; // whole file, if not windowed
+	uint64_t _sz = 0;
+	std::unique_ptr<_wli::file_view_cache> _windows; // only if windowed
 
 public:
 	~file_mapped() {
@@ -30,15 +43,23 @@ public:
 		std::swap(this->_file, other._file);
 		std::swap(this->_hMap, other._hMap);
 		std::swap(this->_pMem, other._pMem);
+		std::swap(this->_sz, other._sz);
+		std::swap(this->_windows, other._windows);
 		return *this;
 	}
 
 	file::access access_type() const noexcept { return this->_file.access_type(); }
 	size_t       size() noexcept              { return this->_file.size(); }
-	BYTE*        p_mem() const noexcept       { return reinterpret_cast<BYTE*>(this->_pMem); }
-	BYTE*        p_past_mem() noexcept        { return p_mem() + this->size(); }
+	uint64_t     size64() const noexcept      { return this->_sz; } // also right for files above 4 GB in 32-bit builds
+	bool         is_windowed() const noexcept { return this->_windows != nullptr; }
 
+	// Pointer to the whole file; null in windowed mode, where view() must be used.
+	BYTE* p_mem() const noexcept  { return reinterpret_cast<BYTE*>(this->_pMem); }
+	BYTE* p_past_mem() noexcept   { return this->_pMem ? p_mem() + this->size() : nullptr; }
+
+	// Closes the file; no views can be pinned.
 	file_mapped& close() noexcept {
+		this->_windows.reset();
 		if (this->_pMem) {
 			UnmapViewOfFile(this->_pMem);
 			this->_pMem = nullptr;
@@ -48,10 +69,16 @@ public:
 			this->_hMap = nullptr;
 		}
 		this->_file.close();
+		this->_sz = 0;
 		return *this;
 	}
 
-	file_mapped& open(const std::wstring& filePath, file::access accessType) {
+	// Opens and maps the file. If windowSize is zero, the whole file is mapped at once;
+	// otherwise, views of windowSize bytes, rounded up to the allocation granularity, are
+	// mapped on demand, keeping up to maxViews of them alive.
+	file_mapped& open(const std::wstring& filePath, file::access accessType,
+		size_t windowSize = 0, size_t maxViews = 4)
+	{
 		this->close();
 
 		// Open file.
@@ -71,6 +98,14 @@ public:
 				"CreateFileMapping failed to map file as read-only");
 		}
 
+		this->_sz = this->_query_size();
+		if (windowSize) {
+			this->_windows.reset(new _wli::file_view_cache);
+			this->_windows->reset(this->_hMap, this->_sz, windowSize, maxViews,
+				accessType == file::access::READWRITE);
+			return *this;
+		}
+
 		// Get pointer to data block.
 		this->_pMem = MapViewOfFile(this->_hMap,
 			(accessType == file::access::READWRITE) ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
@@ -85,19 +120,30 @@ public:
 
 private:
 	void _check_file_mapped() const {
-		if (!this->_hMap || !this->_pMem || !this->_file.hfile()) {
+		if (!this->_hMap || (!this->_pMem && !this->_windows) || !this->_file.hfile()) {
 			throw std::logic_error("File has not been mapped.");
 		}
 	}
 
+	uint64_t _query_size() const noexcept {
+		LARGE_INTEGER sz{};
+		return GetFileSizeEx(this->_file.hfile(), &sz) ? static_cast<uint64_t>(sz.QuadPart) : 0;
+	}
+
 public:
-	// This method will truncate or expand the file, according to the new size.
+	// This method will truncate or expand the file, according to the new size; no views can be pinned.
 	file_mapped& set_new_size(size_t newSize) {
 		this->_check_file_mapped();
 
 		// Unmap file, but keep it open.
-		UnmapViewOfFile(this->_pMem);
+		if (this->_windows) {
+			this->_windows->clear(); // throws if any view is pinned
+		} else {
+			UnmapViewOfFile(this->_pMem);
+			this->_pMem = nullptr;
+		}
 		CloseHandle(this->_hMap);
+		this->_hMap = nullptr;
 
 		// Truncate/expand file, probably fail if file was opened as read-only.
 		this->_file.set_new_size(newSize);
@@ -113,6 +159,12 @@ public:
 			tooBad(GetLastError(), "CreateFileMapping failed to recreate mapping");
 		}
 
+		this->_sz = newSize;
+		if (this->_windows) {
+			this->_windows->reset(this->_hMap, this->_sz, this->_windows->window_size(), this->_windows->max_views(), true);
+			return *this;
+		}
+
 		// Get new pointer to data block, old one just became invalid.
 		this->_pMem = MapViewOfFile(this->_hMap, FILE_MAP_WRITE, 0, 0, 0);
 		if (!this->_pMem) {
@@ -122,22 +174,89 @@ public:
 		return *this;
 	}
 
-	// Reads file content, by default all at once.
-	file_mapped& read_to_buffer(std::vector<BYTE>& buf, size_t offset = 0, size_t numBytes = -1) {
+	// Returns a range of the file, which stays mapped while the returned object is
+	// alive, with no copies; numBytes is clamped at the end of the file.
+	pinned_view view(uint64_t offset, size_t numBytes) {
 		this->_check_file_mapped();
-		if (offset >= this->size()) {
+		if (this->_windows) {
+			return this->_windows->view(offset, numBytes);
+		} else if (offset > this->_sz) {
 			throw std::invalid_argument("Offset is beyond end of file.");
-		} else if (numBytes == -1 || offset + numBytes > this->size()) {
-			numBytes = this->size() - offset; // avoid reading beyond EOF
+		}
+		return {nullptr, this->p_mem() + offset,
+			static_cast<size_t>(std::min<uint64_t>(numBytes, this->_sz - offset))};
+	}
+
+	// Hints the system that the range will be accessed soon, so its pages are read in
+	// with large I/Os, ahead of time.
+	file_mapped& prefetch(uint64_t offset, size_t numBytes) {
+		this->_check_file_mapped();
+		if (this->_windows) {
+			this->_windows->prefetch(offset, numBytes);
+		} else if (offset < this->_sz) {
+			_wli::file_map_backend::prefetch(this->p_mem() + offset,
+				static_cast<size_t>(std::min<uint64_t>(numBytes, this->_sz - offset)));
+		}
+		return *this;
+	}
+
+	// Writes the modified pages of the range to the disk, returning only when done; in
+	// windowed mode, only views still alive are written.
+	file_mapped& flush(uint64_t offset, size_t numBytes) {
+		this->_check_file_mapped();
+		if (this->_windows) {
+			this->_windows->flush(offset, numBytes);
+		} else if (offset < this->_sz && numBytes) {
+			_wli::file_map_backend::flush(this->p_mem() + offset,
+				static_cast<size_t>(std::min<uint64_t>(numBytes, this->_sz - offset)));
+		}
+		if (!FlushFileBuffers(this->_file.hfile())) { // also file metadata, like its size
+			throw std::system_error(GetLastError(), std::system_category(),
+				"FlushFileBuffers failed");
+		}
+		return *this;
+	}
+
+	// Tells the system how the mapped memory will be accessed, so page faults read ahead
+	// accordingly; RANDOM is best for scattered small reads.
+	file_mapped& set_access_pattern(access_pattern pat) {
+		this->_check_file_mapped();
+		if (this->_windows) {
+			this->_windows->set_access_pattern(pat);
+		} else {
+			_wli::file_map_backend::advise(this->_pMem, static_cast<size_t>(this->_sz), pat);
+		}
+		return *this;
+	}
+
+	// Reads file content, by default all at once; view() avoids the copy.
+	file_mapped& read_to_buffer(std::vector<BYTE>& buf, uint64_t offset = 0, size_t numBytes = -1) {
+		this->_check_file_mapped();
+		if (offset >= this->_sz) {
+			throw std::invalid_argument("Offset is beyond end of file.");
+		} else if (numBytes == -1 || offset + numBytes > this->_sz) {
+			numBytes = static_cast<size_t>(this->_sz - offset); // avoid reading beyond EOF
 		}
 
 		buf.resize(numBytes);
-		memcpy(&buf[0], this->p_mem() + offset, numBytes * sizeof(BYTE));
+		if (!this->_windows) {
+			memcpy(&buf[0], this->p_mem() + offset, numBytes * sizeof(BYTE));
+			return *this;
+		}
+
+		size_t window = this->_windows->window_size();
+		for (size_t copied = 0; copied < numBytes; ) { // one window at a time, so views stay small
+			uint64_t pos = offset + copied;
+			pinned_view part = this->_windows->view(pos,
+				std::min(numBytes - copied, window - static_cast<size_t>(pos % window)));
+			memcpy(&buf[copied], part.data(), part.size());
+			copied += part.size();
+		}
 		return *this;
 	}
 
 	// Retrieves file content, by default all at once.
-	std::vector<BYTE> read(size_t offset = 0, size_t numBytes = -1) {
+	std::vector<BYTE> read(uint64_t offset = 0, size_t numBytes = -1) {
 		std::vector<BYTE> buf;
 		this->read_to_buffer(buf, offset, numBytes);
 		return buf;
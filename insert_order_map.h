@@ -6,6 +6,7 @@
  */
 
 #pragma once
+#include <utility>
 #include <vector>
 
 namespace wl {
@@ -79,6 +80,14 @@ public:
 		return this->_find(key) != this->_entries.cend();
 	}
 
+	// Appends an entry without searching for the key, which must not exist; useful to
+	// fill a big map fast. Returns the new value.
+	valueT& append_unique(keyT key) {
+		this->_entries.emplace_back();
+		this->_entries.back().key = std::move(key);
+		return this->_entries.back().value;
+	}
+
 	insert_order_map& remove(const keyT& key) {
 		typename std::vector<entry>::iterator ite = this->_find(key);
 		if (ite != this->_entries.end()) { // won't fail if inexistent
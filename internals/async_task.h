@@ -0,0 +1,238 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include "thread_pool.h"
+#include "ui_queue.h"
+
+// Coroutine support is available only when compiling as C++20.
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define WINLAMB_COROUTINES
+#endif
+#endif
+
+#ifdef WINLAMB_COROUTINES
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace wl {
+namespace _wli {
+
+// Owns a suspended coroutine, destroying it if never resumed.
+class coroutine_owner final {
+private:
+	std::coroutine_handle<> _h;
+
+public:
+	~coroutine_owner() {
+		if (this->_h) this->_h.destroy(); // callback was discarded: window is gone
+	}
+
+	explicit coroutine_owner(std::coroutine_handle<> h) noexcept : _h(h) { }
+	coroutine_owner(coroutine_owner&& other) noexcept : _h(std::exchange(other._h, nullptr)) { }
+	coroutine_owner& operator=(coroutine_owner&&) = delete;
+
+	void resume() noexcept {
+		std::exchange(this->_h, nullptr).resume();
+	}
+};
+
+// Fire-and-forget coroutine. When it's a member function of a window, or its
+// first parameter is a window, it's bound to that window: resume_ui() comes back
+// to its UI thread, and if the window is destroyed meanwhile, the coroutine is
+// destroyed instead of resumed.
+class async_task final {
+public:
+	class promise_type final {
+	private:
+		ui_context _ctx;
+
+	public:
+		promise_type() = default;
+
+		template<typename ownerT, typename ...argsT>
+			requires requires(ownerT& owner) { owner.get_ui_context(); }
+		promise_type(ownerT& owner, argsT&...) noexcept :
+			_ctx(owner.get_ui_context()) { }
+
+		const ui_context& context() const noexcept { return this->_ctx; }
+
+		async_task get_return_object() const noexcept { return {}; }
+		std::suspend_never initial_suspend() const noexcept { return {}; }
+		std::suspend_never final_suspend() const noexcept { return {}; }
+		void return_void() const noexcept { }
+
+		void unhandled_exception() const noexcept {
+			if (this->_ctx) { // rethrown in the UI thread, handled like any message exception
+				this->_ctx.post([curExcept = std::current_exception()]() -> void {
+					std::rethrow_exception(curExcept);
+				});
+			} else {
+				lippincott();
+			}
+		}
+	};
+};
+
+template<typename promiseT>
+ui_context pick_ui_context(const ui_context& ctx, std::coroutine_handle<promiseT> h) {
+	if (ctx) return ctx;
+	if constexpr (std::is_same_v<promiseT, async_task::promise_type>) {
+		if (h.promise().context()) return h.promise().context();
+	}
+	throw std::logic_error("Coroutine is not bound to a window, a UI context must be explicitly given.");
+}
+
+// Posts the coroutine to be resumed in the UI thread; if the window is gone, it's destroyed.
+inline void post_resume(const ui_context& ctx, std::coroutine_handle<> h) {
+	ctx.post([owner = coroutine_owner{h}]() mutable noexcept -> void {
+		owner.resume();
+	});
+}
+
+// Awaiter which resumes the coroutine in a thread from the process-wide pool.
+class resume_background_awaiter final {
+private:
+	thread_pool::priority _prio;
+
+public:
+	explicit resume_background_awaiter(thread_pool::priority prio) noexcept : _prio(prio) { }
+
+	bool await_ready() const noexcept { return false; }
+	void await_resume() const noexcept { }
+
+	void await_suspend(std::coroutine_handle<> h) const {
+		thread_pool::instance().submit(this->_prio, [h]() noexcept -> void {
+			h.resume();
+		});
+	}
+};
+
+// Awaiter which resumes the coroutine in the UI thread.
+class resume_ui_awaiter final {
+private:
+	ui_context _ctx; // if empty, the one the coroutine is bound to is used
+
+public:
+	explicit resume_ui_awaiter(ui_context ctx) noexcept : _ctx(std::move(ctx)) { }
+
+	bool await_ready() const noexcept { return false; }
+	void await_resume() const noexcept { }
+
+	template<typename promiseT>
+	bool await_suspend(std::coroutine_handle<promiseT> h) const {
+		ui_context target = pick_ui_context(this->_ctx, h); // the frame may be gone after posting
+		if (target.is_ui_thread() && target.is_alive()) {
+			return false; // already there, go on without suspending
+		}
+		post_resume(target, h);
+		return true;
+	}
+};
+
+template<typename resultT>
+class background_result final {
+private:
+	std::optional<resultT> _value;
+
+public:
+	template<typename funcT>
+	void run(funcT& func) { this->_value.emplace(func()); }
+	resultT take() { return std::move(*this->_value); }
+};
+
+template<>
+class background_result<void> final {
+public:
+	template<typename funcT>
+	void run(funcT& func) { func(); }
+	void take() const noexcept { }
+};
+
+// Awaiter which runs a function in a thread from the pool, then resumes the
+// coroutine in the UI thread, returning the function result.
+template<typename funcT>
+class run_background_awaiter final {
+public:
+	using result_type = std::invoke_result_t<funcT&>;
+
+private:
+	funcT                          _func;
+	ui_context                     _ctx;
+	thread_pool::priority          _prio;
+	std::exception_ptr             _curExcept;
+	background_result<result_type> _result;
+
+public:
+	run_background_awaiter(funcT&& func, ui_context ctx, thread_pool::priority prio) :
+		_func(std::move(func)), _ctx(std::move(ctx)), _prio(prio) { }
+
+	bool await_ready() const noexcept { return false; }
+
+	template<typename promiseT>
+	void await_suspend(std::coroutine_handle<promiseT> h) {
+		thread_pool::instance().submit(this->_prio,
+			[this, h, target = pick_ui_context(this->_ctx, h)]() noexcept -> void {
+				try {
+					this->_result.run(this->_func);
+				} catch (...) {
+					this->_curExcept = std::current_exception(); // rethrown in the UI thread, by await_resume()
+				}
+				post_resume(target, h);
+			});
+	}
+
+	result_type await_resume() {
+		if (this->_curExcept) std::rethrow_exception(this->_curExcept);
+		return this->_result.take();
+	}
+};
+
+// Resumes the coroutine in a thread from the process-wide pool.
+inline resume_background_awaiter resume_background(
+	thread_pool::priority prio = thread_pool::priority::NORMAL) noexcept
+{
+	return resume_background_awaiter{prio};
+}
+
+// Resumes the coroutine in the UI thread of the window it's bound to.
+inline resume_ui_awaiter resume_ui() noexcept {
+	return resume_ui_awaiter{ui_context{}};
+}
+
+// Resumes the coroutine in the UI thread of the given window.
+inline resume_ui_awaiter resume_ui(ui_context ctx) noexcept {
+	return resume_ui_awaiter{std::move(ctx)};
+}
+
+// Runs the function in a thread from the pool, resuming the coroutine in the
+// UI thread of the window it's bound to.
+template<typename funcT>
+run_background_awaiter<std::decay_t<funcT>> run_background(funcT&& func,
+	thread_pool::priority prio = thread_pool::priority::NORMAL)
+{
+	return {std::decay_t<funcT>(std::forward<funcT>(func)), ui_context{}, prio};
+}
+
+// Runs the function in a thread from the pool, resuming the coroutine in the
+// UI thread of the given window.
+template<typename funcT>
+run_background_awaiter<std::decay_t<funcT>> run_background(ui_context ctx, funcT&& func,
+	thread_pool::priority prio = thread_pool::priority::NORMAL)
+{
+	return {std::decay_t<funcT>(std::forward<funcT>(func)), std::move(ctx), prio};
+}
+
+}//namespace _wli
+}//namespace wl
+
+#endif
@@ -6,59 +6,211 @@
  */
 
 #pragma once
+#include <algorithm>
+#include <iterator>
 #include <system_error>
+#include <unordered_set>
 #include <vector>
 #include <Windows.h>
+#include "callable.h"
+#include "lippincott.h"
 
 namespace wl {
 namespace _wli {
 
-// Wraps the main program loop.
+// Wraps the main program loop, which also runs idle tasks and paces redraws.
 class base_loop final {
 private:
-	std::vector<HWND> _modelessChildren;
+	std::unordered_set<HWND>      _modeless; // dialogs, either top-level or WS_CHILD
+	std::vector<callable<bool()>> _idleTasks, _idleIncoming; // incoming ones are merged between slices
+	size_t                        _idleNext = 0; // round-robin position
+	UINT                          _idleBudgetMs = 8;
+	std::vector<HWND>             _pendingRedraws;
+	LONGLONG                      _frameTicks = 0; // zero means frame pacing is off
+	LONGLONG                      _nextFrame = 0;
 
 public:
-	int run_loop(HWND hWnd, HACCEL hAccel = nullptr) const {
+	int run_loop(HWND hWnd, HACCEL hAccel = nullptr) {
 		MSG msg{};
-		BOOL ret = FALSE;
-		while ((ret = GetMessageW(&msg, nullptr, 0, 0)) != 0) {
-			if (ret == -1) {
+		for (;;) {
+			while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE)) {
+				if (msg.message == WM_QUIT) {
+					return static_cast<int>(msg.wParam); // this can be used as program return value
+				}
+				if (this->_is_modeless_msg(&msg) || // http://www.winprog.org/tutorial/modeless_dialogs.html
+					(hAccel && TranslateAcceleratorW(hWnd, hAccel, &msg)) ||
+					IsDialogMessageW(hWnd, &msg) ) continue;
+				TranslateMessage(&msg);
+				DispatchMessageW(&msg);
+			}
+
+			// Message queue is empty, including WM_PAINT.
+			this->_flush_redraws_if_due();
+			this->_run_idle_slice();
+
+			DWORD waitMs = INFINITE;
+			if (!this->_idleTasks.empty() || !this->_idleIncoming.empty()) {
+				waitMs = 0; // just check for new messages, then run next slice
+			} else if (!this->_pendingRedraws.empty()) {
+				waitMs = this->_ms_until_next_frame();
+			}
+			if (MsgWaitForMultipleObjectsEx(0, nullptr, waitMs,
+				QS_ALLINPUT, MWMO_INPUTAVAILABLE) == WAIT_FAILED)
+			{
 				throw std::system_error(GetLastError(), std::system_category(),
-					"GetMessage failed");
+					"MsgWaitForMultipleObjectsEx failed");
 			}
-			if (this->_is_modeless_msg(&msg) || // http://www.winprog.org/tutorial/modeless_dialogs.html
-				(hAccel && TranslateAcceleratorW(hWnd, hAccel, &msg)) ||
-				IsDialogMessageW(hWnd, &msg) ) continue;
-			TranslateMessage(&msg);
-			DispatchMessageW(&msg);
 		}
-		return static_cast<int>(msg.wParam); // this can be used as program return value
+	}
+
+	// Queues a task to run in small chunks when the message queue is empty; it
+	// will be called repeatedly, until it returns false.
+	void run_idle(callable<bool()> func) {
+		this->_idleIncoming.emplace_back(std::move(func));
+	}
+
+	// Sets the maximum time idle tasks can run before messages are checked again.
+	void set_idle_budget(UINT milliseconds) noexcept {
+		this->_idleBudgetMs = milliseconds ? milliseconds : 1;
+	}
+
+	// When enabled, schedule_redraw() calls are batched and flushed at display refresh rate.
+	void set_frame_paced(bool paced) {
+		if (!paced) {
+			this->_frameTicks = 0;
+			this->_flush_redraws(); // nothing is left behind
+			return;
+		}
+
+		HDC hdc = GetDC(nullptr);
+		int hz = GetDeviceCaps(hdc, VREFRESH);
+		ReleaseDC(nullptr, hdc);
+		if (hz <= 1) hz = 60; // 0 and 1 mean default hardware refresh rate
+
+		this->_frameTicks = _qpc_frequency() / hz;
+		this->_nextFrame = _qpc_now() + this->_frameTicks;
+	}
+
+	// Invalidates the window at the next display frame, if frame pacing is enabled;
+	// otherwise, invalidates it right away.
+	void schedule_redraw(HWND hWnd) {
+		if (!this->_frameTicks) {
+			InvalidateRect(hWnd, nullptr, TRUE);
+		} else if (std::find(this->_pendingRedraws.cbegin(), this->_pendingRedraws.cend(), hWnd)
+			== this->_pendingRedraws.cend())
+		{
+			this->_pendingRedraws.emplace_back(hWnd);
+		}
 	}
 
 	void add_modeless(HWND hWnd) {
-		this->_modelessChildren.emplace_back(hWnd);
+		this->_prune_modeless(); // before the handle of a dead dialog is reused
+		this->_modeless.emplace(hWnd);
 	}
 
 	void remove_modeless(HWND hWnd) {
-		for (std::vector<HWND>::iterator it = this->_modelessChildren.begin();
-			it != this->_modelessChildren.end(); ++it)
-		{
-			if (*it == hWnd) {
-				this->_modelessChildren.erase(it);
-				break;
+		this->_modeless.erase(hWnd);
+	}
+
+private:
+	void _run_idle_slice() { // allocation failures go up to run_main(), like any other from the loop
+		if (!this->_idleIncoming.empty()) { // tasks may queue other tasks, so they're only merged here
+			for (callable<bool()>& task : this->_idleIncoming) {
+				this->_idleTasks.emplace_back(std::move(task));
+			}
+			this->_idleIncoming.clear();
+		}
+		if (this->_idleTasks.empty()) return;
+
+		LONGLONG deadline = _qpc_now() + _qpc_frequency() * this->_idleBudgetMs / 1000;
+		do {
+			if (this->_idleNext >= this->_idleTasks.size()) this->_idleNext = 0;
+
+			bool hasMore = false;
+			try {
+				hasMore = this->_idleTasks[this->_idleNext](); // invoke user callback
+			} catch (...) {
+				lippincott();
+				PostQuitMessage(-1);
+			}
+
+			if (hasMore) {
+				++this->_idleNext; // each task takes turns
+			} else {
+				this->_idleTasks.erase(this->_idleTasks.begin() + this->_idleNext);
 			}
+		} while (!this->_idleTasks.empty() &&
+			_qpc_now() < deadline &&
+			!HIWORD(GetQueueStatus(QS_INPUT))); // user input comes first
+	}
+
+	void _flush_redraws_if_due() noexcept {
+		if (this->_pendingRedraws.empty() || !this->_frameTicks) return;
+
+		LONGLONG now = _qpc_now();
+		if (now >= this->_nextFrame) {
+			this->_flush_redraws();
+			this->_nextFrame += ((now - this->_nextFrame) / this->_frameTicks + 1) * this->_frameTicks; // skip missed frames
 		}
 	}
 
-private:
-	bool _is_modeless_msg(MSG* pMsg) const noexcept {
-		for (const HWND hModl : this->_modelessChildren) {
-			if (!hModl || !IsWindow(hModl)) continue; // skip invalid HWND
-			if (IsDialogMessageW(hModl, pMsg)) return true;
+	void _flush_redraws() noexcept {
+		for (HWND hWnd : this->_pendingRedraws) {
+			if (IsWindow(hWnd)) InvalidateRect(hWnd, nullptr, TRUE);
+		}
+		this->_pendingRedraws.clear();
+	}
+
+	DWORD _ms_until_next_frame() const noexcept {
+		LONGLONG ticks = this->_nextFrame - _qpc_now();
+		if (ticks <= 0) return 0;
+		return static_cast<DWORD>((ticks * 1000 + _qpc_frequency() - 1) / _qpc_frequency()); // round up
+	}
+
+	static LONGLONG _qpc_now() noexcept {
+		LARGE_INTEGER li{};
+		QueryPerformanceCounter(&li);
+		return li.QuadPart;
+	}
+
+	static LONGLONG _qpc_frequency() noexcept {
+		static LONGLONG freq = []() noexcept -> LONGLONG {
+			LARGE_INTEGER li{};
+			QueryPerformanceFrequency(&li);
+			return li.QuadPart;
+		}();
+		return freq;
+	}
+
+	bool _is_modeless_msg(MSG* pMsg) noexcept {
+		if (this->_modeless.empty() || !pMsg->hwnd) return false; // thread messages have no window
+
+		// A message can only be meant to the innermost modeless dialog which contains its
+		// window, so there's no need to ask each one of them. A WS_CHILD dialog is not the
+		// root, so the parents are walked up to the top-level window.
+		HWND hRoot = GetAncestor(pMsg->hwnd, GA_ROOT);
+		for (HWND hAncestor = pMsg->hwnd; hAncestor;
+			hAncestor = (hAncestor == hRoot) ? nullptr : GetAncestor(hAncestor, GA_PARENT))
+		{
+			std::unordered_set<HWND>::iterator it = this->_modeless.find(hAncestor);
+			if (it == this->_modeless.end()) continue;
+
+			if (!IsWindow(hAncestor)) { // destroyed without being removed
+				this->_modeless.erase(it);
+				return false;
+			}
+			return IsDialogMessageW(hAncestor, pMsg) != FALSE;
 		}
 		return false;
 	}
+
+	void _prune_modeless() noexcept {
+		for (std::unordered_set<HWND>::iterator it = this->_modeless.begin();
+			it != this->_modeless.end(); )
+		{
+			it = IsWindow(*it) ? std::next(it) : this->_modeless.erase(it);
+		}
+	}
 };
 
 }//namespace _wli
@@ -0,0 +1,47 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include "base_loop.h"
+
+namespace wl {
+namespace _wli {
+
+// Provides public methods for base_loop class; all of them must be called from the UI thread.
+class base_loop_pubm {
+private:
+	base_loop& _baseLoop;
+
+public:
+	base_loop_pubm(base_loop& baseLoop) noexcept :
+		_baseLoop(baseLoop) { }
+
+	// Queues a task to run in small chunks when the message queue is empty; it
+	// will be called repeatedly, until it returns false.
+	void run_idle(callable<bool()> func) {
+		this->_baseLoop.run_idle(std::move(func));
+	}
+
+	// Sets the maximum time idle tasks can run before messages are checked again; default is 8 ms.
+	void set_idle_budget(UINT milliseconds) noexcept {
+		this->_baseLoop.set_idle_budget(milliseconds);
+	}
+
+	// When enabled, schedule_redraw() calls are batched and flushed at display refresh rate.
+	void set_frame_paced(bool paced) {
+		this->_baseLoop.set_frame_paced(paced);
+	}
+
+	// Invalidates the window at the next display frame, if frame pacing is enabled;
+	// otherwise, invalidates it right away.
+	void schedule_redraw(HWND hWnd) {
+		this->_baseLoop.schedule_redraw(hWnd);
+	}
+};
+
+}//namespace _wli
+}//namespace wl
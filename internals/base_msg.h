@@ -22,9 +22,13 @@ private:
 	const HWND& _hWnd;
 
 public:
-	store<UINT, retT>                      msgs;
-	store<WORD, retT>                      cmds;
-	store<std::pair<UINT_PTR, UINT>, retT> ntfs; // idFrom, code
+	store<UINT, retT>                       msgs;
+	store<WORD, retT>                       cmds;
+	store<std::pair<UINT_PTR, UINT>, retT>  ntfs; // idFrom, code
+	callable<void()>                        attachHook; // internal setup, runs before any WM_NCCREATE or WM_INITDIALOG handler
+	callable<void()>                        detachHook; // internal cleanup, runs before any WM_NCDESTROY handler
+	UINT                                    internalMsg = 0; // handled only by internalHook, which may leave it unprocessed
+	callable<std::pair<bool, retT>(params)> internalHook;
 
 	base_msg(const HWND& hWnd) noexcept :
 		_hWnd(hWnd) { }
@@ -35,8 +39,20 @@ public:
 	}
 
 	std::pair<bool, retT> process_msg(UINT msg, WPARAM wp, LPARAM lp) noexcept {
-		this->_canAdd = false; // lock, no further message handlers can be added
-		std::function<retT(params)>* pUserLambda = nullptr;
+		if (this->_canAdd) {
+			this->_canAdd = false; // lock, no further message handlers can be added
+			this->msgs.freeze(); // build O(1) lookup indexes, now that the handlers are known
+			this->cmds.freeze();
+			this->ntfs.freeze();
+		}
+		if ((msg == WM_NCCREATE || msg == WM_INITDIALOG) && this->attachHook) {
+			this->attachHook();
+		} else if (msg == WM_NCDESTROY && this->detachHook) {
+			this->detachHook();
+		} else if (msg == this->internalMsg && this->internalHook) {
+			return this->internalHook({msg, wp, lp}); // may be meant for another subclass of the same window
+		}
+		typename store<UINT, retT>::func_type* pUserLambda = nullptr;
 
 		// WM_COMMAND and WM_NOTIFY messages could have been orthogonally inserted into
 		// store<> just like any other messages, however they'd be at the bottom of
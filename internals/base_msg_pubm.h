@@ -7,6 +7,7 @@
 
 #pragma once
 #include "base_msg.h"
+#include "params_traits.h"
 
 namespace wl {
 namespace _wli {
@@ -22,44 +23,63 @@ public:
 		_baseMsg(baseMsg) { }
 
 	// Assigns a lambda to handle a window message.
-	void on_message(UINT msg, std::function<retT(params)> func) {
+	void on_message(UINT msg, callable<retT(params)> func) {
 		this->_baseMsg.throw_if_cant_add();
 		this->_baseMsg.msgs.add(msg, std::move(func));
 	}
 	// Assigns a lambda to handle a window message.
-	void on_message(std::initializer_list<UINT> msgs, std::function<retT(params)> func) {
+	void on_message(std::initializer_list<UINT> msgs, callable<retT(params)> func) {
 		this->_baseMsg.throw_if_cant_add();
 		this->_baseMsg.msgs.add(msgs, std::move(func));
 	}
 
+	// Assigns a lambda to handle a window message, which receives the message cracker
+	// chosen at compile time, like on_message<WM_MOUSEMOVE>([](wm::mousemove p) { ... }).
+	template<UINT msgT, typename funcT>
+	void on_message(funcT&& func) {
+		using crackerT = typename wm_cracker<msgT>::type;
+		this->on_message(msgT, [func = std::forward<funcT>(func)](params p) mutable -> retT {
+			return func(crackerT(p)); // cracker built right into the argument, user lambda inlined here
+		});
+	}
+
 	// Assigns a lambda to handle a WM_COMMAND message.
-	void on_command(WORD cmd, std::function<retT(params)> func) {
+	void on_command(WORD cmd, callable<retT(params)> func) {
 		this->_baseMsg.throw_if_cant_add();
 		this->_baseMsg.cmds.add(cmd, std::move(func));
 	}
 	// Assigns a lambda to handle a WM_COMMAND message.
-	void on_command(std::initializer_list<WORD> cmds, std::function<retT(params)> func) {
+	void on_command(std::initializer_list<WORD> cmds, callable<retT(params)> func) {
 		this->_baseMsg.throw_if_cant_add();
 		this->_baseMsg.cmds.add(cmds, std::move(func));
 	}
 
 	// Assigns a lambda to handle a WM_NOTIFY message.
-	void on_notify(UINT_PTR idFrom, UINT code, std::function<retT(params)> func) {
+	void on_notify(UINT_PTR idFrom, UINT code, callable<retT(params)> func) {
 		this->_baseMsg.throw_if_cant_add();
 		this->_baseMsg.ntfs.add({idFrom, code}, std::move(func));
 	}
 	// Assigns a lambda to handle a WM_NOTIFY message.
-	void on_notify(std::pair<UINT_PTR, UINT> idFromAndCode, std::function<retT(params)> func) {
+	void on_notify(std::pair<UINT_PTR, UINT> idFromAndCode, callable<retT(params)> func) {
 		this->_baseMsg.throw_if_cant_add();
 		this->_baseMsg.ntfs.add(idFromAndCode, std::move(func));
 	}
 	// Assigns a lambda to handle a WM_NOTIFY message.
 	void on_notify(std::initializer_list<std::pair<UINT_PTR, UINT>> idFromAndCodes,
-		std::function<retT(params)> func)
+		callable<retT(params)> func)
 	{
 		this->_baseMsg.throw_if_cant_add();
 		this->_baseMsg.ntfs.add(idFromAndCodes, std::move(func));
 	}
+	// Assigns a lambda to handle a WM_NOTIFY message, which receives the notification
+	// cracker chosen at compile time, like on_notify<LVN_ITEMCHANGED>(ID_LIST, [](wmn::lvn::itemchanged p) { ... }).
+	template<UINT codeT, typename funcT>
+	void on_notify(UINT_PTR idFrom, funcT&& func) {
+		using crackerT = typename wmn_cracker<codeT>::type;
+		this->on_notify(idFrom, codeT, [func = std::forward<funcT>(func)](params p) mutable -> retT {
+			return func(crackerT(p));
+		});
+	}
 };
 
 }//namespace _wli
@@ -7,6 +7,7 @@
 
 #pragma once
 #include <string>
+#include <string_view>
 #include <Windows.h>
 
 namespace wl {
@@ -36,12 +37,19 @@ public:
 	// Simple wrapper to GetWindowText.
 	std::wstring get_text() const {
 		std::wstring buf;
+		this->get_text(buf);
+		return buf;
+	}
+
+	// Simple wrapper to GetWindowText, which reuses the memory of the given buffer
+	// and returns a view to it.
+	std::wstring_view get_text(std::wstring& buf) const {
 		int len = GetWindowTextLengthW(this->_hWnd);
+		buf.resize(len + 1, L'\0'); // room for terminating null
 		if (len) {
-			buf.resize(len + 1, L'\0');
-			GetWindowTextW(this->_hWnd, &buf[0], len + 1);
-			buf.resize(len);
+			len = GetWindowTextW(this->_hWnd, &buf[0], len + 1);
 		}
+		buf.resize(len);
 		return buf;
 	}
 };
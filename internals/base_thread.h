@@ -6,8 +6,10 @@
  */
 
 #pragma once
+#include <memory>
 #include "base_msg.h"
-#include <process.h>
+#include "thread_pool.h"
+#include "ui_queue.h"
 
 namespace wl {
 namespace _wli {
@@ -17,58 +19,91 @@ template<typename retT, retT RET_VAL>
 class base_thread final {
 private:
 	struct _callback_pack final {
-		std::function<void()> func;
-		HWND                  hWnd = nullptr;
-		std::exception_ptr    curExcept = nullptr;
+		callable<void()>   func;
+		HWND               hWnd = nullptr;
+		std::exception_ptr curExcept = nullptr;
 	};
 
-	static const UINT WM_THREAD_MESSAGE = WM_APP + 0x3FFF;
+	static const UINT   WM_THREAD_MESSAGE = WM_APP + 0x3FFF;
+	static const WPARAM DRAIN_UI_QUEUE = 1; // WM_THREAD_MESSAGE wParam to drain the post_thread_ui() queue
 
-	base_msg<retT>& _baseMsg;
+	base_msg<retT>&           _baseMsg;
+	std::shared_ptr<ui_queue> _uiQueue{new ui_queue(WM_THREAD_MESSAGE, DRAIN_UI_QUEUE)}; // shared with any ui_context
 
 public:
+	~base_thread() {
+		this->_uiQueue->cancel(); // callbacks which never ran, window is gone
+	}
+
 	base_thread(base_msg<retT>& baseMsg) :
 		_baseMsg(baseMsg)
 	{
-		baseMsg.msgs.add(WM_THREAD_MESSAGE, [this](params p) noexcept -> retT {
+		baseMsg.internalMsg = WM_THREAD_MESSAGE;
+		baseMsg.internalHook = [this](params p) noexcept -> std::pair<bool, retT> {
+			if (p.wParam == DRAIN_UI_QUEUE && !this->_uiQueue->is_wake_msg(p.message, p.wParam, p.lParam)) {
+				return {false, RET_VAL}; // queue of another subclass of the same window, let it pass
+			}
 			this->_process_thread_ui_msg(p);
-			return RET_VAL; // 0 for windows, TRUE for dialogs
-		});
+			return {true, RET_VAL}; // 0 for windows, TRUE for dialogs
+		};
+		baseMsg.attachHook = [this]() noexcept -> void {
+			this->_uiQueue->begin(this->_baseMsg.hwnd()); // callbacks posted before the window existed are run
+		};
+		baseMsg.detachHook = [this]() noexcept -> void {
+			this->_uiQueue->cancel(); // pending post_thread_ui() callbacks and coroutines are dropped
+		};
 	}
 
-	// Runs code asynchronously in a new detached thread.
-	void run_thread_detached(std::function<void()> func) const noexcept {
+	// Runs code asynchronously in a thread from the process-wide pool.
+	void run_thread_detached(callable<void()> func) const {
 		// Analog to std::thread([](){ ... }).detach(), but exception-safe.
-		_callback_pack* pPack = new _callback_pack{std::move(func), this->_baseMsg.hwnd()};
+		this->run_thread_pooled(thread_pool::priority::NORMAL, std::move(func));
+	}
 
-		uintptr_t hThread = _beginthreadex(nullptr, 0, [](void* ptr) noexcept -> unsigned int {
-			_callback_pack* pPack = reinterpret_cast<_callback_pack*>(ptr);
+	// Runs code asynchronously in a thread from the process-wide pool, with the given priority.
+	void run_thread_pooled(thread_pool::priority prio, callable<void()> func) const {
+		HWND hWnd = this->_baseMsg.hwnd();
+		thread_pool::instance().submit(prio, [func = std::move(func), hWnd]() mutable noexcept -> void {
 			try {
-				pPack->func(); // invoke user callback
+				func(); // invoke user callback
 			} catch (...) {
-				_callback_pack* pCrashed = new _callback_pack{[]{}, pPack->hWnd, std::current_exception()};
-				SendMessageW(pPack->hWnd, WM_THREAD_MESSAGE, 0, reinterpret_cast<LPARAM>(pCrashed));
+				_callback_pack crashed{nullptr, hWnd, std::current_exception()};
+				if (IsWindow(hWnd)) { // if the window is gone, there's no one to report to
+					SendMessageW(hWnd, WM_THREAD_MESSAGE, 0, reinterpret_cast<LPARAM>(&crashed));
+				}
 			}
-			delete pPack;
-			_endthreadex(0); // http://www.codeproject.com/Articles/7732/A-class-to-synchronise-thread-completions/
-			return 0;
-		}, pPack, 0, nullptr);
-
-		CloseHandle(reinterpret_cast<HANDLE>(hThread));
+		});
 	}
 
 	// Runs code synchronously in the UI thread.
-	void run_thread_ui(std::function<void()> func) const noexcept {
+	void run_thread_ui(callable<void()> func) const noexcept {
 		// This method is analog to SendMessage (synchronous), but intended to be called
 		// from another thread, so a callback function can, tunelled by wndproc, run in
 		// the original thread of the window, thus allowing GUI updates. This avoids the
 		// user to deal with a custom WM_ message.
-		_callback_pack* pPack = new _callback_pack{std::move(func), this->_baseMsg.hwnd()};
-		SendMessageW(this->_baseMsg.hwnd(), WM_THREAD_MESSAGE, 0, reinterpret_cast<LPARAM>(pPack));
+		_callback_pack pack{std::move(func), this->_baseMsg.hwnd()}; // SendMessage blocks, so it can live on the stack
+		SendMessageW(this->_baseMsg.hwnd(), WM_THREAD_MESSAGE, 0, reinterpret_cast<LPARAM>(&pack));
+	}
+
+	// Queues code to run asynchronously in the UI thread, returning immediately.
+	// If coalesceKey is not zero, only the newest queued callback with that key will run.
+	void post_thread_ui(callable<void()> func, UINT_PTR coalesceKey = 0) const {
+		// Unlike run_thread_ui(), the worker thread is never blocked.
+		this->_uiQueue->post(this->_uiQueue->generation(), std::move(func), coalesceKey);
+	}
+
+	// Returns a handle to the UI thread, which can be safely used even after the window is destroyed.
+	ui_context get_ui_context() const noexcept {
+		return ui_context{this->_uiQueue};
 	}
 
 private:
 	void _process_thread_ui_msg(const params& p) const noexcept {
+		if (p.wParam == DRAIN_UI_QUEUE) {
+			this->_uiQueue->drain();
+			return;
+		}
+
 		_callback_pack* pPack = reinterpret_cast<_callback_pack*>(p.lParam);
 		if (pPack->curExcept) { // catching an exception from run_thread_detached()
 			try {
@@ -85,7 +120,6 @@ private:
 				PostQuitMessage(-1);
 			}
 		}
-		delete pPack;
 	}
 };
 
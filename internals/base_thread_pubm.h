@@ -18,18 +18,36 @@ private:
 	base_thread<retT, RET_VAL>& _baseThread;
 
 public:
+	using thread_priority = thread_pool::priority;
+
 	base_thread_pubm(base_thread<retT, RET_VAL>& baseThread) :
 		_baseThread(baseThread) { }
 
-	// Runs code asynchronously in a new detached thread.
-	void run_thread_detached(std::function<void()> func) const noexcept {
+	// Runs code asynchronously in a thread from the process-wide pool.
+	void run_thread_detached(callable<void()> func) const {
 		return this->_baseThread.run_thread_detached(std::move(func));
 	}
 
+	// Runs code asynchronously in a thread from the process-wide pool, with the given priority.
+	void run_thread_pooled(thread_priority prio, callable<void()> func) const {
+		return this->_baseThread.run_thread_pooled(prio, std::move(func));
+	}
+
 	// Runs code synchronously in the UI thread.
-	void run_thread_ui(std::function<void()> func) const noexcept {
+	void run_thread_ui(callable<void()> func) const noexcept {
 		return this->_baseThread.run_thread_ui(std::move(func));
 	}
+
+	// Queues code to run asynchronously in the UI thread, returning immediately.
+	// If coalesceKey is not zero, only the newest queued callback with that key will run.
+	void post_thread_ui(callable<void()> func, UINT_PTR coalesceKey = 0) const {
+		return this->_baseThread.post_thread_ui(std::move(func), coalesceKey);
+	}
+
+	// Returns a handle to the UI thread, which can be safely used even after the window is destroyed.
+	ui_context get_ui_context() const noexcept {
+		return this->_baseThread.get_ui_context();
+	}
 };
 
 }//namespace _wli
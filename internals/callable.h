@@ -0,0 +1,121 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace wl {
+namespace _wli {
+
+template<typename signatureT>
+class callable;
+
+// Move-only type-erased callable, a lightweight replacement to std::function.
+// Lambdas up to 4 pointers in size are stored inline, without heap allocations.
+template<typename retT, typename ...argsT>
+class callable<retT(argsT...)> final {
+private:
+	static const size_t _INLINE_SIZE = 4 * sizeof(void*); // enough for [this] and a few more captures
+
+	using _invoke_fn = retT(*)(void*, argsT&&...);
+	using _manage_fn = void(*)(void*, void*); // move src into dest, or just destroy src if dest is null
+
+	alignas(void*) unsigned char _buf[_INLINE_SIZE];
+	_invoke_fn _invoke = nullptr;
+	_manage_fn _manage = nullptr;
+
+	template<typename funcT>
+	using _fits_inline = std::integral_constant<bool,
+		sizeof(funcT) <= _INLINE_SIZE &&
+		alignof(void*) % alignof(funcT) == 0 &&
+		std::is_nothrow_move_constructible<funcT>::value>;
+
+public:
+	~callable() {
+		this->_reset();
+	}
+
+	callable() = default;
+	callable(std::nullptr_t) noexcept { }
+	callable(callable&& other) noexcept { this->operator=(std::move(other)); }
+
+	template<typename funcT,
+		typename = typename std::enable_if<!std::is_same<typename std::decay<funcT>::type, callable>::value>::type>
+	callable(funcT&& func) {
+		this->_store(std::forward<funcT>(func), _fits_inline<typename std::decay<funcT>::type>{});
+	}
+
+	callable& operator=(callable&& other) noexcept {
+		if (this != &other) {
+			this->_reset();
+			if (other._manage) {
+				other._manage(&this->_buf, &other._buf);
+				this->_invoke = other._invoke;
+				this->_manage = other._manage;
+				other._invoke = nullptr;
+				other._manage = nullptr;
+			}
+		}
+		return *this;
+	}
+
+	explicit operator bool() const noexcept {
+		return this->_invoke != nullptr;
+	}
+
+	retT operator()(argsT... args) {
+		return this->_invoke(&this->_buf, std::forward<argsT>(args)...);
+	}
+
+private:
+	void _reset() noexcept {
+		if (this->_manage) {
+			this->_manage(nullptr, &this->_buf);
+			this->_invoke = nullptr;
+			this->_manage = nullptr;
+		}
+	}
+
+	template<typename funcT>
+	void _store(funcT&& func, std::true_type) { // inline storage
+		using fT = typename std::decay<funcT>::type;
+		new (&this->_buf) fT(std::forward<funcT>(func));
+
+		this->_invoke = [](void* pBuf, argsT&&... args) -> retT {
+			return (*reinterpret_cast<fT*>(pBuf))(std::forward<argsT>(args)...);
+		};
+		this->_manage = [](void* pDest, void* pSrc) noexcept -> void {
+			fT* pFunc = reinterpret_cast<fT*>(pSrc);
+			if (pDest) new (pDest) fT(std::move(*pFunc));
+			pFunc->~fT();
+		};
+	}
+
+	template<typename funcT>
+	void _store(funcT&& func, std::false_type) { // too big, or throwing move: heap storage
+		using fT = typename std::decay<funcT>::type;
+		new (&this->_buf) fT*(new fT(std::forward<funcT>(func)));
+
+		this->_invoke = [](void* pBuf, argsT&&... args) -> retT {
+			return (**reinterpret_cast<fT**>(pBuf))(std::forward<argsT>(args)...);
+		};
+		this->_manage = [](void* pDest, void* pSrc) noexcept -> void {
+			fT** ppFunc = reinterpret_cast<fT**>(pSrc);
+			if (pDest) {
+				new (pDest) fT*(*ppFunc); // just transfer pointer ownership
+			} else {
+				delete *ppFunc;
+			}
+		};
+	}
+};
+
+}//namespace _wli
+}//namespace wl
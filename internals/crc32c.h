@@ -0,0 +1,83 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "simd.h"
+
+namespace wl {
+namespace _wli {
+
+// CRC-32C (Castagnoli) checksum, with the SSE 4.2 instruction when AVX2 is enabled,
+// since every AVX2 processor has it; otherwise slicing-by-8 tables.
+class crc32c final {
+private:
+	crc32c() = delete;
+
+	struct _tables final {
+		uint32_t t[8][256];
+
+		_tables() noexcept {
+			for (uint32_t i = 0; i < 256; ++i) {
+				uint32_t crc = i;
+				for (int bit = 0; bit < 8; ++bit) {
+					crc = (crc >> 1) ^ (0x82F6'3B78 & (0u - (crc & 1))); // reversed Castagnoli polynomial
+				}
+				t[0][i] = crc;
+			}
+			for (uint32_t i = 0; i < 256; ++i) {
+				for (int slice = 1; slice < 8; ++slice) {
+					t[slice][i] = (t[slice - 1][i] >> 8) ^ t[0][t[slice - 1][i] & 0xFF];
+				}
+			}
+		}
+	};
+
+public:
+	// Continues a checksum with more data; start with zero.
+	static uint32_t update(uint32_t crc, const void* pData, size_t sz) noexcept {
+		const unsigned char* p = static_cast<const unsigned char*>(pData);
+		crc = ~crc;
+#if defined(WINLAMB_SIMD_AVX2)
+#if defined(_M_X64) || defined(__x86_64__)
+		for (; sz >= 8; p += 8, sz -= 8) {
+			uint64_t block;
+			memcpy(&block, p, 8);
+			crc = static_cast<uint32_t>(_mm_crc32_u64(crc, block));
+		}
+#endif
+		for (; sz; ++p, --sz) {
+			crc = _mm_crc32_u8(crc, *p);
+		}
+#else
+		static const _tables tabs; // built once, thread-safe
+		const uint32_t (*t)[256] = tabs.t;
+		for (; sz >= 8; p += 8, sz -= 8) {
+			uint32_t lo, hi;
+			memcpy(&lo, p, 4);
+			memcpy(&hi, p + 4, 4);
+			lo ^= crc;
+			crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+				t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+		}
+		for (; sz; ++p, --sz) {
+			crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xFF];
+		}
+#endif
+		return ~crc;
+	}
+
+	// Returns the checksum of the data.
+	static uint32_t of(const void* pData, size_t sz) noexcept {
+		return update(0, pData, sz);
+	}
+};
+
+}//namespace _wli
+}//namespace wl
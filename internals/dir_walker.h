@@ -0,0 +1,372 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "thread_pool.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <codecvt>
+#include <locale>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+namespace wl {
+namespace _wli {
+
+// A file or directory, with its metadata as returned by the directory listing.
+struct dir_entry final {
+	static constexpr uint32_t ATTR_HIDDEN = 0x2; // same values of FILE_ATTRIBUTE_*
+	static constexpr uint32_t ATTR_DIRECTORY = 0x10;
+	static constexpr uint32_t ATTR_REPARSE_POINT = 0x400;
+
+	std::wstring path;
+	uint64_t     size = 0;
+	uint32_t     attributes = 0;
+	uint64_t     creation = 0; // dates as FILETIME, 100-nanosecond intervals since 1601
+	uint64_t     lastAccess = 0;
+	uint64_t     lastWrite = 0;
+
+	bool is_dir() const noexcept    { return (this->attributes & ATTR_DIRECTORY) != 0; }
+	bool is_hidden() const noexcept { return (this->attributes & ATTR_HIDDEN) != 0; }
+	bool is_link() const noexcept   { return (this->attributes & ATTR_REPARSE_POINT) != 0; }
+};
+
+// Lists directories and queries metadata, one system call per entry at most.
+class dir_scan_backend final {
+private:
+	dir_scan_backend() = delete;
+
+public:
+#ifdef _WIN32
+	static constexpr wchar_t SEPARATOR = L'\\';
+
+	// Calls onEntry(dir_entry&&) for each entry of the directory, except "." and "..".
+	template<typename funcT>
+	static std::error_code scan(const std::wstring& dirPath, funcT&& onEntry) {
+		std::wstring pattern;
+		pattern.reserve(dirPath.size() + 2);
+		pattern.append(dirPath).append(1, SEPARATOR).append(1, L'*');
+
+		WIN32_FIND_DATAW wfd{};
+		HANDLE hFind = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &wfd, // no short names
+			FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+		if (hFind == INVALID_HANDLE_VALUE) {
+			DWORD err = GetLastError();
+			return {err == ERROR_FILE_NOT_FOUND ? 0 : static_cast<int>(err), std::system_category()};
+		}
+
+		try {
+			do {
+				if (_is_dot_or_dot_dot(wfd.cFileName)) continue;
+				dir_entry entry;
+				size_t nameLen = lstrlenW(wfd.cFileName);
+				entry.path.reserve(dirPath.size() + 1 + nameLen);
+				entry.path.append(dirPath).append(1, SEPARATOR).append(wfd.cFileName, nameLen);
+				entry.size = (static_cast<uint64_t>(wfd.nFileSizeHigh) << 32) | wfd.nFileSizeLow;
+				entry.attributes = wfd.dwFileAttributes;
+				entry.creation = _ticks_of(wfd.ftCreationTime);
+				entry.lastAccess = _ticks_of(wfd.ftLastAccessTime);
+				entry.lastWrite = _ticks_of(wfd.ftLastWriteTime);
+				onEntry(std::move(entry));
+			} while (FindNextFileW(hFind, &wfd));
+		} catch (...) { // thrown by onEntry
+			FindClose(hFind);
+			throw;
+		}
+
+		DWORD err = GetLastError();
+		FindClose(hFind);
+		return {err == ERROR_NO_MORE_FILES ? 0 : static_cast<int>(err), std::system_category()};
+	}
+
+	// Retrieves the metadata of a single file or directory.
+	static std::error_code stat(const std::wstring& path, dir_entry& entry) {
+		WIN32_FILE_ATTRIBUTE_DATA fad{};
+		if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &fad)) {
+			return {static_cast<int>(GetLastError()), std::system_category()};
+		}
+		entry.path = path;
+		entry.size = (static_cast<uint64_t>(fad.nFileSizeHigh) << 32) | fad.nFileSizeLow;
+		entry.attributes = fad.dwFileAttributes;
+		entry.creation = _ticks_of(fad.ftCreationTime);
+		entry.lastAccess = _ticks_of(fad.ftLastAccessTime);
+		entry.lastWrite = _ticks_of(fad.ftLastWriteTime);
+		return {};
+	}
+
+	// Paths are case-insensitive, so the key of a path is its lowercase version.
+	static std::wstring key_of(const std::wstring& path) {
+		std::wstring key = path;
+		if (!key.empty()) CharLowerBuffW(&key[0], static_cast<DWORD>(key.size()));
+		return key;
+	}
+
+private:
+	static uint64_t _ticks_of(const FILETIME& ft) noexcept {
+		return (static_cast<uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+	}
+#else
+	static constexpr wchar_t SEPARATOR = L'/';
+
+	template<typename funcT>
+	static std::error_code scan(const std::wstring& dirPath, funcT&& onEntry) {
+		DIR* pDir = opendir(_narrow(dirPath).c_str());
+		if (!pDir) {
+			return {errno, std::system_category()};
+		}
+
+		int fdDir = dirfd(pDir);
+		errno = 0;
+		try {
+			while (dirent* pEnt = readdir(pDir)) {
+				if (_is_dot_or_dot_dot(pEnt->d_name)) continue;
+				struct stat st{};
+				if (fstatat(fdDir, pEnt->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) { // deleted meanwhile
+					errno = 0; // or the end of the listing would be taken as a readdir() error
+					continue;
+				}
+				dir_entry entry;
+				std::wstring name = _widen(pEnt->d_name);
+				entry.path.reserve(dirPath.size() + 1 + name.size());
+				entry.path.append(dirPath).append(1, SEPARATOR).append(name);
+				_fill(entry, st, pEnt->d_name[0] == '.');
+				onEntry(std::move(entry));
+				errno = 0;
+			}
+		} catch (...) {
+			closedir(pDir);
+			throw;
+		}
+
+		int err = errno;
+		closedir(pDir);
+		return {err, std::system_category()};
+	}
+
+	static std::error_code stat(const std::wstring& path, dir_entry& entry) {
+		struct stat st{};
+		if (lstat(_narrow(path).c_str(), &st) != 0) {
+			return {errno, std::system_category()};
+		}
+		size_t slash = path.find_last_of(SEPARATOR);
+		entry.path = path;
+		_fill(entry, st, path[slash == std::wstring::npos ? 0 : slash + 1] == L'.');
+		return {};
+	}
+
+	static std::wstring key_of(const std::wstring& path) {
+		return path;
+	}
+
+private:
+	static void _fill(dir_entry& entry, const struct stat& st, bool dotFile) noexcept {
+		entry.size = S_ISREG(st.st_mode) ? static_cast<uint64_t>(st.st_size) : 0;
+		entry.attributes = (S_ISDIR(st.st_mode) ? dir_entry::ATTR_DIRECTORY : 0) |
+			(S_ISLNK(st.st_mode) ? dir_entry::ATTR_REPARSE_POINT : 0) |
+			(dotFile ? dir_entry::ATTR_HIDDEN : 0);
+		entry.creation = _ticks_of(st.st_ctim); // status change, the nearest to a creation date
+		entry.lastAccess = _ticks_of(st.st_atim);
+		entry.lastWrite = _ticks_of(st.st_mtim);
+	}
+
+	static uint64_t _ticks_of(const timespec& ts) noexcept {
+		return (static_cast<uint64_t>(ts.tv_sec) + 11'644'473'600) * 10'000'000 + ts.tv_nsec / 100;
+	}
+
+	static std::string _narrow(const std::wstring& s) {
+		return _converter().to_bytes(s);
+	}
+
+	static std::wstring _widen(const char* s) {
+		return _converter().from_bytes(s);
+	}
+
+	static std::wstring_convert<std::codecvt_utf8<wchar_t>>& _converter() {
+		static thread_local std::wstring_convert<std::codecvt_utf8<wchar_t>> conv{"?", L"?"}; // costly to build
+		return conv;
+	}
+#endif
+
+private:
+	template<typename charT>
+	static bool _is_dot_or_dot_dot(const charT* name) noexcept {
+		return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+	}
+};
+
+// Recursive directory listing, run in parallel: each thread takes directories from its
+// own queue, depth-first, and steals from the others when it runs out.
+class dir_walker final {
+private:
+	dir_walker() = delete;
+
+	struct _queue final {
+		std::mutex               mtx;
+		std::deque<std::wstring> dirs; // owner pops from back, thieves steal from front
+		std::vector<dir_entry>   found;
+	};
+
+	struct _walk final {
+		std::unique_ptr<_queue[]> queues;
+		size_t                    numQueues = 0;
+		std::atomic<size_t>       nextQueue{1}; // zero belongs to the calling thread
+		std::atomic<size_t>       pendingDirs{0}; // queued or being scanned
+		std::atomic<size_t>       queuedDirs{0};
+		std::atomic<bool>         failed{false};
+		std::mutex                mtx; // guards curExcept and the sleeping
+		std::condition_variable   cv;
+		std::exception_ptr        curExcept; // first one thrown
+	};
+
+public:
+	// Lists all entries under the directory, which itself isn't listed, in no particular
+	// order. If filter(const dir_entry&) returns false, the entry is left out and, if a
+	// directory, not descended into. Directories which can't be read are skipped, except
+	// the root one; symbolic links and junctions are never followed.
+	template<typename filterT>
+	static std::vector<dir_entry> walk(const std::wstring& rootDir, filterT&& filter) {
+		std::wstring root = rootDir;
+		while (root.size() > 1 && root.back() == dir_scan_backend::SEPARATOR) root.pop_back();
+
+		std::shared_ptr<_walk> pWalk = std::make_shared<_walk>(); // helpers may start after we return
+		size_t numHelpers = std::thread::hardware_concurrency();
+		pWalk->numQueues = numHelpers + 1;
+		pWalk->queues.reset(new _queue[pWalk->numQueues]);
+
+		std::error_code err = _scan_dir(*pWalk, 0, root, filter); // errors below the root are ignored
+		if (err) {
+			throw std::system_error(err, "Failed to list directory");
+		}
+
+		// A helper only touches the filter while a directory is pending, which can't happen once all are done.
+		for (size_t h = 0; h < numHelpers && pWalk->pendingDirs > 0; ++h) {
+			thread_pool::instance().submit(thread_pool::priority::HIGH, [pWalk, &filter]() noexcept -> void {
+				size_t idx = pWalk->nextQueue++;
+				if (idx < pWalk->numQueues) _run(*pWalk, idx, filter);
+			});
+		}
+		_run(*pWalk, 0, filter);
+
+		if (pWalk->curExcept) std::rethrow_exception(pWalk->curExcept);
+		std::vector<dir_entry> all = std::move(pWalk->queues[0].found);
+		for (size_t q = 1; q < pWalk->numQueues; ++q) {
+			std::lock_guard<std::mutex> lk(pWalk->queues[q].mtx);
+			std::vector<dir_entry>& found = pWalk->queues[q].found;
+			all.insert(all.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+			found.clear();
+		}
+		return all;
+	}
+
+private:
+	template<typename filterT>
+	static void _run(_walk& walk, size_t idx, filterT& filter) noexcept {
+		std::wstring dirPath;
+		for (;;) {
+			if (_pop(walk, idx, dirPath)) {
+				if (!walk.failed) {
+					try {
+						_scan_dir(walk, idx, dirPath, filter);
+					} catch (...) {
+						std::lock_guard<std::mutex> lk(walk.mtx);
+						if (!walk.curExcept) walk.curExcept = std::current_exception();
+						walk.failed = true; // the remaining directories are just drained
+					}
+				}
+				if (--walk.pendingDirs == 0) {
+					std::lock_guard<std::mutex> lk(walk.mtx);
+					walk.cv.notify_all();
+				}
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lk(walk.mtx);
+			walk.cv.wait(lk, [&walk]() noexcept -> bool {
+				return walk.pendingDirs == 0 || walk.queuedDirs > 0;
+			});
+			if (walk.pendingDirs == 0) break;
+		}
+	}
+
+	static bool _pop(_walk& walk, size_t idx, std::wstring& dirPath) noexcept {
+		if (walk.queuedDirs == 0) return false;
+		{
+			_queue& own = walk.queues[idx];
+			std::lock_guard<std::mutex> lk(own.mtx);
+			if (!own.dirs.empty()) {
+				dirPath = std::move(own.dirs.back());
+				own.dirs.pop_back();
+				--walk.queuedDirs;
+				return true;
+			}
+		}
+		for (size_t i = 1; i < walk.numQueues; ++i) {
+			_queue& victim = walk.queues[(idx + i) % walk.numQueues];
+			std::lock_guard<std::mutex> lk(victim.mtx);
+			if (!victim.dirs.empty()) {
+				dirPath = std::move(victim.dirs.front());
+				victim.dirs.pop_front();
+				--walk.queuedDirs;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template<typename filterT>
+	static std::error_code _scan_dir(_walk& walk, size_t idx, const std::wstring& dirPath, filterT& filter) {
+		std::vector<dir_entry> found;
+		std::vector<std::wstring> subdirs;
+		std::error_code err = dir_scan_backend::scan(dirPath, [&](dir_entry&& entry) -> void {
+			if (!filter(static_cast<const dir_entry&>(entry))) return;
+			if (entry.is_dir() && !entry.is_link()) subdirs.emplace_back(entry.path);
+			found.emplace_back(std::move(entry));
+		});
+
+		_queue& own = walk.queues[idx];
+		{
+			std::lock_guard<std::mutex> lk(own.mtx); // results go in before the directory is done
+			if (own.found.empty()) {
+				own.found = std::move(found);
+			} else {
+				own.found.insert(own.found.end(),
+					std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+			}
+			if (!subdirs.empty()) {
+				walk.pendingDirs += subdirs.size();
+				walk.queuedDirs += subdirs.size();
+				for (std::wstring& sub : subdirs) own.dirs.emplace_back(std::move(sub));
+			}
+		}
+		if (!subdirs.empty()) {
+			std::lock_guard<std::mutex> lk(walk.mtx); // so a sleeping thread can't miss the wake-up
+			walk.cv.notify_all();
+		}
+		return err;
+	}
+};
+
+}//namespace _wli
+}//namespace wl
@@ -0,0 +1,299 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include "callable.h"
+#include "thread_pool.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#include "ui_queue.h"
+#else
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+namespace wl {
+namespace _wli {
+
+// Positional reads and writes, which don't use nor need a file pointer, so many can
+// run at once on the same file. On Windows, the handle should have been opened with
+// FILE_FLAG_OVERLAPPED: a synchronous one serializes the calls and moves its pointer.
+class file_aio_backend final {
+private:
+	file_aio_backend() = delete;
+
+	static constexpr size_t _MAX_IO = 0x40000000; // 1 GB per system call, so the count fits any API
+
+public:
+#ifdef _WIN32
+	using native_handle = HANDLE;
+
+	static std::error_code read_at(native_handle h, uint64_t offset, void* pDest, size_t sz, size_t& done) noexcept {
+		done = 0;
+		while (done < sz) {
+			OVERLAPPED ov{};
+			if (!_prepare(ov, offset + done)) {
+				return {static_cast<int>(GetLastError()), std::system_category()};
+			}
+			DWORD numRead = 0;
+			if (!ReadFile(h, static_cast<BYTE*>(pDest) + done,
+				static_cast<DWORD>(std::min(sz - done, _MAX_IO)), &numRead, &ov) &&
+				!_wait(h, ov, numRead))
+			{
+				DWORD err = GetLastError();
+				if (err == ERROR_HANDLE_EOF) break;
+				return {static_cast<int>(err), std::system_category()};
+			}
+			if (!numRead) break; // end of file
+			done += numRead;
+		}
+		return {};
+	}
+
+	static std::error_code write_at(native_handle h, uint64_t offset, const void* pSrc, size_t sz, size_t& done) noexcept {
+		done = 0;
+		while (done < sz) {
+			OVERLAPPED ov{};
+			if (!_prepare(ov, offset + done)) {
+				return {static_cast<int>(GetLastError()), std::system_category()};
+			}
+			DWORD numWritten = 0;
+			if (!WriteFile(h, static_cast<const BYTE*>(pSrc) + done,
+				static_cast<DWORD>(std::min(sz - done, _MAX_IO)), &numWritten, &ov) &&
+				!_wait(h, ov, numWritten))
+			{
+				return {static_cast<int>(GetLastError()), std::system_category()};
+			}
+			done += numWritten;
+		}
+		return {};
+	}
+
+private:
+	static bool _prepare(OVERLAPPED& ov, uint64_t offset) noexcept {
+		ov.Offset = static_cast<DWORD>(offset & 0xFFFF'FFFF);
+		ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+		ov.hEvent = _thread_event(); // each thread waits on its own, since many requests run at once
+		return ov.hEvent != nullptr;
+	}
+
+	static bool _wait(native_handle h, OVERLAPPED& ov, DWORD& numTransferred) noexcept {
+		return GetLastError() == ERROR_IO_PENDING &&
+			GetOverlappedResult(h, &ov, &numTransferred, TRUE);
+	}
+
+	static HANDLE _thread_event() noexcept {
+		struct _event final {
+			HANDLE h = CreateEventW(nullptr, TRUE, FALSE, nullptr); // manual-reset, as overlapped I/O requires
+			~_event() { if (this->h) CloseHandle(this->h); }
+		};
+		static thread_local _event ev;
+		return ev.h;
+	}
+#else
+	using native_handle = int;
+
+	static std::error_code read_at(native_handle fd, uint64_t offset, void* pDest, size_t sz, size_t& done) noexcept {
+		done = 0;
+		while (done < sz) {
+			ssize_t numRead = pread(fd, static_cast<char*>(pDest) + done,
+				std::min(sz - done, _MAX_IO), static_cast<off_t>(offset + done));
+			if (numRead < 0) {
+				if (errno == EINTR) continue;
+				return {errno, std::system_category()};
+			}
+			if (!numRead) break; // end of file
+			done += static_cast<size_t>(numRead);
+		}
+		return {};
+	}
+
+	static std::error_code write_at(native_handle fd, uint64_t offset, const void* pSrc, size_t sz, size_t& done) noexcept {
+		done = 0;
+		while (done < sz) {
+			ssize_t numWritten = pwrite(fd, static_cast<const char*>(pSrc) + done,
+				std::min(sz - done, _MAX_IO), static_cast<off_t>(offset + done));
+			if (numWritten < 0) {
+				if (errno == EINTR) continue;
+				return {errno, std::system_category()};
+			}
+			done += static_cast<size_t>(numWritten);
+		}
+		return {};
+	}
+#endif
+};
+
+// Asynchronous reads and writes at given offsets of a file, run by the process-wide
+// thread pool. Many requests can be in flight at once, and big ones are split into
+// chunks which run in parallel. The buffers must stay valid until the completion.
+class file_aio final {
+public:
+	using native_handle = file_aio_backend::native_handle;
+
+	// Outcome of a request: the error, if any, and the number of bytes transferred,
+	// which for a read can be less than requested if the end of the file was reached.
+	struct result final {
+		std::error_code error;
+		size_t          transferred = 0;
+	};
+
+	static constexpr size_t CHUNK = 4 * 1024 * 1024; // bytes of each task a request is split into
+
+private:
+	struct _tracker final { // shared with the running tasks, which may outlive the file_aio
+		std::mutex              mtx;
+		std::condition_variable cv;
+		size_t                  inFlight = 0;
+	};
+
+	struct _request final {
+		std::atomic<size_t>    chunksLeft;
+		std::atomic<size_t>    transferred{0};
+		std::mutex             mtx; // guards error
+		std::error_code        error; // first one, if any
+		callable<void(result)> onDone;
+	};
+
+	native_handle             _h;
+	std::shared_ptr<_tracker> _pTracker{std::make_shared<_tracker>()};
+
+public:
+	~file_aio() {
+		this->wait();
+	}
+
+	explicit file_aio(native_handle h) noexcept : _h(h) { }
+
+	file_aio(const file_aio&) = delete;
+	file_aio& operator=(const file_aio&) = delete;
+
+	// Number of requests not yet completed.
+	size_t in_flight() const noexcept {
+		std::lock_guard<std::mutex> lk(this->_pTracker->mtx);
+		return this->_pTracker->inFlight;
+	}
+
+	// Blocks until all requests are completed; must not be called from a completion callback.
+	void wait() const noexcept {
+		std::unique_lock<std::mutex> lk(this->_pTracker->mtx);
+		this->_pTracker->cv.wait(lk, [this]() noexcept -> bool {
+			return this->_pTracker->inFlight == 0;
+		});
+	}
+
+	// Reads sz bytes at offset into pDest; onDone is called in a thread from the pool.
+	void read(uint64_t offset, void* pDest, size_t sz, callable<void(result)> onDone) {
+		this->_submit(offset, static_cast<char*>(pDest), sz, false, std::move(onDone));
+	}
+
+	// Writes sz bytes from pSrc at offset, expanding the file if needed; onDone is
+	// called in a thread from the pool.
+	void write(uint64_t offset, const void* pSrc, size_t sz, callable<void(result)> onDone) {
+		this->_submit(offset, const_cast<char*>(static_cast<const char*>(pSrc)), sz, true, std::move(onDone));
+	}
+
+#ifdef _WIN32
+	// Reads sz bytes at offset into pDest; onDone is called in the UI thread, unless
+	// the window is gone.
+	void read(uint64_t offset, void* pDest, size_t sz, const ui_context& ctx, callable<void(result)> onDone) {
+		this->read(offset, pDest, sz, _post_to(ctx, std::move(onDone)));
+	}
+
+	// Writes sz bytes from pSrc at offset, expanding the file if needed; onDone is
+	// called in the UI thread, unless the window is gone.
+	void write(uint64_t offset, const void* pSrc, size_t sz, const ui_context& ctx, callable<void(result)> onDone) {
+		this->write(offset, pSrc, sz, _post_to(ctx, std::move(onDone)));
+	}
+
+private:
+	static callable<void(result)> _post_to(const ui_context& ctx, callable<void(result)> onDone) {
+		if (!onDone) return nullptr;
+		return [ctx, onDone = std::move(onDone)](result res) mutable -> void { // called only once
+			ctx.post([onDone = std::move(onDone), res]() mutable -> void {
+				onDone(res);
+			});
+		};
+	}
+#endif
+
+private:
+	void _submit(uint64_t offset, char* pData, size_t sz, bool isWrite, callable<void(result)> onDone) {
+		size_t numChunks = std::max<size_t>(1, (sz + CHUNK - 1) / CHUNK); // a zero-length request still completes
+		std::shared_ptr<_request> pReq = std::make_shared<_request>();
+		pReq->chunksLeft = numChunks;
+		pReq->onDone = std::move(onDone);
+
+		{
+			std::lock_guard<std::mutex> lk(this->_pTracker->mtx);
+			++this->_pTracker->inFlight;
+		}
+
+		size_t c = 0;
+		try {
+			for (; c < numChunks; ++c) {
+				size_t chunkOff = c * CHUNK;
+				size_t chunkSz = std::min(CHUNK, sz - chunkOff);
+				thread_pool::instance().submit(thread_pool::priority::NORMAL,
+					[h = this->_h, pTracker = this->_pTracker, pReq,
+						chunkOffset = offset + chunkOff, pChunk = pData + chunkOff, chunkSz, isWrite]() noexcept -> void
+					{
+						size_t done = 0;
+						std::error_code err = isWrite ?
+							file_aio_backend::write_at(h, chunkOffset, pChunk, chunkSz, done) :
+							file_aio_backend::read_at(h, chunkOffset, pChunk, chunkSz, done);
+						pReq->transferred += done;
+						if (err) _fail(*pReq, err);
+						if (--pReq->chunksLeft == 0) _complete(*pTracker, *pReq);
+					});
+			}
+		} catch (const std::exception& e) {
+			if (c == 0) { // nothing was queued, so the request never existed
+				_release(*this->_pTracker);
+				throw;
+			}
+
+			// Queued chunks are already using the buffer, so the request can't be withdrawn:
+			// the chunks never queued are dropped, and it fails through onDone.
+			const std::system_error* pSysErr = dynamic_cast<const std::system_error*>(&e);
+			_fail(*pReq, pSysErr ? pSysErr->code() : std::make_error_code(std::errc::not_enough_memory));
+			if ((pReq->chunksLeft -= numChunks - c) == 0) _complete(*this->_pTracker, *pReq);
+		}
+	}
+
+	static void _fail(_request& req, std::error_code err) noexcept {
+		std::lock_guard<std::mutex> lk(req.mtx);
+		if (!req.error) req.error = err; // keep the first one
+	}
+
+	static void _complete(_tracker& tracker, _request& req) noexcept {
+		if (req.onDone) {
+			try {
+				req.onDone(result{req.error, req.transferred});
+			} catch (...) { } // the callback must route its own exceptions
+			req.onDone = nullptr; // release captures before the request is seen as completed
+		}
+		_release(tracker);
+	}
+
+	static void _release(_tracker& tracker) noexcept {
+		std::lock_guard<std::mutex> lk(tracker.mtx);
+		if (--tracker.inFlight == 0) tracker.cv.notify_all();
+	}
+};
+
+}//namespace _wli
+}//namespace wl
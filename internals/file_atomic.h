@@ -0,0 +1,164 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <atomic>
+#include <string>
+#include <system_error>
+#include "file_aio.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <codecvt>
+#include <locale>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace wl {
+namespace _wli {
+
+#ifndef _WIN32
+using BYTE = unsigned char;
+#endif
+
+// Replaces the content of a file at once: the data goes to a temporary file in the
+// same directory, which is then renamed over the target, so a crash leaves either the
+// old content or the new one, never a mix. An existing file keeps its attributes and
+// security descriptor on Windows, and its permission bits elsewhere.
+class file_atomic_backend final {
+private:
+	file_atomic_backend() = delete;
+
+public:
+	// How much survives a power loss, besides the atomicity.
+	enum class durability {
+		NONE, // the system writes the data later; fastest, but power loss may leave an empty file
+		DATA, // data is on the disk before the rename
+		FULL  // the rename is on the disk too, before returning
+	};
+
+#ifdef _WIN32
+	static std::error_code write(const std::wstring& filePath, const BYTE* pData, size_t sz, durability dur) {
+		std::wstring tmpPath = _temp_path_for(filePath, GetCurrentProcessId());
+		HANDLE hFile = CreateFileW(tmpPath.c_str(), GENERIC_WRITE, 0, nullptr,
+			CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (hFile == INVALID_HANDLE_VALUE) {
+			return {static_cast<int>(GetLastError()), std::system_category()};
+		}
+
+		size_t written = 0;
+		std::error_code err = file_aio_backend::write_at(hFile, 0, pData, sz, written);
+		if (!err && dur != durability::NONE && !FlushFileBuffers(hFile)) {
+			err.assign(static_cast<int>(GetLastError()), std::system_category());
+		}
+		CloseHandle(hFile);
+
+		if (!err) err = _replace(filePath, tmpPath, dur);
+		if (err) DeleteFileW(tmpPath.c_str());
+		return err;
+	}
+
+private:
+	static std::error_code _replace(const std::wstring& filePath, const std::wstring& tmpPath, durability dur) noexcept {
+		// ReplaceFile keeps attributes, ACLs and creation date of the replaced file, which
+		// a plain rename would lose; it fails if there's no file to be replaced.
+		if (GetFileAttributesW(filePath.c_str()) != INVALID_FILE_ATTRIBUTES) {
+			if (ReplaceFileW(filePath.c_str(), tmpPath.c_str(), nullptr,
+				REPLACEFILE_IGNORE_MERGE_ERRORS, nullptr, nullptr))
+			{
+				return dur == durability::FULL ? _flush_metadata(filePath) : std::error_code{};
+			}
+			DWORD err = GetLastError();
+			if (err != ERROR_FILE_NOT_FOUND) { // if deleted meanwhile, it's just renamed below
+				return {static_cast<int>(err), std::system_category()};
+			}
+		}
+
+		if (!MoveFileExW(tmpPath.c_str(), filePath.c_str(),
+			MOVEFILE_REPLACE_EXISTING | (dur == durability::FULL ? MOVEFILE_WRITE_THROUGH : 0)))
+		{
+			return {static_cast<int>(GetLastError()), std::system_category()};
+		}
+		return {};
+	}
+
+	static std::error_code _flush_metadata(const std::wstring& filePath) noexcept {
+		// ReplaceFile has no write-through flag, so the replaced file is flushed, metadata included.
+		HANDLE hFile = CreateFileW(filePath.c_str(), GENERIC_WRITE,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, 0, nullptr);
+		if (hFile == INVALID_HANDLE_VALUE) {
+			return {static_cast<int>(GetLastError()), std::system_category()};
+		}
+		std::error_code err;
+		if (!FlushFileBuffers(hFile)) {
+			err.assign(static_cast<int>(GetLastError()), std::system_category());
+		}
+		CloseHandle(hFile);
+		return err;
+	}
+#else
+	static std::error_code write(const std::wstring& filePath, const BYTE* pData, size_t sz, durability dur) {
+		std::string path = _narrow(filePath);
+		std::string tmpPath = _narrow(_temp_path_for(filePath, static_cast<unsigned>(getpid())));
+		int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+		if (fd < 0) {
+			return {errno, std::system_category()};
+		}
+
+		std::error_code err;
+		struct stat st{};
+		if (stat(path.c_str(), &st) == 0 && // an existing file keeps its mode, instead of 0666 & ~umask
+			fchmod(fd, st.st_mode & 07777) != 0)
+		{
+			err.assign(errno, std::system_category());
+		}
+
+		size_t written = 0;
+		if (!err) err = file_aio_backend::write_at(fd, 0, pData, sz, written);
+		if (!err && dur != durability::NONE && fsync(fd) != 0) {
+			err.assign(errno, std::system_category());
+		}
+		close(fd);
+
+		if (!err && rename(tmpPath.c_str(), path.c_str()) != 0) {
+			err.assign(errno, std::system_category());
+		}
+		if (err) {
+			unlink(tmpPath.c_str());
+		} else if (dur == durability::FULL) { // the rename is persisted by syncing the directory
+			size_t slash = path.find_last_of('/');
+			int fdDir = open(slash == std::string::npos ? "." : path.substr(0, slash + 1).c_str(), O_RDONLY | O_CLOEXEC);
+			if (fdDir >= 0) {
+				if (fsync(fdDir) != 0) err.assign(errno, std::system_category());
+				close(fdDir);
+			}
+		}
+		return err;
+	}
+
+private:
+	static std::string _narrow(const std::wstring& s) {
+		return std::wstring_convert<std::codecvt_utf8<wchar_t>>{"?", L"?"}.to_bytes(s);
+	}
+#endif
+
+private:
+	static std::wstring _temp_path_for(const std::wstring& filePath, unsigned processId) {
+		static std::atomic<unsigned> counter{0}; // unique within the process, the id makes it unique among processes
+		std::wstring tmpPath = filePath;
+		tmpPath.append(L".").append(std::to_wstring(processId))
+			.append(L".").append(std::to_wstring(++counter)).append(L".tmp");
+		return tmpPath;
+	}
+};
+
+}//namespace _wli
+}//namespace wl
@@ -0,0 +1,128 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <chrono>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+#include "dir_walker.h"
+
+namespace wl {
+namespace _wli {
+
+// Metadata of files and directories, queried once and then kept until invalidated or,
+// if a maximum age is given, until it expires. Entries can also be filled in bulk
+// with the results of a directory walk. Thread-safe.
+class file_metadata_cache final {
+private:
+	using _clock = std::chrono::steady_clock;
+
+	struct _item final {
+		dir_entry         entry;
+		_clock::time_point added;
+	};
+
+	mutable std::mutex                      _mtx;
+	std::unordered_map<std::wstring, _item> _items; // keyed by dir_scan_backend::key_of()
+	_clock::duration                        _maxAge;
+
+public:
+	// A zero maximum age means entries never expire.
+	explicit file_metadata_cache(std::chrono::milliseconds maxAge = std::chrono::milliseconds{0})
+		: _maxAge{maxAge} { }
+
+	file_metadata_cache(const file_metadata_cache&) = delete;
+	file_metadata_cache& operator=(const file_metadata_cache&) = delete;
+
+	size_t size() const {
+		std::lock_guard<std::mutex> lk(this->_mtx);
+		return this->_items.size();
+	}
+
+	// Returns the metadata, querying the system if not cached or expired; throws if the
+	// path can't be queried.
+	dir_entry get(const std::wstring& path) {
+		dir_entry entry;
+		std::error_code err = this->_get(path, entry);
+		if (err) {
+			throw std::system_error(err, "Failed to query file metadata");
+		}
+		return entry;
+	}
+
+	// Tells whether the path exists, caching its metadata if so; failures are not cached.
+	bool exists(const std::wstring& path) {
+		dir_entry entry;
+		return !this->_get(path, entry);
+	}
+
+	// Caches entries already known, like the ones returned by a directory walk.
+	void insert(std::vector<dir_entry> entries) {
+		_clock::time_point now = _clock::now();
+		std::lock_guard<std::mutex> lk(this->_mtx);
+		for (dir_entry& entry : entries) {
+			std::wstring key = dir_scan_backend::key_of(entry.path);
+			this->_items[std::move(key)] = {std::move(entry), now};
+		}
+	}
+
+	// Forgets the path, which must be called when it's changed by the program.
+	void invalidate(const std::wstring& path) {
+		std::wstring key = dir_scan_backend::key_of(path);
+		std::lock_guard<std::mutex> lk(this->_mtx);
+		this->_items.erase(key);
+	}
+
+	// Forgets the directory and everything under it.
+	void invalidate_tree(const std::wstring& dirPath) {
+		std::wstring key = dir_scan_backend::key_of(dirPath);
+		while (key.size() > 1 && key.back() == dir_scan_backend::SEPARATOR) key.pop_back();
+		std::lock_guard<std::mutex> lk(this->_mtx);
+		for (auto it = this->_items.begin(); it != this->_items.end(); ) {
+			const std::wstring& k = it->first;
+			bool under = k.compare(0, key.size(), key) == 0 &&
+				(k.size() == key.size() || k[key.size()] == dir_scan_backend::SEPARATOR);
+			it = under ? this->_items.erase(it) : std::next(it);
+		}
+	}
+
+	// Forgets everything.
+	void clear() {
+		std::lock_guard<std::mutex> lk(this->_mtx);
+		this->_items.clear();
+	}
+
+private:
+	std::error_code _get(const std::wstring& path, dir_entry& entry) {
+		std::wstring key = dir_scan_backend::key_of(path);
+		{
+			std::lock_guard<std::mutex> lk(this->_mtx);
+			auto it = this->_items.find(key);
+			if (it != this->_items.end()) {
+				if (this->_maxAge == _clock::duration::zero() || _clock::now() - it->second.added < this->_maxAge) {
+					entry = it->second.entry;
+					return {};
+				}
+				this->_items.erase(it);
+			}
+		}
+
+		std::error_code err = dir_scan_backend::stat(path, entry); // not under the lock, it's a system call
+		if (!err) {
+			std::lock_guard<std::mutex> lk(this->_mtx);
+			this->_items[std::move(key)] = {entry, _clock::now()};
+		}
+		return err;
+	}
+};
+
+}//namespace _wli
+}//namespace wl
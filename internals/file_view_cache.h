@@ -0,0 +1,334 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace wl {
+namespace _wli {
+
+#ifndef _WIN32
+using BYTE = unsigned char;
+#endif
+
+// Maps and unmaps views of part of a file.
+class file_map_backend final {
+private:
+	file_map_backend() = delete;
+
+public:
+	// How the mapped memory is expected to be accessed.
+	enum class pattern { NORMAL, SEQUENTIAL, RANDOM };
+
+#ifdef _WIN32
+	using native_mapping = HANDLE; // from CreateFileMapping
+
+	// Offsets of views must be multiple of this.
+	static size_t granularity() noexcept {
+		static size_t gran = []() noexcept -> size_t {
+			SYSTEM_INFO si{};
+			GetSystemInfo(&si);
+			return si.dwAllocationGranularity;
+		}();
+		return gran;
+	}
+
+	static void* map(native_mapping hMap, uint64_t offset, size_t len, bool writable) {
+		void* p = MapViewOfFile(hMap, writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+			static_cast<DWORD>(offset >> 32), static_cast<DWORD>(offset & 0xFFFF'FFFF), len);
+		if (!p) {
+			throw std::system_error(GetLastError(), std::system_category(),
+				"MapViewOfFile failed to map a window of the file");
+		}
+		return p;
+	}
+
+	static void unmap(void* p, size_t) noexcept {
+		UnmapViewOfFile(p);
+	}
+
+	// Hints the system to read the pages in, with a single large I/O.
+	static void prefetch(void* p, size_t len) noexcept {
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602 // PrefetchVirtualMemory requires Windows 8
+		WIN32_MEMORY_RANGE_ENTRY range{p, len};
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+		(void)p; (void)len;
+#endif
+	}
+
+	// Writes the modified pages of the range to the file.
+	static void flush(void* p, size_t len) {
+		if (!FlushViewOfFile(p, len)) {
+			throw std::system_error(GetLastError(), std::system_category(),
+				"FlushViewOfFile failed");
+		}
+	}
+
+	// Page faults can't be tuned per view, so a sequential view is just read in at once.
+	static void advise(void* p, size_t len, pattern pat) noexcept {
+		if (pat == pattern::SEQUENTIAL) prefetch(p, len);
+	}
+#else
+	using native_mapping = int; // file descriptor
+
+	static size_t granularity() noexcept {
+		static size_t gran = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		return gran;
+	}
+
+	static void* map(native_mapping fd, uint64_t offset, size_t len, bool writable) {
+		void* p = mmap(nullptr, len, PROT_READ | (writable ? PROT_WRITE : 0),
+			MAP_SHARED, fd, static_cast<off_t>(offset));
+		if (p == MAP_FAILED) {
+			throw std::system_error(errno, std::system_category(),
+				"mmap failed to map a window of the file");
+		}
+		return p;
+	}
+
+	static void unmap(void* p, size_t len) noexcept {
+		munmap(p, len);
+	}
+
+	static void prefetch(void* p, size_t len) noexcept {
+		uintptr_t misalign = reinterpret_cast<uintptr_t>(p) % granularity(); // madvise wants a page boundary
+		madvise(static_cast<char*>(p) - misalign, len + misalign, MADV_WILLNEED);
+	}
+
+	static void flush(void* p, size_t len) {
+		uintptr_t misalign = reinterpret_cast<uintptr_t>(p) % granularity(); // msync wants a page boundary
+		if (msync(static_cast<char*>(p) - misalign, len + misalign, MS_SYNC) != 0) {
+			throw std::system_error(errno, std::system_category(),
+				"msync failed");
+		}
+	}
+
+	// Tunes the read-ahead of page faults; random access avoids reading megabytes around each fault.
+	static void advise(void* p, size_t len, pattern pat) noexcept {
+		madvise(p, len, pat == pattern::SEQUENTIAL ? MADV_SEQUENTIAL :
+			pat == pattern::RANDOM ? MADV_RANDOM : MADV_NORMAL);
+	}
+#endif
+};
+
+// Windows of a file mapped on demand, so files of any size can be accessed with a
+// bounded address space. A few views are kept alive and reused, the least recently
+// used one being unmapped when a new one is needed; pinned views are never unmapped.
+// Not thread-safe.
+class file_view_cache final {
+public:
+	using native_mapping = file_map_backend::native_mapping;
+
+private:
+	struct _view final {
+		uint64_t offset;
+		size_t   len;
+		BYTE*    pBase;
+		size_t   numPins;
+		uint64_t lastUse;
+	};
+
+	native_mapping                      _map{};
+	uint64_t                            _fileSize = 0;
+	size_t                              _windowSize = 0;
+	size_t                              _maxViews = 0;
+	bool                                _writable = false;
+	file_map_backend::pattern           _pattern = file_map_backend::pattern::NORMAL;
+	uint64_t                            _useClock = 0;
+	std::vector<std::unique_ptr<_view>> _views; // pinned ones can't move, so they're on the heap
+
+public:
+	// A range of the file, guaranteed to stay mapped while the object is alive. It
+	// must not outlive the file_view_cache which created it.
+	class pinned final {
+	private:
+		_view* _pView = nullptr; // null if not owned by a cache
+		BYTE*  _p = nullptr;
+		size_t _len = 0;
+
+	public:
+		~pinned() {
+			this->release();
+		}
+
+		pinned() = default;
+		pinned(_view* pView, BYTE* p, size_t len) noexcept : _pView{pView}, _p{p}, _len{len} {
+			if (this->_pView) ++this->_pView->numPins;
+		}
+
+		pinned(pinned&& other) noexcept { this->operator=(std::move(other)); }
+		pinned& operator=(pinned&& other) noexcept {
+			this->release();
+			std::swap(this->_pView, other._pView);
+			std::swap(this->_p, other._p);
+			std::swap(this->_len, other._len);
+			return *this;
+		}
+
+		BYTE*  data() const noexcept  { return this->_p; }
+		size_t size() const noexcept  { return this->_len; }
+		bool   empty() const noexcept { return this->_len == 0; }
+		BYTE*  begin() const noexcept { return this->_p; }
+		BYTE*  end() const noexcept   { return this->_p + this->_len; }
+		BYTE&  operator[](size_t index) const noexcept { return this->_p[index]; }
+
+		// Unpins the view, which may then be unmapped by the cache.
+		void release() noexcept {
+			if (this->_pView) --this->_pView->numPins;
+			this->_pView = nullptr;
+			this->_p = nullptr;
+			this->_len = 0;
+		}
+	};
+
+	~file_view_cache() {
+		this->_unmap_all();
+	}
+
+	file_view_cache() = default;
+	file_view_cache(const file_view_cache&) = delete;
+	file_view_cache& operator=(const file_view_cache&) = delete;
+
+	// Starts over with the given mapping; window size is rounded up to the granularity.
+	void reset(native_mapping hMap, uint64_t fileSize, size_t windowSize, size_t maxViews, bool writable) {
+		if (this->num_pinned()) {
+			throw std::logic_error("Views of the file are still pinned.");
+		}
+		this->_unmap_all();
+		size_t gran = file_map_backend::granularity();
+		this->_map = hMap;
+		this->_fileSize = fileSize;
+		this->_windowSize = std::max(gran, (windowSize + gran - 1) / gran * gran);
+		this->_maxViews = std::max<size_t>(maxViews, 1);
+		this->_writable = writable;
+	}
+
+	// Unmaps all views; none can be pinned.
+	void clear() {
+		this->reset(this->_map, this->_fileSize, this->_windowSize, this->_maxViews, this->_writable);
+	}
+
+	size_t window_size() const noexcept { return this->_windowSize; }
+	size_t max_views() const noexcept   { return this->_maxViews; }
+	file_map_backend::pattern access_pattern() const noexcept { return this->_pattern; }
+	size_t num_views() const noexcept   { return this->_views.size(); }
+
+	size_t num_pinned() const noexcept {
+		return static_cast<size_t>(std::count_if(this->_views.cbegin(), this->_views.cend(),
+			[](const std::unique_ptr<_view>& v) noexcept -> bool { return v->numPins > 0; }));
+	}
+
+	// Sets the expected access pattern of the current and future views.
+	void set_access_pattern(file_map_backend::pattern pat) noexcept {
+		this->_pattern = pat;
+		for (std::unique_ptr<_view>& v : this->_views) {
+			file_map_backend::advise(v->pBase, v->len, pat);
+		}
+	}
+
+	// Returns the range, pinned; len is clamped at the end of the file. A range bigger
+	// than the window gets a view of its own.
+	pinned view(uint64_t offset, size_t len) {
+		if (offset > this->_fileSize) {
+			throw std::invalid_argument("Offset is beyond end of file.");
+		}
+		len = static_cast<size_t>(std::min<uint64_t>(len, this->_fileSize - offset));
+		if (!len) return {};
+		_view& v = this->_view_of(offset, len);
+		return {&v, v.pBase + (offset - v.offset), len};
+	}
+
+	// Hints the system that the range will be accessed soon, mapping it if needed.
+	void prefetch(uint64_t offset, size_t len) {
+		if (offset >= this->_fileSize) return;
+		len = static_cast<size_t>(std::min<uint64_t>(len, this->_fileSize - offset));
+		while (len) { // one window at a time; pages read stay cached even if their view is evicted
+			size_t part = std::min(len, this->_windowSize - static_cast<size_t>(offset % this->_windowSize));
+			_view& v = this->_view_of(offset, part);
+			file_map_backend::prefetch(v.pBase + (offset - v.offset), part);
+			offset += part;
+			len -= part;
+		}
+	}
+
+	// Writes the modified pages of the range which are in live views to the file;
+	// views already unmapped were handed to the system to be written lazily.
+	void flush(uint64_t offset, size_t len) {
+		for (std::unique_ptr<_view>& v : this->_views) {
+			uint64_t first = std::max(offset, v->offset);
+			uint64_t past = std::min(offset + len, v->offset + v->len);
+			if (first < past) {
+				file_map_backend::flush(v->pBase + (first - v->offset), static_cast<size_t>(past - first));
+			}
+		}
+	}
+
+private:
+	_view& _view_of(uint64_t offset, size_t len) {
+		for (std::unique_ptr<_view>& v : this->_views) {
+			if (offset >= v->offset && offset + len <= v->offset + v->len) {
+				v->lastUse = ++this->_useClock;
+				return *v; // hit
+			}
+		}
+
+		// Views start at window boundaries, so sequential accesses share them.
+		uint64_t base = offset / this->_windowSize * this->_windowSize;
+		uint64_t end = std::max(base + this->_windowSize, offset + len);
+		size_t gran = file_map_backend::granularity();
+		end = std::min(this->_fileSize, (end + gran - 1) / gran * gran);
+		size_t mapLen = static_cast<size_t>(end - base);
+
+		if (this->_views.size() >= this->_maxViews) this->_evict_one();
+		std::unique_ptr<_view> pNew{new _view{base, mapLen,
+			static_cast<BYTE*>(file_map_backend::map(this->_map, base, mapLen, this->_writable)),
+			0, ++this->_useClock}};
+		if (this->_pattern != file_map_backend::pattern::NORMAL) {
+			file_map_backend::advise(pNew->pBase, pNew->len, this->_pattern);
+		}
+		this->_views.emplace_back(std::move(pNew));
+		return *this->_views.back();
+	}
+
+	void _evict_one() noexcept {
+		auto itLru = this->_views.end();
+		for (auto it = this->_views.begin(); it != this->_views.end(); ++it) {
+			if ((*it)->numPins == 0 && (itLru == this->_views.end() || (*it)->lastUse < (*itLru)->lastUse)) {
+				itLru = it;
+			}
+		}
+		if (itLru != this->_views.end()) { // if all are pinned, the cache just grows
+			file_map_backend::unmap((*itLru)->pBase, (*itLru)->len);
+			this->_views.erase(itLru);
+		}
+	}
+
+	void _unmap_all() noexcept {
+		for (std::unique_ptr<_view>& v : this->_views) {
+			file_map_backend::unmap(v->pBase, v->len);
+		}
+		this->_views.clear();
+	}
+};
+
+}//namespace _wli
+}//namespace wl
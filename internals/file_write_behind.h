@@ -0,0 +1,169 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "dir_walker.h"
+#include "file_atomic.h"
+
+namespace wl {
+namespace _wli {
+
+// Process-wide queue of whole-file writes, run in a background thread, each one
+// atomic. Saves of the same path waiting in the queue are coalesced, so only the last
+// content is written. Everything queued is written before the process exits normally.
+class file_write_behind final {
+private:
+	struct _pending final {
+		std::wstring                      path;
+		std::vector<BYTE>                 data;
+		file_atomic_backend::durability   dur;
+	};
+
+	std::mutex                                  _mtx;
+	std::condition_variable                     _cvWork, _cvIdle;
+	std::unordered_map<std::wstring, _pending>  _queue; // keyed by dir_scan_backend::key_of()
+	std::thread                                 _thread;
+	std::chrono::milliseconds                   _delay{50};
+	size_t                                      _numFlushing = 0; // threads waiting in flush()
+	bool                                        _busy = false, _stopping = false;
+	std::error_code                             _error; // first one since the last flush()
+
+public:
+	~file_write_behind() {
+		this->shutdown();
+	}
+
+	file_write_behind() = default;
+	file_write_behind(const file_write_behind&) = delete;
+	file_write_behind& operator=(const file_write_behind&) = delete;
+
+	// Returns the process-wide queue; the thread is only created at the first write.
+	static file_write_behind& instance() noexcept {
+		static file_write_behind queue;
+		return queue;
+	}
+
+	// Time a write waits in the queue, so further saves of the same path replace it.
+	void set_delay(std::chrono::milliseconds delay) {
+		std::lock_guard<std::mutex> lk(this->_mtx);
+		this->_delay = delay;
+	}
+
+	// Number of writes waiting in the queue.
+	size_t num_pending() {
+		std::lock_guard<std::mutex> lk(this->_mtx);
+		return this->_queue.size();
+	}
+
+	// Queues the write, replacing any waiting one for the same path.
+	void write(const std::wstring& filePath, std::vector<BYTE> data, file_atomic_backend::durability dur) {
+		std::wstring key = dir_scan_backend::key_of(filePath);
+		{
+			std::lock_guard<std::mutex> lk(this->_mtx);
+			if (!this->_thread.joinable()) {
+				this->_stopping = false;
+				this->_thread = std::thread([this]() noexcept -> void {
+					this->_worker_loop();
+				});
+			}
+			this->_queue[std::move(key)] = {filePath, std::move(data), dur};
+		}
+		this->_cvWork.notify_one();
+	}
+
+	// Blocks until all queued writes are done, then throws the first error, if any,
+	// since the last call.
+	void flush() {
+		std::unique_lock<std::mutex> lk(this->_mtx);
+		++this->_numFlushing;
+		this->_cvWork.notify_one(); // no need to wait the delay
+		this->_cvIdle.wait(lk, [this]() noexcept -> bool {
+			return this->_queue.empty() && !this->_busy;
+		});
+		--this->_numFlushing;
+
+		if (this->_error) {
+			std::error_code err = this->_error;
+			this->_error.clear();
+			throw std::system_error(err, "Failed to write file in background");
+		}
+	}
+
+	// Writes everything queued, then ends the thread; called by run_main() and at exit.
+	// Errors are lost, unless flush() is called before.
+	void shutdown() noexcept {
+		{
+			std::lock_guard<std::mutex> lk(this->_mtx);
+			if (!this->_thread.joinable()) return;
+			this->_stopping = true;
+		}
+		this->_cvWork.notify_one();
+		this->_thread.join();
+
+		std::unique_lock<std::mutex> lk(this->_mtx);
+		while (!this->_queue.empty()) { // queued while the thread was ending
+			this->_write_batch(lk);
+		}
+		std::unordered_map<std::wstring, _pending>{}.swap(this->_queue); // so nothing is reported by _CrtDumpMemoryLeaks()
+	}
+
+private:
+	void _worker_loop() noexcept {
+		std::unique_lock<std::mutex> lk(this->_mtx);
+		for (;;) {
+			this->_cvWork.wait(lk, [this]() noexcept -> bool {
+				return !this->_queue.empty() || this->_stopping;
+			});
+			if (this->_queue.empty()) break; // stopping, all written
+
+			this->_cvWork.wait_for(lk, this->_delay, [this]() noexcept -> bool { // coalescing window
+				return this->_stopping || this->_numFlushing > 0;
+			});
+
+			this->_write_batch(lk);
+		}
+		this->_cvIdle.notify_all();
+	}
+
+	void _write_batch(std::unique_lock<std::mutex>& lk) noexcept {
+		std::unordered_map<std::wstring, _pending> batch;
+		batch.swap(this->_queue);
+		this->_busy = true;
+		lk.unlock();
+
+		for (std::pair<const std::wstring, _pending>& item : batch) {
+			std::error_code err;
+			try {
+				err = file_atomic_backend::write(item.second.path,
+					item.second.data.data(), item.second.data.size(), item.second.dur);
+			} catch (...) { // only allocations can throw
+				err = std::make_error_code(std::errc::not_enough_memory);
+			}
+			if (err) {
+				std::lock_guard<std::mutex> lkErr(this->_mtx);
+				if (!this->_error) this->_error = err;
+			}
+		}
+		batch.clear(); // release the buffers outside the lock
+
+		lk.lock();
+		this->_busy = false;
+		if (this->_queue.empty()) this->_cvIdle.notify_all();
+	}
+};
+
+}//namespace _wli
+}//namespace wl
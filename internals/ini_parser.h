@@ -0,0 +1,407 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cwctype>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "str_builder.h"
+#include "str_decoder.h"
+#include "str_priv.h"
+#include "str_transcode.h"
+#include "text_arena.h"
+
+namespace wl {
+namespace _wli {
+
+// Contents of an INI file, parsed in a single pass straight from the raw bytes: each
+// line is decoded into a scratch buffer, and only names and values are stored, packed
+// in one arena. Sections and keys are found by hashing, and keep the file order.
+// Malformed lines are skipped, and reported with their line numbers.
+class ini_document final {
+public:
+	// A line which was skipped because it isn't valid INI.
+	struct issue final {
+		size_t      line; // one-based
+		const char* what;
+	};
+
+private:
+	static constexpr uint32_t _NONE = UINT32_MAX;
+
+	struct _section final {
+		uint32_t              name; // index in the arena
+		std::vector<uint32_t> entries; // indexes in _entries, in file order
+	};
+
+	struct _entry final {
+		uint32_t section, key, value; // value is replaced when the key is set again
+	};
+
+	// Open addressing table of indexes, which are compared by the caller.
+	class _hash_index final {
+	private:
+		struct _slot final {
+			uint32_t index = _NONE;
+			uint32_t hash = 0; // lower bits, to skip most comparisons
+		};
+		std::vector<_slot> _slots;
+		size_t             _count = 0;
+
+	public:
+		void clear() noexcept { this->_slots.clear(); this->_count = 0; }
+
+		template<typename equalsT>
+		uint32_t find(size_t hash, equalsT&& equals) const noexcept {
+			if (this->_slots.empty()) return _NONE;
+			size_t mask = this->_slots.size() - 1;
+			for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+				const _slot& s = this->_slots[i];
+				if (s.index == _NONE) return _NONE;
+				if (s.hash == static_cast<uint32_t>(hash) && equals(s.index)) return s.index;
+			}
+		}
+
+		void insert(size_t hash, uint32_t index) {
+			if ((this->_count + 1) * 2 > this->_slots.size()) { // load factor up to 50%
+				std::vector<_slot> old;
+				old.swap(this->_slots);
+				this->_slots.resize(old.empty() ? 64 : old.size() * 2);
+				for (const _slot& s : old) {
+					if (s.index != _NONE) this->_place(s);
+				}
+			}
+			this->_place({index, static_cast<uint32_t>(hash)});
+			++this->_count;
+		}
+
+	private:
+		void _place(const _slot& slot) noexcept {
+			size_t mask = this->_slots.size() - 1;
+			size_t i = slot.hash & mask; // the table never outgrows 32 bits of hash
+			while (this->_slots[i].index != _NONE) i = (i + 1) & mask;
+			this->_slots[i] = slot;
+		}
+	};
+
+	text_arena            _text;
+	std::vector<_section> _sections;
+	std::vector<_entry>   _entries;
+	_hash_index           _sectionIdx, _entryIdx;
+	std::vector<issue>    _issues;
+
+public:
+	size_t num_sections() const noexcept { return this->_sections.size(); }
+	size_t num_keys() const noexcept     { return this->_entries.size(); }
+	const std::vector<issue>& issues() const noexcept { return this->_issues; }
+
+	std::wstring_view section_name(size_t sectionIndex) const noexcept {
+		return this->_text[this->_sections[sectionIndex].name];
+	}
+
+	// Removes everything, keeping the memory.
+	ini_document& clear() noexcept {
+		this->_text.clear();
+		this->_sections.clear();
+		this->_entries.clear();
+		this->_sectionIdx.clear();
+		this->_entryIdx.clear();
+		this->_issues.clear();
+		return *this;
+	}
+
+	// Parses the raw file contents, guessing the encoding like str::to_wstring(); any
+	// previous contents are discarded. Keys repeated within a section keep the last value.
+	ini_document& parse(const BYTE* data, size_t sz) {
+		this->clear();
+		if (!data || !sz) return *this;
+
+		encoding_info enc = str_decoder::detect(data, sz);
+		data += enc.bomSize;
+		sz -= enc.bomSize;
+		this->_text.reserve(sz / 16, sz); // decoded text is never longer than the bytes
+
+		switch (enc.encType) {
+		case encoding::UNKNOWN:
+		case encoding::ASCII:
+			this->_parse_bytes(data, str_priv::len_before_null(data, sz), str_transcode::latin1_to_utf16);
+			break;
+		case encoding::WIN1252:
+			this->_parse_bytes(data, str_priv::len_before_null(data, sz), str_transcode::win1252_to_utf16);
+			break;
+		case encoding::UTF8:
+			this->_parse_bytes(data, str_priv::len_before_null(data, sz),
+				[](const BYTE* src, size_t len, wchar_t* dest) noexcept -> size_t {
+					return str_transcode::utf8_to_utf16(src, len, dest); // lines never split a valid sequence
+				});
+			break;
+		case encoding::UTF16BE:
+		case encoding::UTF16LE:
+			if (sz % 2 == 0 && !_has_bom_again(data, sz, enc.encType)) { // otherwise the decoder has subtleties
+				this->_parse_utf16(data, sz / 2, enc.encType == encoding::UTF16BE);
+				break;
+			}
+			[[fallthrough]];
+		default: {
+			std::wstring decoded = str_priv::parse_wide(data, sz, enc.encType); // UTF-32 is rare enough
+			const wchar_t* pDecoded = decoded.data();
+			this->_parse_lines(pDecoded, decoded.length(), 1,
+				[pDecoded](size_t i) noexcept -> wchar_t { return pDecoded[i]; },
+				[](const wchar_t* src, size_t len, wchar_t* dest) noexcept -> size_t {
+					std::copy(src, src + len, dest);
+					return len;
+				});
+		}
+		}
+		return *this;
+	}
+
+	// Tells whether the section exists.
+	bool has(std::wstring_view sectionName) const noexcept {
+		return this->_find_section(sectionName) != _NONE;
+	}
+
+	// Tells whether the key exists in the section.
+	bool has(std::wstring_view sectionName, std::wstring_view keyName) const noexcept {
+		return this->get_if_exists(sectionName, keyName) != nullptr;
+	}
+
+	// Returns the value, null-terminated, or null if the section or key doesn't exist.
+	const wchar_t* get_if_exists(std::wstring_view sectionName, std::wstring_view keyName) const noexcept {
+		uint32_t sec = this->_find_section(sectionName);
+		if (sec == _NONE) return nullptr;
+		uint32_t ent = this->_find_entry(sec, keyName);
+		return ent == _NONE ? nullptr : this->_text.c_str(this->_entries[ent].value);
+	}
+
+	// Sets the value, adding the section and the key if they don't exist.
+	ini_document& set(std::wstring_view sectionName, std::wstring_view keyName, std::wstring_view value) {
+		this->_set(this->_section(sectionName), keyName, value);
+		return *this;
+	}
+
+	// Calls func(std::wstring_view key, std::wstring_view value) for each key of the
+	// section, in file order.
+	template<typename funcT>
+	void for_each_key(size_t sectionIndex, funcT&& func) const {
+		for (uint32_t ent : this->_sections[sectionIndex].entries) {
+			func(this->_text[this->_entries[ent].key], this->_text[this->_entries[ent].value]);
+		}
+	}
+
+	// Merges the contents into a map of sections, like file_ini::sections, as if the
+	// lines were parsed into it: sections and keys already there keep their order and
+	// take the new values, the others are appended in file order. The map only has
+	// linear lookups, so its keys are hashed here once, and the merge takes linear time.
+	template<typename sectionsT>
+	void merge_into(sectionsT& sections) const {
+		using keysT = std::remove_reference_t<decltype(sections.begin()->value)>;
+		std::vector<uint32_t> newSections;
+
+		if (sections.empty()) {
+			newSections.reserve(this->_sections.size());
+			for (uint32_t s = 0; s < this->_sections.size(); ++s) newSections.push_back(s);
+		} else {
+			std::unordered_map<std::wstring_view, keysT*> existing; // all found before any append, which moves them
+			existing.reserve(sections.size());
+			for (auto& sectionEntry : sections) existing.emplace(sectionEntry.key, &sectionEntry.value);
+
+			for (uint32_t s = 0; s < this->_sections.size(); ++s) {
+				typename std::unordered_map<std::wstring_view, keysT*>::iterator ite = existing.find(this->section_name(s));
+				if (ite == existing.end()) {
+					newSections.push_back(s);
+				} else {
+					this->_merge_keys(s, *ite->second);
+				}
+			}
+		}
+
+		sections.reserve(sections.size() + newSections.size());
+		for (uint32_t s : newSections) {
+			this->_merge_keys(s, sections.append_unique(std::wstring{this->section_name(s)}));
+		}
+	}
+
+	// Writes the contents in INI format, the same of file_ini::serialize().
+	void serialize(str_builder& out) const {
+		for (size_t s = 0; s < this->_sections.size(); ++s) {
+			if (s) out.append(L"\r\n");
+			out.append(L'[').append(this->section_name(s)).append(L"]\r\n");
+			this->for_each_key(s, [&out](std::wstring_view key, std::wstring_view value) -> void {
+				out.append(key).append(L'=').append(value).append(L"\r\n");
+			});
+		}
+	}
+
+	std::wstring serialize() const {
+		str_builder out;
+		this->serialize(out);
+		return out.str();
+	}
+
+private:
+	template<typename keysT>
+	void _merge_keys(uint32_t section, keysT& keys) const {
+		const std::vector<uint32_t>& entries = this->_sections[section].entries;
+		std::vector<uint32_t> newEntries;
+
+		if (keys.empty()) {
+			newEntries = entries;
+		} else {
+			std::unordered_map<std::wstring_view, std::wstring*> existing;
+			existing.reserve(keys.size());
+			for (auto& keyEntry : keys) existing.emplace(keyEntry.key, &keyEntry.value);
+
+			for (uint32_t ent : entries) {
+				std::unordered_map<std::wstring_view, std::wstring*>::iterator ite = existing.find(this->_text[this->_entries[ent].key]);
+				if (ite == existing.end()) {
+					newEntries.push_back(ent);
+				} else {
+					*ite->second = this->_text[this->_entries[ent].value];
+				}
+			}
+		}
+
+		keys.reserve(keys.size() + newEntries.size());
+		for (uint32_t ent : newEntries) { // keys are unique in the document
+			keys.append_unique(std::wstring{this->_text[this->_entries[ent].key]}) = this->_text[this->_entries[ent].value];
+		}
+	}
+
+	template<typename decodeT>
+	void _parse_bytes(const BYTE* data, size_t sz, decodeT&& decode) {
+		this->_parse_lines(data, sz, 1,
+			[data](size_t i) noexcept -> wchar_t { return data[i]; }, // linebreaks are ASCII in all byte encodings
+			decode);
+	}
+
+	void _parse_utf16(const BYTE* data, size_t numUnits, bool bigEndian) {
+		this->_parse_lines(data, numUnits, 2,
+			[data, bigEndian](size_t i) noexcept -> wchar_t {
+				return static_cast<wchar_t>(bigEndian ?
+					(data[i * 2] << 8) | data[i * 2 + 1] : data[i * 2] | (data[i * 2 + 1] << 8));
+			},
+			[bigEndian](const BYTE* src, size_t numUnits, wchar_t* dest) noexcept -> size_t {
+				return str_transcode::utf16_to_utf16(src, numUnits, bigEndian, dest);
+			});
+	}
+
+	static bool _has_bom_again(const BYTE* data, size_t sz, encoding encType) noexcept {
+		return sz >= 2 && ((encType == encoding::UTF16LE && data[0] == 0xFF && data[1] == 0xFE) ||
+			(encType == encoding::UTF16BE && data[0] == 0xFE && data[1] == 0xFF));
+	}
+
+	// Splits the units at CR, LF and CRLF, like str::split_lines_view(), stopping at a
+	// null. Each line is decoded by decode(const unitT* src, size_t numUnits, wchar_t*
+	// dest), which writes at most numUnits chars; unitLen is the size of a unit in unitT.
+	template<typename unitT, typename unitAtT, typename decodeT>
+	void _parse_lines(const unitT* src, size_t numUnits, size_t unitLen, unitAtT&& unitAt, decodeT&& decode) {
+		std::vector<wchar_t> scratch;
+		uint32_t curSection = _NONE; // section-less keys will be ignored
+		size_t lineNo = 1;
+
+		for (size_t base = 0; base < numUnits; ++lineNo) {
+			size_t head = base;
+			wchar_t ch = 0;
+			while (head < numUnits && (ch = unitAt(head)) != L'\r' && ch != L'\n' && ch != L'\0') ++head;
+
+			if (head > base) {
+				if (scratch.size() < head - base) scratch.resize(head - base);
+				size_t len = decode(src + base * unitLen, head - base, scratch.data());
+				this->_parse_line({scratch.data(), len}, lineNo, curSection);
+			}
+
+			if (head == numUnits || ch == L'\0') break;
+			base = head + ((ch == L'\r' && head + 1 < numUnits && unitAt(head + 1) == L'\n') ? 2 : 1);
+		}
+	}
+
+	void _parse_line(std::wstring_view line, size_t lineNo, uint32_t& curSection) {
+		line = _trim(line);
+		if (line.empty()) { // skip blank lines
+			return;
+		} else if (line[0] == L'[' && line.back() == L']') { // begin of section found
+			curSection = this->_section(_trim(line.substr(1, line.length() - 2)));
+		} else if (line[0] == L';' || line[0] == L'#') { // comments
+			return;
+		} else if (curSection == _NONE) {
+			this->_issues.push_back({lineNo, "Line is not within a section."});
+		} else {
+			size_t idxEq = line.find(L'=');
+			if (idxEq == std::wstring_view::npos) {
+				this->_issues.push_back({lineNo, line[0] == L'[' ?
+					"Section name is not closed." : "Key has no value."});
+			} else {
+				this->_set(curSection, line.substr(0, idxEq), line.substr(idxEq + 1));
+			}
+		}
+	}
+
+	static std::wstring_view _trim(std::wstring_view s) noexcept { // same of str::trim_view()
+		size_t iFirst = 0, iPastLast = s.length();
+		while (iFirst < iPastLast && std::iswspace(s[iFirst])) ++iFirst;
+		while (iPastLast > iFirst && std::iswspace(s[iPastLast - 1])) --iPastLast;
+		return s.substr(iFirst, iPastLast - iFirst);
+	}
+
+	static size_t _hash_of(std::wstring_view s) noexcept {
+		return std::hash<std::wstring_view>{}(s);
+	}
+
+	static size_t _hash_of(uint32_t section, std::wstring_view key) noexcept {
+		return _hash_of(key) ^ (section * static_cast<size_t>(0x9E37'79B9'7F4A'7C15));
+	}
+
+	uint32_t _find_section(std::wstring_view name) const noexcept {
+		return this->_sectionIdx.find(_hash_of(name), [this, name](uint32_t sec) noexcept -> bool {
+			return this->_text[this->_sections[sec].name] == name;
+		});
+	}
+
+	uint32_t _find_entry(uint32_t section, std::wstring_view key) const noexcept {
+		return this->_entryIdx.find(_hash_of(section, key), [this, section, key](uint32_t ent) noexcept -> bool {
+			return this->_entries[ent].section == section && this->_text[this->_entries[ent].key] == key;
+		});
+	}
+
+	uint32_t _section(std::wstring_view name) { // if inexistent, will be inserted
+		uint32_t sec = this->_find_section(name);
+		if (sec == _NONE) {
+			sec = static_cast<uint32_t>(this->_sections.size());
+			this->_text.push_back(name);
+			this->_sections.push_back({static_cast<uint32_t>(this->_text.size() - 1), {}});
+			this->_sectionIdx.insert(_hash_of(name), sec);
+		}
+		return sec;
+	}
+
+	void _set(uint32_t section, std::wstring_view key, std::wstring_view value) {
+		uint32_t ent = this->_find_entry(section, key);
+		this->_text.push_back(value); // a replaced value just stays unused in the arena
+		uint32_t valueIdx = static_cast<uint32_t>(this->_text.size() - 1);
+		if (ent != _NONE) {
+			this->_entries[ent].value = valueIdx;
+			return;
+		}
+
+		this->_text.push_back(key);
+		ent = static_cast<uint32_t>(this->_entries.size());
+		this->_entries.push_back({section, static_cast<uint32_t>(this->_text.size() - 1), valueIdx});
+		this->_sections[section].entries.push_back(ent);
+		this->_entryIdx.insert(_hash_of(section, key), ent);
+	}
+};
+
+}//namespace _wli
+}//namespace wl
@@ -6,7 +6,9 @@
  */
 
 #pragma once
+#include <algorithm>
 #include <string>
+#include <string_view>
 #include <Windows.h>
 #include <CommCtrl.h>
 
@@ -117,32 +119,50 @@ public:
 	}
 
 	std::wstring get_text(size_t columnIndex = 0) const {
+		std::wstring buf;
+		this->get_text(buf, columnIndex);
+		return buf;
+	}
+
+	// Retrieves the text into the given buffer, reusing its memory, and returns a view to it.
+	std::wstring_view get_text(std::wstring& buf, size_t columnIndex = 0) const {
 		// http://forums.codeguru.com/showthread.php?351972-Getting-listView-item-text-length
 		LVITEMW lvi{};
 		lvi.iItem = static_cast<int>(this->_index);
 		lvi.iSubItem = static_cast<int>(columnIndex);
 
-		// Notice that, since strings' size always increase, if the buffer
-		// was previously allocated with a value bigger than our 1st step,
-		// this will speed up the size checks.
+		// Whatever memory the buffer already has is used at the first try,
+		// so a buffer reused among calls will rarely be reallocated.
 
-		std::wstring buf(64, L'\0'); // speed-up 1st allocation
-		int baseBufLen = 0;
+		buf.resize(std::max(buf.capacity(), static_cast<size_t>(64)));
 		int charsWrittenWithoutNull = 0;
-		do {
-			baseBufLen += 64; // buffer increasing step, arbitrary!
-			buf.resize(baseBufLen);
-			lvi.cchTextMax = baseBufLen;
+		for (;;) {
+			lvi.cchTextMax = static_cast<int>(buf.size());
 			lvi.pszText = &buf[0];
 			charsWrittenWithoutNull = static_cast<int>(
 				SendMessageW(this->_hList, LVM_GETITEMTEXT,
 					this->_index, reinterpret_cast<LPARAM>(&lvi)) );
-		} while (charsWrittenWithoutNull == baseBufLen - 1); // to break, must have at least 1 char gap
+			if (charsWrittenWithoutNull < lvi.cchTextMax - 1) break; // to break, must have at least 1 char gap
+			buf.resize(buf.size() * 2); // grow geometrically
+		}
 
 		buf.resize(lstrlenW(buf.c_str())); // str::trim_nulls()
 		return buf;
 	}
 
+	// Retrieves the text into the given buffer, truncating it if too small, and returns a view to it.
+	std::wstring_view get_text(wchar_t* buf, size_t bufLen, size_t columnIndex = 0) const noexcept {
+		if (!buf || !bufLen) return {};
+		LVITEMW lvi{};
+		lvi.iSubItem = static_cast<int>(columnIndex);
+		lvi.cchTextMax = static_cast<int>(bufLen);
+		lvi.pszText = buf;
+		buf[0] = L'\0';
+		SendMessageW(this->_hList, LVM_GETITEMTEXT,
+			this->_index, reinterpret_cast<LPARAM>(&lvi));
+		return {buf, static_cast<size_t>(lstrlenW(buf))};
+	}
+
 	listview_item& set_text(const wchar_t* text, size_t columnIndex = 0) noexcept {
 		ListView_SetItemText(this->_hList, this->_index,
 			static_cast<int>(columnIndex), const_cast<wchar_t*>(text));
@@ -7,7 +7,9 @@
 
 #pragma once
 #include <vector>
+#include "callable.h"
 #include "listview_item.h"
+#include "text_arena.h"
 
 namespace wl {
 namespace _wli {
@@ -84,6 +86,30 @@ public:
 		return this->add_at_pos_with_icon(caption, -1, -1);
 	}
 
+	// Adds many items at once, each one with the texts of all its columns,
+	// with redraw suppressed; optionally resizes all columns to fit at the end.
+	listview_item_collection& add_batch(const std::vector<std::vector<std::wstring>>& rows,
+		bool autoSizeColumns = false)
+	{
+		return this->_add_batch(rows.size(),
+			[&rows](size_t rowIndex) noexcept -> const std::vector<std::wstring>& {
+				return rows[rowIndex];
+			}, autoSizeColumns);
+	}
+
+	// Adds many items at once, the texts of each row being filled by the generator;
+	// the vector is reused among calls, so its strings don't need to be reallocated.
+	listview_item_collection& add_batch(size_t numRows,
+		callable<void(size_t, std::vector<std::wstring>&)> generator, bool autoSizeColumns = false)
+	{
+		std::vector<std::wstring> columns;
+		return this->_add_batch(numRows,
+			[&generator, &columns](size_t rowIndex) -> const std::vector<std::wstring>& {
+				generator(rowIndex, columns);
+				return columns;
+			}, autoSizeColumns);
+	}
+
 	// Returns a vector with all items in the listview.
 	std::vector<listview_item> get_all() const {
 		size_t totItems = this->count();
@@ -224,6 +250,70 @@ public:
 		}
 		return texts;
 	}
+
+	// Packs the texts of the given items, at the given column, into the arena, which
+	// is cleared first; if it's reused among calls, memory is rarely allocated.
+	void get_texts_into(size_t columnIndex, const std::vector<size_t>& indexes,
+		text_arena& arena) const
+	{
+		arena.clear().reserve(indexes.size(), 0);
+		LVITEMW lvi{};
+		lvi.iSubItem = static_cast<int>(columnIndex);
+
+		for (size_t index : indexes) {
+			arena.emplace_with([this, &lvi, index](wchar_t* buf, size_t bufLen) noexcept -> size_t {
+				lvi.cchTextMax = static_cast<int>(bufLen);
+				lvi.pszText = buf;
+				return SendMessageW(this->_hList, LVM_GETITEMTEXT,
+					index, reinterpret_cast<LPARAM>(&lvi)); // chars written, without terminating null
+			});
+		}
+	}
+
+private:
+	template<typename getRowT>
+	listview_item_collection& _add_batch(size_t numRows, getRowT&& getRow, bool autoSizeColumns) {
+		if (GetWindowLongPtrW(this->_hList, GWL_STYLE) & LVS_OWNERDATA) {
+			throw std::logic_error("Can't add items to a virtual listview, use its row source.");
+		}
+		if (!numRows) return *this;
+
+		SendMessageW(this->_hList, WM_SETREDRAW, static_cast<WPARAM>(FALSE), 0);
+		size_t firstIndex = this->count();
+		ListView_SetItemCountEx(this->_hList, static_cast<int>(firstIndex + numRows),
+			LVSICF_NOINVALIDATEALL); // preallocates memory for the new items
+
+		try {
+			LVITEMW lvi{};
+			for (size_t i = 0; i < numRows; ++i) {
+				const std::vector<std::wstring>& columns = getRow(i);
+
+				lvi.mask = LVIF_TEXT;
+				lvi.iItem = static_cast<int>(firstIndex + i);
+				lvi.iSubItem = 0;
+				lvi.pszText = const_cast<wchar_t*>(columns.empty() ? L"" : columns[0].c_str());
+				int newIndex = ListView_InsertItem(this->_hList, &lvi);
+
+				for (size_t c = 1; c < columns.size(); ++c) {
+					ListView_SetItemText(this->_hList, newIndex, static_cast<int>(c),
+						const_cast<wchar_t*>(columns[c].c_str()));
+				}
+			}
+		} catch (...) {
+			SendMessageW(this->_hList, WM_SETREDRAW, static_cast<WPARAM>(TRUE), 0);
+			throw;
+		}
+
+		if (autoSizeColumns) {
+			int numCols = Header_GetItemCount(ListView_GetHeader(this->_hList));
+			for (int c = 0; c < numCols; ++c) {
+				ListView_SetColumnWidth(this->_hList, c, LVSCW_AUTOSIZE_USEHEADER);
+			}
+		}
+		SendMessageW(this->_hList, WM_SETREDRAW, static_cast<WPARAM>(TRUE), 0);
+		InvalidateRect(this->_hList, nullptr, TRUE);
+		return *this;
+	}
 };
 
 }//namespace _wli
@@ -0,0 +1,442 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cwchar>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <Windows.h>
+#include "callable.h"
+#include "listview_row_source.h"
+#include "search_index.h"
+#include "thread_pool.h"
+#include "ui_queue.h"
+#include "../str.h"
+
+namespace wl {
+namespace _wli {
+
+// In-memory columnar data of a virtual listview. Rows are kept in insertion order;
+// what is displayed is a permutation of them, computed in background by sorting
+// and filtering, then published to the UI thread at once.
+class listview_model final : public listview_row_source {
+public:
+	// Defines how the rows are sorted and filtered.
+	struct query final {
+		size_t       sortColumn = npos; // npos keeps insertion order
+		bool         descending = false;
+		std::wstring filter;            // case-insensitive substring searched in all columns
+	};
+
+private:
+	static const size_t _CHUNK_ROWS = 16384; // rows processed by each parallel task
+
+	using _perm_type = std::vector<UINT>; // visible row -> stored row
+
+	struct _column final {
+		std::vector<std::wstring> texts;
+		std::vector<double>       numbers; // only for numeric columns
+		bool                      numeric = false;
+	};
+
+	struct _table_data final {
+		std::vector<_column> columns;
+		size_t               numRows = 0;
+	};
+
+	struct _derived_data final { // computed in background when first needed, then kept until data changes
+		std::shared_ptr<const std::vector<std::string>>  sortKeys; // locale-aware, compared bytewise
+		std::shared_ptr<const std::vector<std::wstring>> folded;   // lowercase, for filtering
+	};
+
+	struct _result final {
+		_perm_type                 view;
+		std::vector<_derived_data> derived;
+	};
+
+	std::shared_ptr<_table_data>         _table{new _table_data}; // copy-on-write, since running queries share it
+	std::vector<_derived_data>           _derived;
+	_perm_type                           _view;
+	query                                _query;
+	std::shared_ptr<std::atomic<size_t>> _latestJob{new std::atomic<size_t>(0)}; // older jobs are discarded
+	ui_context                           _ctx;
+	callable<void()>                     _onPublished;
+
+	mutable std::unique_ptr<search_index> _pFindIndex; // first column, built at the first find()
+	mutable std::vector<size_t>           _visibleRowOf; // inverse of the view, for find()
+	mutable bool                          _visibleRowOfDirty = true;
+
+public:
+	~listview_model() {
+		this->_latestJob->store(npos); // results still on their way will find nobody
+	}
+
+	listview_model() = default;
+	listview_model(const listview_model&) = delete;
+	listview_model& operator=(const listview_model&) = delete;
+
+	// Adds a column; numeric columns are sorted by value. Must be called before rows are added.
+	listview_model& add_column(bool numeric = false) {
+		if (this->_table->numRows) {
+			throw std::logic_error("Columns must be added before any row.");
+		}
+		this->_mutable_table().columns.emplace_back();
+		this->_table->columns.back().numeric = numeric;
+		this->_derived.emplace_back();
+		return *this;
+	}
+
+	// Returns the number of columns.
+	size_t num_columns() const noexcept {
+		return this->_table->columns.size();
+	}
+
+	// Returns the number of stored rows, including the ones hidden by the filter.
+	size_t num_rows() const noexcept {
+		return this->_table->numRows;
+	}
+
+	// Preallocates memory for the given total number of rows.
+	listview_model& reserve(size_t numRows) {
+		for (_column& col : this->_mutable_table().columns) {
+			col.texts.reserve(numRows);
+			if (col.numeric) col.numbers.reserve(numRows);
+		}
+		return *this;
+	}
+
+	// Adds a row with the texts of its columns; missing ones are left empty. The row
+	// is displayed only after refresh(). If a query is running, it's cancelled.
+	listview_model& add_row(std::vector<std::wstring> texts) {
+		if (texts.size() > this->num_columns()) {
+			throw std::invalid_argument("Row has more texts than the number of columns.");
+		}
+		this->_cancel_pending();
+		_table_data& tbl = this->_mutable_table();
+		texts.resize(tbl.columns.size());
+
+		for (size_t c = 0; c < tbl.columns.size(); ++c) {
+			_column& col = tbl.columns[c];
+			if (col.numeric) col.numbers.emplace_back(_parse_number(texts[c]));
+			col.texts.emplace_back(std::move(texts[c]));
+		}
+		++tbl.numRows;
+		std::fill(this->_derived.begin(), this->_derived.end(), _derived_data{});
+		if (this->_pFindIndex) this->_pFindIndex->push_back(tbl.columns[0].texts.back());
+		return *this;
+	}
+
+	// Removes all rows, keeping the columns; the change is published at once.
+	listview_model& clear() {
+		this->_cancel_pending();
+		if (this->_table.use_count() > 1) { // a query is still reading it, don't copy what will be thrown away
+			std::shared_ptr<_table_data> fresh = std::make_shared<_table_data>();
+			for (const _column& col : this->_table->columns) {
+				fresh->columns.emplace_back();
+				fresh->columns.back().numeric = col.numeric;
+			}
+			this->_table = std::move(fresh);
+		} else {
+			for (_column& col : this->_table->columns) {
+				col.texts.clear();
+				col.numbers.clear();
+			}
+			this->_table->numRows = 0;
+		}
+		std::fill(this->_derived.begin(), this->_derived.end(), _derived_data{});
+		this->_pFindIndex.reset();
+		this->_view.clear();
+		this->_visibleRowOfDirty = true;
+		if (this->_onPublished) this->_onPublished();
+		return *this;
+	}
+
+	// Returns the current query.
+	const query& get_query() const noexcept {
+		return this->_query;
+	}
+
+	// Sorts by the given column, keeping the current filter.
+	listview_model& sort(size_t columnIndex, bool descending = false) {
+		this->_query.sortColumn = columnIndex;
+		this->_query.descending = descending;
+		return this->refresh();
+	}
+
+	// Filters the rows by a substring, keeping the current sorting.
+	listview_model& filter(std::wstring text) {
+		this->_query.filter = std::move(text);
+		return this->refresh();
+	}
+
+	// Replaces the whole query.
+	listview_model& set_query(query q) {
+		this->_query = std::move(q);
+		return this->refresh();
+	}
+
+	// Runs the current query again, in background if bound to a window, superseding
+	// any query still running; the listview is refreshed once when it's done.
+	listview_model& refresh() {
+		size_t jobId = this->_cancel_pending();
+
+		if (this->_query.sortColumn >= this->num_columns() && this->_query.filter.empty()) {
+			this->_view.resize(this->_table->numRows); // insertion order: nothing to compute
+			std::iota(this->_view.begin(), this->_view.end(), 0);
+			this->_visibleRowOfDirty = true;
+			if (this->_onPublished) this->_onPublished();
+			return *this;
+		}
+
+		if (!this->_ctx) { // not bound to a window, run synchronously
+			_result res = _compute(*this->_table, this->_derived, this->_query, *this->_latestJob, jobId);
+			this->_publish(std::move(res));
+			return *this;
+		}
+
+		std::shared_ptr<const _table_data> tbl = this->_table;
+		thread_pool::instance().submit(thread_pool::priority::NORMAL,
+			[this, tbl, derived = this->_derived, q = this->_query, token = this->_latestJob,
+				jobId, ctx = this->_ctx]() noexcept -> void
+			{
+				try {
+					_result res = _compute(*tbl, derived, q, *token, jobId);
+					if (token->load() != jobId) return; // superseded meanwhile
+					ctx.post([this, token, jobId, res = std::move(res)]() mutable -> void {
+						if (token->load() != jobId) return; // superseded, or model is gone
+						this->_publish(std::move(res));
+					});
+				} catch (...) {
+					ctx.post([curExcept = std::current_exception()]() -> void {
+						std::rethrow_exception(curExcept); // handled like any message exception
+					});
+				}
+			});
+		return *this;
+	}
+
+	// Returns the index of the stored row shown at the given visible position.
+	size_t source_row(size_t rowIndex) const noexcept {
+		return rowIndex < this->_view.size() ? this->_view[rowIndex] : npos;
+	}
+
+	// Sets where query results are published, and what to call then; called by listview::set_model().
+	void bind(ui_context ctx, callable<void()> onPublished) noexcept {
+		this->_ctx = std::move(ctx);
+		this->_onPublished = std::move(onPublished);
+	}
+
+	size_t count() const override {
+		return this->_view.size();
+	}
+
+	std::wstring text(size_t rowIndex, size_t columnIndex) const override {
+		if (rowIndex >= this->_view.size() || columnIndex >= this->num_columns()) return {};
+		return this->_table->columns[columnIndex].texts[this->_view[rowIndex]];
+	}
+
+	// Searches the first column through an index, which is case- and diacritic-insensitive.
+	size_t find(const wchar_t* text, bool partial, size_t startRow, bool wrap) const override {
+		if (!text || this->_view.empty() || !this->num_columns()) return npos;
+
+		if (!this->_pFindIndex) {
+			this->_pFindIndex.reset(new search_index);
+			this->_pFindIndex->reserve(this->_table->numRows);
+			for (const std::wstring& caption : this->_table->columns[0].texts) {
+				this->_pFindIndex->push_back(caption);
+			}
+		}
+		if (this->_visibleRowOfDirty) {
+			this->_visibleRowOf.assign(this->_table->numRows, npos); // hidden by the filter
+			for (size_t r = 0; r < this->_view.size(); ++r) {
+				this->_visibleRowOf[this->_view[r]] = r;
+			}
+			this->_visibleRowOfDirty = false;
+		}
+
+		size_t textLen = lstrlenW(text), best = npos, lowest = npos;
+		for (size_t stored : this->_pFindIndex->find_all_prefix(text)) {
+			if (!partial && this->_table->columns[0].texts[stored].length() != textLen) continue; // folding keeps lengths
+			size_t row = this->_visibleRowOf[stored];
+			if (row == npos) continue;
+			if (row >= startRow && (best == npos || row < best)) best = row;
+			if (lowest == npos || row < lowest) lowest = row;
+		}
+		return best != npos ? best : (wrap ? lowest : npos);
+	}
+
+private:
+	_table_data& _mutable_table() {
+		if (this->_table.use_count() > 1) { // a query is still reading it
+			this->_table = std::make_shared<_table_data>(*this->_table);
+		}
+		return *this->_table;
+	}
+
+	size_t _cancel_pending() noexcept {
+		return ++*this->_latestJob; // running jobs see it and give up
+	}
+
+	void _publish(_result&& res) {
+		this->_view = std::move(res.view);
+		this->_visibleRowOfDirty = true;
+		for (size_t c = 0; c < this->_derived.size(); ++c) { // keep whatever was computed
+			if (res.derived[c].sortKeys) this->_derived[c].sortKeys = std::move(res.derived[c].sortKeys);
+			if (res.derived[c].folded) this->_derived[c].folded = std::move(res.derived[c].folded);
+		}
+		if (this->_onPublished) this->_onPublished();
+	}
+
+	static double _parse_number(const std::wstring& s) noexcept {
+		const wchar_t* pBegin = s.c_str();
+		wchar_t* pEnd = nullptr;
+		double num = std::wcstod(pBegin, &pEnd);
+		return pEnd == pBegin ? std::numeric_limits<double>::lowest() : num; // non-numbers come first
+	}
+
+	static size_t _num_chunks(size_t numRows) noexcept {
+		return (numRows + _CHUNK_ROWS - 1) / _CHUNK_ROWS;
+	}
+
+	// Runs in a pool thread; returns early, with a partial result, if the job is superseded.
+	static _result _compute(const _table_data& tbl, std::vector<_derived_data> derived,
+		const query& q, const std::atomic<size_t>& latestJob, size_t jobId)
+	{
+		thread_pool& pool = thread_pool::instance();
+		_result res;
+		res.derived.resize(derived.size()); // only what's computed here goes back
+
+		if (q.filter.empty()) {
+			res.view.resize(tbl.numRows);
+			std::iota(res.view.begin(), res.view.end(), 0);
+		} else {
+			for (size_t c = 0; c < tbl.columns.size(); ++c) {
+				if (!derived[c].folded) {
+					derived[c].folded = res.derived[c].folded = _fold_texts(pool, tbl.columns[c].texts);
+				}
+				if (latestJob.load() != jobId) return res;
+			}
+			res.view = _filter_rows(pool, tbl.numRows, derived, str::lower(q.filter));
+		}
+		if (latestJob.load() != jobId || q.sortColumn >= tbl.columns.size()) return res;
+
+		const _column& col = tbl.columns[q.sortColumn];
+		if (col.numeric) {
+			const std::vector<double>& nums = col.numbers;
+			_parallel_stable_sort(pool, res.view, q.descending,
+				[&nums](UINT a, UINT b) noexcept -> bool { return nums[a] < nums[b]; });
+		} else {
+			if (!derived[q.sortColumn].sortKeys) {
+				derived[q.sortColumn].sortKeys = res.derived[q.sortColumn].sortKeys = _make_sort_keys(pool, col.texts);
+				if (latestJob.load() != jobId) return res;
+			}
+			const std::vector<std::string>& keys = *derived[q.sortColumn].sortKeys;
+			_parallel_stable_sort(pool, res.view, q.descending,
+				[&keys](UINT a, UINT b) noexcept -> bool { return keys[a] < keys[b]; });
+		}
+		return res;
+	}
+
+	static std::shared_ptr<const std::vector<std::wstring>> _fold_texts(thread_pool& pool,
+		const std::vector<std::wstring>& texts)
+	{
+		std::shared_ptr<std::vector<std::wstring>> folded = std::make_shared<std::vector<std::wstring>>(texts);
+		pool.parallel_for(_num_chunks(texts.size()), [&folded](size_t chunk) noexcept -> void {
+			size_t last = std::min((chunk + 1) * _CHUNK_ROWS, folded->size());
+			for (size_t i = chunk * _CHUNK_ROWS; i < last; ++i) {
+				std::wstring& s = (*folded)[i];
+				if (!s.empty()) CharLowerBuffW(&s[0], static_cast<DWORD>(s.length()));
+			}
+		});
+		return folded;
+	}
+
+	static std::shared_ptr<const std::vector<std::string>> _make_sort_keys(thread_pool& pool,
+		const std::vector<std::wstring>& texts)
+	{
+		std::shared_ptr<std::vector<std::string>> keys = std::make_shared<std::vector<std::string>>(texts.size());
+		pool.parallel_for(_num_chunks(texts.size()), [&texts, &keys](size_t chunk) noexcept -> void {
+			size_t last = std::min((chunk + 1) * _CHUNK_ROWS, texts.size());
+			for (size_t i = chunk * _CHUNK_ROWS; i < last; ++i) {
+				const std::wstring& s = texts[i];
+				if (s.empty()) continue; // empty key sorts first
+				int numBytes = LCMapStringEx(LOCALE_NAME_USER_DEFAULT, LCMAP_SORTKEY | NORM_IGNORECASE,
+					s.c_str(), static_cast<int>(s.length()), nullptr, 0, nullptr, nullptr, 0);
+				std::string& key = (*keys)[i];
+				key.resize(numBytes);
+				if (numBytes) {
+					LCMapStringEx(LOCALE_NAME_USER_DEFAULT, LCMAP_SORTKEY | NORM_IGNORECASE,
+						s.c_str(), static_cast<int>(s.length()),
+						reinterpret_cast<LPWSTR>(&key[0]), numBytes, nullptr, nullptr, 0);
+				}
+			}
+		});
+		return keys;
+	}
+
+	static _perm_type _filter_rows(thread_pool& pool, size_t numRows,
+		const std::vector<_derived_data>& derived, const std::wstring& foldedNeedle)
+	{
+		std::vector<_perm_type> partials(_num_chunks(numRows)); // each chunk keeps its own matches, in order
+		pool.parallel_for(partials.size(), [&](size_t chunk) -> void {
+			size_t last = std::min((chunk + 1) * _CHUNK_ROWS, numRows);
+			for (size_t i = chunk * _CHUNK_ROWS; i < last; ++i) {
+				for (const _derived_data& col : derived) {
+					if ((*col.folded)[i].find(foldedNeedle) != std::wstring::npos) {
+						partials[chunk].emplace_back(static_cast<UINT>(i));
+						break;
+					}
+				}
+			}
+		});
+
+		size_t numMatches = 0;
+		for (const _perm_type& part : partials) numMatches += part.size();
+		_perm_type view;
+		view.reserve(numMatches);
+		for (const _perm_type& part : partials) view.insert(view.end(), part.cbegin(), part.cend());
+		return view;
+	}
+
+	// Sorts chunks in parallel, then merges them pairwise, also in parallel.
+	template<typename lessT>
+	static void _parallel_stable_sort(thread_pool& pool, _perm_type& v, bool descending, lessT less) {
+		auto comp = [descending, &less](UINT a, UINT b) noexcept -> bool {
+			return descending ? less(b, a) : less(a, b); // swapping keeps equal rows stable
+		};
+		size_t numChunks = _num_chunks(v.size());
+		if (numChunks <= 1) {
+			std::stable_sort(v.begin(), v.end(), comp);
+			return;
+		}
+
+		auto chunkBegin = [&v](size_t chunk) noexcept -> _perm_type::iterator {
+			return v.begin() + std::min(chunk * _CHUNK_ROWS, v.size());
+		};
+		pool.parallel_for(numChunks, [&](size_t chunk) -> void {
+			std::stable_sort(chunkBegin(chunk), chunkBegin(chunk + 1), comp);
+		});
+
+		for (size_t width = 1; width < numChunks; width *= 2) { // sorted runs are width chunks long
+			pool.parallel_for((numChunks + 2 * width - 1) / (2 * width), [&](size_t pair) -> void {
+				size_t first = pair * 2 * width;
+				std::inplace_merge(chunkBegin(first), chunkBegin(first + width),
+					chunkBegin(first + 2 * width), comp);
+			});
+		}
+	}
+};
+
+}//namespace _wli
+}//namespace wl
@@ -0,0 +1,105 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include "../str.h"
+
+namespace wl {
+namespace _wli {
+
+// Interface to the data of a virtual (owner-data) listview, which has no
+// knowledge of the control itself, so it can be used headlessly.
+class listview_row_source {
+public:
+	static constexpr size_t npos = -1;
+
+	virtual ~listview_row_source() = default;
+
+	// Returns the number of rows.
+	virtual size_t count() const = 0;
+
+	// Returns the text of the given cell.
+	virtual std::wstring text(size_t rowIndex, size_t columnIndex) const = 0;
+
+	// Returns the image list icon index of the given row, or -1 if none.
+	virtual int icon(size_t /*rowIndex*/) const { return -1; }
+
+	// Returns the overlay and state image bits of the given row; selection and focus are kept by the listview.
+	virtual UINT state(size_t /*rowIndex*/) const { return 0; }
+
+	// Called before the given range of rows is displayed, so data can be loaded in a single batch.
+	virtual void prefetch(size_t /*firstRow*/, size_t /*lastRow*/) { }
+
+	// Returns the first row, starting at startRow, whose first column text matches the
+	// given one, case-insensitive, or npos if none is found.
+	virtual size_t find(const wchar_t* text, bool partial, size_t startRow, bool wrap) const {
+		size_t numRows = this->count();
+		if (!numRows) return npos;
+		if (startRow >= numRows) startRow = 0;
+
+		size_t numTests = wrap ? numRows : numRows - startRow;
+		for (size_t i = 0; i < numTests; ++i) {
+			size_t row = (startRow + i) % numRows;
+			std::wstring caption = this->text(row, 0);
+			if (partial ? str::begins_withi(caption, text) : str::eqi(caption, text)) {
+				return row;
+			}
+		}
+		return npos;
+	}
+};
+
+// Cache of the cells of a range of rows, filled upon LVN_ODCACHEHINT.
+class listview_row_cache final {
+private:
+	static const size_t _MAX_ROWS = 1024; // bigger ranges are not worth caching
+
+	std::vector<std::wstring> _cells; // row-major; strings are reused to avoid reallocations
+	size_t                    _firstRow = 0, _numRows = 0, _numCols = 0;
+
+public:
+	// Loads all cells of the given range, inclusive.
+	void fill(const listview_row_source& source, size_t firstRow, size_t lastRow, size_t numCols) {
+		this->clear();
+		size_t numRows = source.count();
+		if (lastRow >= numRows) {
+			if (!numRows) return;
+			lastRow = numRows - 1;
+		}
+		if (firstRow > lastRow || lastRow - firstRow + 1 > _MAX_ROWS || !numCols) return;
+
+		this->_numRows = lastRow - firstRow + 1;
+		this->_numCols = numCols;
+		if (this->_cells.size() < this->_numRows * numCols) {
+			this->_cells.resize(this->_numRows * numCols);
+		}
+
+		for (size_t r = 0; r < this->_numRows; ++r) {
+			for (size_t c = 0; c < numCols; ++c) {
+				this->_cells[r * numCols + c] = source.text(firstRow + r, c);
+			}
+		}
+		this->_firstRow = firstRow;
+	}
+
+	// Returns the cached cell text, or nullptr if not cached.
+	const std::wstring* get(size_t rowIndex, size_t columnIndex) const noexcept {
+		if (rowIndex < this->_firstRow || rowIndex - this->_firstRow >= this->_numRows ||
+			columnIndex >= this->_numCols) return nullptr;
+		return &this->_cells[(rowIndex - this->_firstRow) * this->_numCols + columnIndex];
+	}
+
+	// Invalidates all cached cells, keeping the memory.
+	void clear() noexcept {
+		this->_firstRow = this->_numRows = this->_numCols = 0;
+	}
+};
+
+}//namespace _wli
+}//namespace wl
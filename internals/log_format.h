@@ -0,0 +1,116 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include "crc32c.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+namespace wl {
+namespace _wli {
+
+#ifndef _WIN32
+using BYTE = unsigned char;
+#endif
+
+// Layout of an append-only log in memory: a 16-byte header with a magic number, then
+// the records, each one a 4-byte payload length, the CRC-32C of length and padded
+// payload, then the payload, padded to 8 bytes. Space after the last record is zero-filled, and
+// a zero length with a zero checksum marks the end, since a real record of zero bytes
+// has a nonzero checksum.
+class log_format final {
+private:
+	log_format() = delete;
+
+	static constexpr char _MAGIC[8] = {'W', 'L', 'L', 'O', 'G', '0', '0', '1'};
+
+public:
+	static constexpr size_t   HEADER_SIZE = 16;
+	static constexpr size_t   RECORD_HEADER_SIZE = 8;
+	static constexpr uint32_t MAX_PAYLOAD = 0xFFFF'FFF0; // so the padded size still fits 32 bits
+
+	// Bytes taken by a record with the given payload.
+	static uint64_t record_size(size_t payloadSz) noexcept {
+		return RECORD_HEADER_SIZE + ((static_cast<uint64_t>(payloadSz) + 7) & ~uint64_t{7});
+	}
+
+	// Tells whether the memory holds a log header, or is all zeros, as a new file.
+	static bool has_header(const BYTE* p) noexcept {
+		return !memcmp(p, _MAGIC, sizeof(_MAGIC));
+	}
+	static bool is_blank(const BYTE* p) noexcept {
+		static const BYTE zeros[HEADER_SIZE] = {};
+		return !memcmp(p, zeros, HEADER_SIZE);
+	}
+
+	static void write_header(BYTE* p) noexcept {
+		memcpy(p, _MAGIC, sizeof(_MAGIC));
+		memset(p + sizeof(_MAGIC), 0, HEADER_SIZE - sizeof(_MAGIC)); // reserved
+	}
+
+	// Writes a record at pDest, which must have record_size() bytes, all zeros.
+	static void write_record(BYTE* pDest, const void* pData, size_t sz) noexcept {
+		uint32_t len = static_cast<uint32_t>(sz);
+		if (sz) memcpy(pDest + RECORD_HEADER_SIZE, pData, sz); // padding is already zeroed
+		memcpy(pDest, &len, 4);
+		uint32_t crc = _checksum(pDest, sz);
+		memcpy(pDest + 4, &crc, 4);
+	}
+
+	// Reads the record at offset, if there's an intact one before end; on success,
+	// returns the offset of the next record.
+	static bool read_record(const BYTE* p, uint64_t end, uint64_t offset,
+		const BYTE*& pPayload, size_t& payloadSz, uint64_t& next) noexcept
+	{
+		if (offset + RECORD_HEADER_SIZE > end) return false;
+		uint32_t len = 0, crc = 0;
+		memcpy(&len, p + offset, 4);
+		memcpy(&crc, p + offset + 4, 4);
+		if (len > MAX_PAYLOAD) return false;
+		uint64_t sz = record_size(len);
+		if (sz > end - offset || crc != _checksum(p + offset, len)) return false; // zeros fail here too
+		pPayload = p + offset + RECORD_HEADER_SIZE;
+		payloadSz = len;
+		next = offset + sz;
+		return true;
+	}
+
+	// Finds the end of the last intact record, so a record torn by a crash, and
+	// whatever was written after it, is discarded; the space after the end is zeroed,
+	// so stale records can't be taken as valid once new ones are appended. The zeroed
+	// range, up to zeroedEnd, must reach the disk before any append: a shorter record
+	// written over it would otherwise be followed by a stale one after a power loss.
+	static uint64_t recover(BYTE* p, uint64_t cap, size_t& numRecords, uint64_t& zeroedEnd) noexcept {
+		uint64_t end = HEADER_SIZE;
+		const BYTE* pPayload = nullptr;
+		size_t payloadSz = 0;
+		numRecords = 0;
+		for (uint64_t next = 0; read_record(p, cap, end, pPayload, payloadSz, next); end = next) {
+			++numRecords;
+		}
+
+		uint64_t dirty = cap; // after a clean close, the file ends right after the last record
+		while (dirty > end && !p[dirty - 1]) --dirty; // pages with no data aren't touched
+		memset(p + end, 0, static_cast<size_t>(dirty - end));
+		zeroedEnd = dirty;
+		return end;
+	}
+
+private:
+	static uint32_t _checksum(const BYTE* pRecord, size_t payloadSz) noexcept {
+		uint32_t crc = crc32c::update(0, pRecord, 4); // the length
+		return crc32c::update(crc, pRecord + RECORD_HEADER_SIZE, // padding too, so every byte is checked
+			static_cast<size_t>(record_size(payloadSz) - RECORD_HEADER_SIZE));
+	}
+};
+
+}//namespace _wli
+}//namespace wl
@@ -0,0 +1,268 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include "params_wmn.h"
+
+namespace wl {
+namespace _wli {
+
+// Maps a window message to its message cracker at compile time; unknown messages get raw params.
+template<UINT msgT>
+struct wm_cracker { using type = params; };
+
+// Maps a WM_NOTIFY code to its notification cracker at compile time; unknown codes get wm::notify.
+// NM_ codes are shared among controls, so they can't be mapped and must be cracked manually.
+template<UINT codeT>
+struct wmn_cracker { using type = wm::notify; };
+
+#define WINLAMB_WMCRACKER(msg, sname) \
+	template<> struct wm_cracker<msg> { using type = wm::sname; }
+
+#define WINLAMB_WMNCRACKER(code, sname) \
+	template<> struct wmn_cracker<code> { using type = wmn::sname; }
+
+WINLAMB_WMCRACKER(WM_ACTIVATE, activate);
+WINLAMB_WMCRACKER(WM_ACTIVATEAPP, activateapp);
+WINLAMB_WMCRACKER(WM_ASKCBFORMATNAME, askcbformatname);
+WINLAMB_WMCRACKER(WM_CANCELMODE, cancelmode);
+WINLAMB_WMCRACKER(WM_CAPTURECHANGED, capturechanged);
+WINLAMB_WMCRACKER(WM_CHANGECBCHAIN, changecbchain);
+WINLAMB_WMCRACKER(WM_CHAR, char_);
+WINLAMB_WMCRACKER(WM_CHARTOITEM, chartoitem);
+WINLAMB_WMCRACKER(WM_CHILDACTIVATE, childactivate);
+WINLAMB_WMCRACKER(WM_CLOSE, close);
+WINLAMB_WMCRACKER(WM_COMPACTING, compacting);
+WINLAMB_WMCRACKER(WM_COMPAREITEM, compareitem);
+WINLAMB_WMCRACKER(WM_CONTEXTMENU, contextmenu);
+WINLAMB_WMCRACKER(WM_COPYDATA, copydata);
+WINLAMB_WMCRACKER(WM_CREATE, create);
+WINLAMB_WMCRACKER(WM_CTLCOLORBTN, ctlcolorbtn);
+WINLAMB_WMCRACKER(WM_CTLCOLORDLG, ctlcolordlg);
+WINLAMB_WMCRACKER(WM_CTLCOLOREDIT, ctlcoloredit);
+WINLAMB_WMCRACKER(WM_CTLCOLORLISTBOX, ctlcolorlistbox);
+WINLAMB_WMCRACKER(WM_CTLCOLORSCROLLBAR, ctlcolorscrollbar);
+WINLAMB_WMCRACKER(WM_CTLCOLORSTATIC, ctlcolorstatic);
+WINLAMB_WMCRACKER(WM_DEADCHAR, deadchar);
+WINLAMB_WMCRACKER(WM_DELETEITEM, deleteitem);
+WINLAMB_WMCRACKER(WM_DESTROY, destroy);
+WINLAMB_WMCRACKER(WM_DESTROYCLIPBOARD, destroyclipboard);
+WINLAMB_WMCRACKER(WM_DEVMODECHANGE, devmodechange);
+#ifdef _DBT_H // Dbt.h
+WINLAMB_WMCRACKER(WM_DEVICECHANGE, devicechange);
+#endif
+WINLAMB_WMCRACKER(WM_DISPLAYCHANGE, displaychange);
+WINLAMB_WMCRACKER(WM_DRAWCLIPBOARD, drawclipboard);
+WINLAMB_WMCRACKER(WM_DRAWITEM, drawitem);
+WINLAMB_WMCRACKER(WM_DROPFILES, dropfiles);
+WINLAMB_WMCRACKER(WM_ENABLE, enable);
+WINLAMB_WMCRACKER(WM_ENDSESSION, endsession);
+WINLAMB_WMCRACKER(WM_ENTERIDLE, enteridle);
+WINLAMB_WMCRACKER(WM_ENTERMENULOOP, entermenuloop);
+WINLAMB_WMCRACKER(WM_ENTERSIZEMOVE, entersizemove);
+WINLAMB_WMCRACKER(WM_ERASEBKGND, erasebkgnd);
+WINLAMB_WMCRACKER(WM_EXITMENULOOP, exitmenuloop);
+WINLAMB_WMCRACKER(WM_EXITSIZEMOVE, exitsizemove);
+WINLAMB_WMCRACKER(WM_FONTCHANGE, fontchange);
+WINLAMB_WMCRACKER(WM_GETDLGCODE, getdlgcode);
+WINLAMB_WMCRACKER(WM_GETFONT, getfont);
+WINLAMB_WMCRACKER(WM_GETHOTKEY, gethotkey);
+WINLAMB_WMCRACKER(WM_GETICON, geticon);
+WINLAMB_WMCRACKER(WM_GETMINMAXINFO, getminmaxinfo);
+WINLAMB_WMCRACKER(WM_GETTEXT, gettext);
+WINLAMB_WMCRACKER(WM_GETTEXTLENGTH, gettextlength);
+WINLAMB_WMCRACKER(WM_HELP, help);
+WINLAMB_WMCRACKER(WM_HOTKEY, hotkey);
+WINLAMB_WMCRACKER(WM_HSCROLL, hscroll);
+WINLAMB_WMCRACKER(WM_VSCROLL, vscroll);
+WINLAMB_WMCRACKER(WM_HSCROLLCLIPBOARD, hscrollclipboard);
+WINLAMB_WMCRACKER(WM_VSCROLLCLIPBOARD, vscrollclipboard);
+WINLAMB_WMCRACKER(WM_ICONERASEBKGND, iconerasebkgnd);
+WINLAMB_WMCRACKER(WM_INITDIALOG, initdialog);
+WINLAMB_WMCRACKER(WM_INITMENU, initmenu);
+WINLAMB_WMCRACKER(WM_INITMENUPOPUP, initmenupopup);
+WINLAMB_WMCRACKER(WM_INPUTLANGCHANGE, inputlangchange);
+WINLAMB_WMCRACKER(WM_INPUTLANGCHANGEREQUEST, inputlangchangerequest);
+WINLAMB_WMCRACKER(WM_KEYDOWN, keydown);
+WINLAMB_WMCRACKER(WM_KEYUP, keyup);
+WINLAMB_WMCRACKER(WM_KILLFOCUS, killfocus);
+WINLAMB_WMCRACKER(WM_LBUTTONDBLCLK, lbuttondblclk);
+WINLAMB_WMCRACKER(WM_LBUTTONDOWN, lbuttondown);
+WINLAMB_WMCRACKER(WM_LBUTTONUP, lbuttonup);
+WINLAMB_WMCRACKER(WM_MBUTTONDBLCLK, mbuttondblclk);
+WINLAMB_WMCRACKER(WM_MBUTTONDOWN, mbuttondown);
+WINLAMB_WMCRACKER(WM_MBUTTONUP, mbuttonup);
+WINLAMB_WMCRACKER(WM_MOUSEHOVER, mousehover);
+WINLAMB_WMCRACKER(WM_MOUSEMOVE, mousemove);
+WINLAMB_WMCRACKER(WM_RBUTTONDBLCLK, rbuttondblclk);
+WINLAMB_WMCRACKER(WM_RBUTTONDOWN, rbuttondown);
+WINLAMB_WMCRACKER(WM_RBUTTONUP, rbuttonup);
+WINLAMB_WMCRACKER(WM_MDIACTIVATE, mdiactivate);
+WINLAMB_WMCRACKER(WM_MEASUREITEM, measureitem);
+WINLAMB_WMCRACKER(WM_MENUCHAR, menuchar);
+WINLAMB_WMCRACKER(WM_MENUDRAG, menudrag);
+WINLAMB_WMCRACKER(WM_MENUGETOBJECT, menugetobject);
+WINLAMB_WMCRACKER(WM_MENURBUTTONUP, menurbuttonup);
+WINLAMB_WMCRACKER(WM_MENUSELECT, menuselect);
+WINLAMB_WMCRACKER(WM_MOUSEACTIVATE, mouseactivate);
+WINLAMB_WMCRACKER(WM_MOUSELEAVE, mouseleave);
+WINLAMB_WMCRACKER(WM_MOUSEWHEEL, mousewheel);
+WINLAMB_WMCRACKER(WM_MOVE, move);
+WINLAMB_WMCRACKER(WM_MOVING, moving);
+WINLAMB_WMCRACKER(WM_NCACTIVATE, ncactivate);
+WINLAMB_WMCRACKER(WM_NCCALCSIZE, nccalcsize);
+WINLAMB_WMCRACKER(WM_NCCREATE, nccreate);
+WINLAMB_WMCRACKER(WM_NCDESTROY, ncdestroy);
+WINLAMB_WMCRACKER(WM_NCHITTEST, nchittest);
+WINLAMB_WMCRACKER(WM_NCLBUTTONDBLCLK, nclbuttondblclk);
+WINLAMB_WMCRACKER(WM_NCLBUTTONDOWN, nclbuttondown);
+WINLAMB_WMCRACKER(WM_NCLBUTTONUP, nclbuttonup);
+WINLAMB_WMCRACKER(WM_NCMBUTTONDBLCLK, ncmbuttondblclk);
+WINLAMB_WMCRACKER(WM_NCMBUTTONDOWN, ncmbuttondown);
+WINLAMB_WMCRACKER(WM_NCMBUTTONUP, ncmbuttonup);
+WINLAMB_WMCRACKER(WM_NCMOUSEMOVE, ncmousemove);
+WINLAMB_WMCRACKER(WM_NCRBUTTONDBLCLK, ncrbuttondblclk);
+WINLAMB_WMCRACKER(WM_NCRBUTTONDOWN, ncrbuttondown);
+WINLAMB_WMCRACKER(WM_NCRBUTTONUP, ncrbuttonup);
+WINLAMB_WMCRACKER(WM_NCPAINT, ncpaint);
+WINLAMB_WMCRACKER(WM_NEXTDLGCTL, nextdlgctl);
+WINLAMB_WMCRACKER(WM_NEXTMENU, nextmenu);
+WINLAMB_WMCRACKER(WM_NOTIFYFORMAT, notifyformat);
+WINLAMB_WMCRACKER(WM_PAINT, paint);
+WINLAMB_WMCRACKER(WM_PAINTCLIPBOARD, paintclipboard);
+WINLAMB_WMCRACKER(WM_PALETTECHANGED, palettechanged);
+WINLAMB_WMCRACKER(WM_PALETTEISCHANGING, paletteischanging);
+WINLAMB_WMCRACKER(WM_PARENTNOTIFY, parentnotify);
+WINLAMB_WMCRACKER(WM_POWERBROADCAST, powerbroadcast);
+WINLAMB_WMCRACKER(WM_PRINT, print);
+WINLAMB_WMCRACKER(WM_PRINTCLIENT, printclient);
+WINLAMB_WMCRACKER(WM_QUERYDRAGICON, querydragicon);
+WINLAMB_WMCRACKER(WM_QUERYENDSESSION, queryendsession);
+WINLAMB_WMCRACKER(WM_QUERYNEWPALETTE, querynewpalette);
+WINLAMB_WMCRACKER(WM_QUERYOPEN, queryopen);
+#ifdef _RAS_H_ // Ras.h
+WINLAMB_WMCRACKER(WM_RASDIALEVENT, rasdialevent);
+#endif
+WINLAMB_WMCRACKER(WM_RENDERALLFORMATS, renderallformats);
+WINLAMB_WMCRACKER(WM_RENDERFORMAT, renderformat);
+WINLAMB_WMCRACKER(WM_SETCURSOR, setcursor);
+WINLAMB_WMCRACKER(WM_SETFOCUS, setfocus);
+WINLAMB_WMCRACKER(WM_SETFONT, setfont);
+WINLAMB_WMCRACKER(WM_SETHOTKEY, sethotkey);
+WINLAMB_WMCRACKER(WM_SETICON, seticon);
+WINLAMB_WMCRACKER(WM_SETREDRAW, setredraw);
+WINLAMB_WMCRACKER(WM_SETTEXT, settext);
+WINLAMB_WMCRACKER(WM_SETTINGCHANGE, settingchange);
+WINLAMB_WMCRACKER(WM_SHOWWINDOW, showwindow);
+WINLAMB_WMCRACKER(WM_SIZE, size);
+WINLAMB_WMCRACKER(WM_SIZECLIPBOARD, sizeclipboard);
+WINLAMB_WMCRACKER(WM_SIZING, sizing);
+WINLAMB_WMCRACKER(WM_SPOOLERSTATUS, spoolerstatus);
+WINLAMB_WMCRACKER(WM_STYLECHANGED, stylechanged);
+WINLAMB_WMCRACKER(WM_STYLECHANGING, stylechanging);
+WINLAMB_WMCRACKER(WM_SYSCHAR, syschar);
+WINLAMB_WMCRACKER(WM_SYSCOMMAND, syscommand);
+WINLAMB_WMCRACKER(WM_SYSDEADCHAR, sysdeadchar);
+WINLAMB_WMCRACKER(WM_SYSKEYDOWN, syskeydown);
+WINLAMB_WMCRACKER(WM_SYSKEYUP, syskeyup);
+WINLAMB_WMCRACKER(WM_TCARD, tcard);
+WINLAMB_WMCRACKER(WM_TIMECHANGE, timechange);
+WINLAMB_WMCRACKER(WM_TIMER, timer);
+WINLAMB_WMCRACKER(WM_UNINITMENUPOPUP, uninitmenupopup);
+WINLAMB_WMCRACKER(WM_USERCHANGED, userchanged);
+WINLAMB_WMCRACKER(WM_VKEYTOITEM, vkeytoitem);
+WINLAMB_WMCRACKER(WM_WINDOWPOSCHANGED, windowposchanged);
+WINLAMB_WMCRACKER(WM_WINDOWPOSCHANGING, windowposchanging);
+
+WINLAMB_WMNCRACKER(CBEN_BEGINEDIT, cben::beginedit);
+WINLAMB_WMNCRACKER(CBEN_DELETEITEM, cben::deleteitem);
+WINLAMB_WMNCRACKER(CBEN_DRAGBEGIN, cben::dragbegin);
+WINLAMB_WMNCRACKER(CBEN_ENDEDIT, cben::endedit);
+WINLAMB_WMNCRACKER(CBEN_GETDISPINFO, cben::getdispinfo);
+WINLAMB_WMNCRACKER(CBEN_INSERTITEM, cben::insertitem);
+
+WINLAMB_WMNCRACKER(DTN_CLOSEUP, dtn::closeup);
+WINLAMB_WMNCRACKER(DTN_DATETIMECHANGE, dtn::datetimechange);
+WINLAMB_WMNCRACKER(DTN_DROPDOWN, dtn::dropdown);
+WINLAMB_WMNCRACKER(DTN_FORMAT, dtn::format);
+WINLAMB_WMNCRACKER(DTN_FORMATQUERY, dtn::formatquery);
+WINLAMB_WMNCRACKER(DTN_USERSTRING, dtn::userstring);
+WINLAMB_WMNCRACKER(DTN_WMKEYDOWN, dtn::wmkeydown);
+
+WINLAMB_WMNCRACKER(LVN_BEGINDRAG, lvn::begindrag);
+WINLAMB_WMNCRACKER(LVN_BEGINLABELEDIT, lvn::beginlabeledit);
+WINLAMB_WMNCRACKER(LVN_BEGINRDRAG, lvn::beginrdrag);
+WINLAMB_WMNCRACKER(LVN_BEGINSCROLL, lvn::beginscroll);
+WINLAMB_WMNCRACKER(LVN_COLUMNCLICK, lvn::columnclick);
+WINLAMB_WMNCRACKER(LVN_COLUMNDROPDOWN, lvn::columndropdown);
+WINLAMB_WMNCRACKER(LVN_COLUMNOVERFLOWCLICK, lvn::columnoverflowclick);
+WINLAMB_WMNCRACKER(LVN_DELETEALLITEMS, lvn::deleteallitems);
+WINLAMB_WMNCRACKER(LVN_DELETEITEM, lvn::deleteitem);
+WINLAMB_WMNCRACKER(LVN_ENDLABELEDIT, lvn::endlabeledit);
+WINLAMB_WMNCRACKER(LVN_ENDSCROLL, lvn::endscroll);
+WINLAMB_WMNCRACKER(LVN_GETDISPINFO, lvn::getdispinfo);
+WINLAMB_WMNCRACKER(LVN_GETEMPTYMARKUP, lvn::getemptymarkup);
+WINLAMB_WMNCRACKER(LVN_GETINFOTIP, lvn::getinfotip);
+WINLAMB_WMNCRACKER(LVN_HOTTRACK, lvn::hottrack);
+WINLAMB_WMNCRACKER(LVN_INCREMENTALSEARCH, lvn::incrementalsearch);
+WINLAMB_WMNCRACKER(LVN_INSERTITEM, lvn::insertitem);
+WINLAMB_WMNCRACKER(LVN_ITEMACTIVATE, lvn::itemactivate);
+WINLAMB_WMNCRACKER(LVN_ITEMCHANGED, lvn::itemchanged);
+WINLAMB_WMNCRACKER(LVN_ITEMCHANGING, lvn::itemchanging);
+WINLAMB_WMNCRACKER(LVN_KEYDOWN, lvn::keydown);
+WINLAMB_WMNCRACKER(LVN_LINKCLICK, lvn::linkclick);
+WINLAMB_WMNCRACKER(LVN_MARQUEEBEGIN, lvn::marqueebegin);
+WINLAMB_WMNCRACKER(LVN_ODCACHEHINT, lvn::odcachehint);
+WINLAMB_WMNCRACKER(LVN_ODFINDITEM, lvn::odfinditem);
+WINLAMB_WMNCRACKER(LVN_ODSTATECHANGED, lvn::odstatechanged);
+WINLAMB_WMNCRACKER(LVN_SETDISPINFO, lvn::setdispinfo);
+
+WINLAMB_WMNCRACKER(MCN_GETDAYSTATE, mcn::getdaystate);
+WINLAMB_WMNCRACKER(MCN_SELCHANGE, mcn::selchange);
+WINLAMB_WMNCRACKER(MCN_SELECT, mcn::select);
+WINLAMB_WMNCRACKER(MCN_VIEWCHANGE, mcn::viewchange);
+
+WINLAMB_WMNCRACKER(SBN_SIMPLEMODECHANGE, sbn::simplemodechange);
+
+WINLAMB_WMNCRACKER(TCN_FOCUSCHANGE, tcn::focuschange);
+WINLAMB_WMNCRACKER(TCN_GETOBJECT, tcn::getobject);
+WINLAMB_WMNCRACKER(TCN_KEYDOWN, tcn::keydown);
+WINLAMB_WMNCRACKER(TCN_SELCHANGE, tcn::selchange);
+WINLAMB_WMNCRACKER(TCN_SELCHANGING, tcn::selchanging);
+
+WINLAMB_WMNCRACKER(TRBN_THUMBPOSCHANGING, trbn::thumbposchanging);
+
+WINLAMB_WMNCRACKER(TTN_GETDISPINFO, ttn::getdispinfo);
+WINLAMB_WMNCRACKER(TTN_LINKCLICK, ttn::linkclick);
+WINLAMB_WMNCRACKER(TTN_POP, ttn::pop);
+WINLAMB_WMNCRACKER(TTN_SHOW, ttn::show);
+
+WINLAMB_WMNCRACKER(TVN_ASYNCDRAW, tvn::asyncdraw);
+WINLAMB_WMNCRACKER(TVN_BEGINDRAG, tvn::begindrag);
+WINLAMB_WMNCRACKER(TVN_BEGINLABELEDIT, tvn::beginlabeledit);
+WINLAMB_WMNCRACKER(TVN_BEGINRDRAG, tvn::beginrdrag);
+WINLAMB_WMNCRACKER(TVN_DELETEITEM, tvn::deleteitem);
+WINLAMB_WMNCRACKER(TVN_ENDLABELEDIT, tvn::endlabeledit);
+WINLAMB_WMNCRACKER(TVN_GETDISPINFO, tvn::getdispinfo);
+WINLAMB_WMNCRACKER(TVN_GETINFOTIP, tvn::getinfotip);
+WINLAMB_WMNCRACKER(TVN_ITEMCHANGED, tvn::itemchanged);
+WINLAMB_WMNCRACKER(TVN_ITEMCHANGING, tvn::itemchanging);
+WINLAMB_WMNCRACKER(TVN_ITEMEXPANDED, tvn::itemexpanded);
+WINLAMB_WMNCRACKER(TVN_ITEMEXPANDING, tvn::itemexpanding);
+WINLAMB_WMNCRACKER(TVN_KEYDOWN, tvn::keydown);
+WINLAMB_WMNCRACKER(TVN_SELCHANGED, tvn::selchanged);
+WINLAMB_WMNCRACKER(TVN_SELCHANGING, tvn::selchanging);
+WINLAMB_WMNCRACKER(TVN_SETDISPINFO, tvn::setdispinfo);
+WINLAMB_WMNCRACKER(TVN_SINGLEEXPAND, tvn::singleexpand);
+
+WINLAMB_WMNCRACKER(UDN_DELTAPOS, udn::deltapos);
+
+#undef WINLAMB_WMCRACKER
+#undef WINLAMB_WMNCRACKER
+
+}//namespace _wli
+}//namespace wl
@@ -9,7 +9,9 @@
 #include <crtdbg.h>
 #include <Windows.h>
 #include <CommCtrl.h>
+#include "file_write_behind.h"
 #include "lippincott.h"
+#include "thread_pool.h"
 #pragma comment(lib, "Comctl32.lib")
 
 namespace wl {
@@ -21,6 +23,8 @@ int run_main(HINSTANCE hInst, int cmdShow) noexcept {
 	try { // any exception which was not caught, except those from within message lambdas
 		wnd_mainT wndMain;
 		ret = wndMain.winmain_run(hInst, cmdShow);
+		thread_pool::instance().shutdown(); // finish background tasks while the window object is still alive
+		file_write_behind::instance().shutdown(); // including the files they saved
 	} catch (...) {
 		lippincott();
 		ret = -1;
@@ -0,0 +1,489 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cwctype>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "str_priv.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+namespace wl {
+namespace _wli {
+
+// Case- and diacritic-insensitive index of a list of strings, addressed by their
+// positions, for prefix and substring searches. It knows nothing about controls.
+// Each string has a fixed id, so the sorted set and the trigram postings, built by
+// the first query which needs them, are updated in place as strings change; only
+// the ids kept in position order are shifted, one block at a time.
+class search_index final {
+public:
+	static const size_t npos = -1;
+
+private:
+	static constexpr uint32_t _NONE = UINT32_MAX;
+
+	// Ids in position order, split in blocks, so an insertion or removal shifts the
+	// ids of one block and the starting positions of the following blocks.
+	class _position_list final {
+	private:
+		static constexpr size_t _MAX_BLOCK = 512; // split beyond this
+
+		struct _block final {
+			std::vector<uint32_t> ids;
+			size_t                start = 0; // position of the first id
+		};
+		struct _location final {
+			uint32_t block = _NONE, offset = 0;
+		};
+
+		std::vector<_block>    _blocks; // indexes don't change, so ids can refer to them
+		std::vector<uint32_t>  _order; // blocks in position order, none of them empty
+		std::vector<uint32_t>  _freeBlocks;
+		std::vector<_location> _where; // by id
+		size_t                 _count = 0;
+
+	public:
+		size_t size() const noexcept { return this->_count; }
+
+		bool contains(uint32_t id) const noexcept {
+			return id < this->_where.size() && this->_where[id].block != _NONE;
+		}
+
+		size_t pos_of(uint32_t id) const noexcept {
+			const _location& w = this->_where[id];
+			return this->_blocks[w.block].start + w.offset;
+		}
+
+		uint32_t id_at(size_t pos) const noexcept {
+			const _block& b = this->_blocks[this->_order[this->_rank_at(pos)]];
+			return b.ids[pos - b.start];
+		}
+
+		void insert(size_t pos, uint32_t id) {
+			if (id >= this->_where.size()) this->_where.resize(id + 1);
+			if (this->_order.empty()) this->_order.emplace_back(this->_new_block(0));
+
+			size_t rank = (pos == this->_count) ? this->_order.size() - 1 : this->_rank_at(pos);
+			uint32_t blk = this->_order[rank];
+			size_t offset = pos - this->_blocks[blk].start;
+			this->_blocks[blk].ids.insert(this->_blocks[blk].ids.begin() + offset, id);
+			this->_renumber(blk, offset);
+			++this->_count;
+			for (size_t r = rank + 1; r < this->_order.size(); ++r) ++this->_blocks[this->_order[r]].start;
+
+			if (this->_blocks[blk].ids.size() > _MAX_BLOCK) this->_split(rank);
+		}
+
+		uint32_t erase(size_t pos) {
+			size_t rank = this->_rank_at(pos);
+			uint32_t blk = this->_order[rank];
+			_block& b = this->_blocks[blk];
+			size_t offset = pos - b.start;
+			uint32_t id = b.ids[offset];
+			b.ids.erase(b.ids.begin() + offset);
+			this->_where[id].block = _NONE;
+			this->_renumber(blk, offset);
+			--this->_count;
+			for (size_t r = rank + 1; r < this->_order.size(); ++r) --this->_blocks[this->_order[r]].start;
+
+			if (b.ids.empty()) { // so block starts are always ascending
+				this->_order.erase(this->_order.begin() + rank);
+				this->_freeBlocks.emplace_back(blk);
+			}
+			return id;
+		}
+
+		void clear() noexcept {
+			this->_blocks.clear();
+			this->_order.clear();
+			this->_freeBlocks.clear();
+			this->_where.clear();
+			this->_count = 0;
+		}
+
+		// Walks the ids in position order.
+		struct cursor final {
+			size_t rank = 0, offset = 0;
+		};
+
+		cursor cursor_at(size_t pos) const noexcept {
+			if (pos >= this->_count) return {this->_order.size(), 0};
+			size_t rank = this->_rank_at(pos);
+			return {rank, pos - this->_blocks[this->_order[rank]].start};
+		}
+
+		bool at_end(const cursor& c) const noexcept { return c.rank >= this->_order.size(); }
+		uint32_t id_at(const cursor& c) const noexcept { return this->_blocks[this->_order[c.rank]].ids[c.offset]; }
+
+		void advance(cursor& c) const noexcept {
+			if (++c.offset == this->_blocks[this->_order[c.rank]].ids.size()) {
+				++c.rank;
+				c.offset = 0;
+			}
+		}
+
+		// Calls func(uint32_t id) for each id, in position order.
+		template<typename funcT>
+		void for_each(funcT&& func) const {
+			for (uint32_t blk : this->_order) {
+				for (uint32_t id : this->_blocks[blk].ids) func(id);
+			}
+		}
+
+	private:
+		size_t _rank_at(size_t pos) const noexcept { // pos must exist
+			auto it = std::upper_bound(this->_order.cbegin(), this->_order.cend(), pos,
+				[this](size_t p, uint32_t blk) -> bool { return p < this->_blocks[blk].start; });
+			return (it - this->_order.cbegin()) - 1;
+		}
+
+		uint32_t _new_block(size_t start) {
+			uint32_t blk;
+			if (this->_freeBlocks.empty()) {
+				blk = static_cast<uint32_t>(this->_blocks.size());
+				this->_blocks.emplace_back();
+			} else {
+				blk = this->_freeBlocks.back();
+				this->_freeBlocks.pop_back();
+			}
+			this->_blocks[blk].start = start;
+			return blk;
+		}
+
+		void _renumber(uint32_t blk, size_t fromOffset) noexcept {
+			const std::vector<uint32_t>& ids = this->_blocks[blk].ids;
+			for (size_t i = fromOffset; i < ids.size(); ++i) {
+				this->_where[ids[i]] = {blk, static_cast<uint32_t>(i)};
+			}
+		}
+
+		void _split(size_t rank) {
+			uint32_t blk = this->_order[rank];
+			size_t half = this->_blocks[blk].ids.size() / 2;
+			uint32_t newBlk = this->_new_block(this->_blocks[blk].start + half); // may reallocate _blocks
+			std::vector<uint32_t>& ids = this->_blocks[blk].ids;
+			this->_blocks[newBlk].ids.assign(ids.begin() + half, ids.end());
+			ids.resize(half);
+			this->_renumber(newBlk, 0);
+			this->_order.insert(this->_order.begin() + rank + 1, newBlk);
+		}
+	};
+
+	// Orders ids by folded string, then by position, an order which shifts don't change.
+	class _sorted_less final {
+	public:
+		using is_transparent = void;
+
+		struct key final {
+			const std::wstring* text;
+			size_t              pos;
+		};
+
+	private:
+		const search_index* _pIndex;
+
+	public:
+		explicit _sorted_less(const search_index* pIndex) noexcept : _pIndex{pIndex} { }
+
+		bool operator()(uint32_t a, uint32_t b) const noexcept { return _less(this->_key_of(a), this->_key_of(b)); }
+		bool operator()(uint32_t a, const key& b) const noexcept { return _less(this->_key_of(a), b); }
+		bool operator()(const key& a, uint32_t b) const noexcept { return _less(a, this->_key_of(b)); }
+
+	private:
+		key _key_of(uint32_t id) const noexcept {
+			return {&this->_pIndex->_folded[id], this->_pIndex->_positions.pos_of(id)};
+		}
+
+		static bool _less(const key& a, const key& b) noexcept {
+			int cmp = a.text->compare(*b.text);
+			return cmp < 0 || (cmp == 0 && a.pos < b.pos);
+		}
+	};
+
+	std::vector<std::wstring> _folded; // by id
+	std::vector<uint32_t>     _freeIds;
+	_position_list            _positions;
+
+	mutable std::set<uint32_t, _sorted_less> _sorted{_sorted_less{this}};
+	mutable std::unordered_map<uint64_t, std::vector<uint32_t>> _trigrams; // ids with each trigram, unordered; removed ones stay until compacted
+	mutable size_t _numPostings = 0, _numStale = 0;
+	mutable bool   _hasSorted = false, _hasTrigrams = false;
+
+public:
+	search_index() = default;
+	search_index(const search_index&) = delete; // the sorted set points to this
+	search_index& operator=(const search_index&) = delete;
+
+	// Returns the string lowercased and without diacritics, as stored in the index.
+	static std::wstring fold(std::wstring s) {
+		for (wchar_t& ch : s) ch = str_priv::remove_diacritic(ch);
+#ifdef _WIN32
+		if (!s.empty()) CharLowerBuffW(&s[0], static_cast<DWORD>(s.length()));
+#else
+		for (wchar_t& ch : s) ch = static_cast<wchar_t>(std::towlower(ch));
+#endif
+		return s;
+	}
+
+	// Returns the number of strings.
+	size_t size() const noexcept {
+		return this->_positions.size();
+	}
+
+	// Preallocates memory for the given number of strings.
+	search_index& reserve(size_t numStrings) {
+		this->_folded.reserve(numStrings);
+		return *this;
+	}
+
+	// Inserts a string at the given position, shifting the following ones; npos appends.
+	search_index& insert(size_t pos, const std::wstring& s) {
+		if (pos > this->size()) pos = this->size();
+		uint32_t id = this->_new_id(fold(s));
+		this->_positions.insert(pos, id);
+		this->_index(id);
+		return *this;
+	}
+
+	// Appends a string.
+	search_index& push_back(const std::wstring& s) {
+		return this->insert(npos, s);
+	}
+
+	// Replaces the string at the given position.
+	search_index& set(size_t pos, const std::wstring& s) {
+		if (pos < this->size()) {
+			uint32_t id = this->_positions.id_at(pos);
+			this->_unindex(id);
+			this->_folded[id] = fold(s);
+			this->_index(id);
+			this->_compact_trigrams();
+		}
+		return *this;
+	}
+
+	// Removes the string at the given position, shifting the following ones.
+	search_index& erase(size_t pos) {
+		if (pos < this->size()) {
+			this->_unindex(this->_positions.id_at(pos)); // while the position is still valid
+			uint32_t id = this->_positions.erase(pos);
+			std::wstring().swap(this->_folded[id]);
+			this->_freeIds.emplace_back(id);
+			this->_compact_trigrams();
+		}
+		return *this;
+	}
+
+	// Removes all strings.
+	search_index& clear() noexcept {
+		this->_sorted.clear();
+		this->_trigrams.clear();
+		this->_numPostings = this->_numStale = 0;
+		this->_hasSorted = this->_hasTrigrams = false;
+		this->_positions.clear();
+		this->_folded.clear();
+		this->_freeIds.clear();
+		return *this;
+	}
+
+	// Returns the first position, starting at startPos, whose string begins with (if
+	// partial) or equals the given text, optionally wrapping around; npos if not found.
+	size_t find(const wchar_t* text, bool partial, size_t startPos = 0, bool wrap = true) const {
+		if (!text || !this->size()) return npos;
+		std::wstring needle = fold(text);
+		this->_build_sorted();
+		auto first = this->_sorted.lower_bound(_sorted_less::key{&needle, 0});
+
+		if (!partial) { // all matches are equal, so they're sorted by position
+			auto found = this->_sorted.lower_bound(_sorted_less::key{&needle, startPos});
+			if (found != this->_sorted.end() && this->_folded[*found] == needle) return this->_positions.pos_of(*found);
+			return (wrap && first != this->_sorted.end() && this->_folded[*first] == needle) ?
+				this->_positions.pos_of(*first) : npos;
+		}
+
+		// Two walks in step, and the first one to end gives the answer: the matches, in
+		// text order, looking for the nearest position; and the positions, from startPos
+		// on, looking for a match. So both few and many matches are found quickly.
+		size_t best = npos, lowest = npos;
+		auto it = first;
+		_position_list::cursor cur = this->_positions.cursor_at(startPos);
+		size_t pos = startPos;
+		bool hasWrapped = false;
+		for (;;) {
+			if (it == this->_sorted.end() || !_begins_with(this->_folded[*it], needle)) {
+				return best != npos ? best : (wrap ? lowest : npos);
+			}
+			size_t matchPos = this->_positions.pos_of(*it++);
+			if (matchPos >= startPos && (best == npos || matchPos < best)) best = matchPos;
+			if (lowest == npos || matchPos < lowest) lowest = matchPos;
+
+			if (this->_positions.at_end(cur)) {
+				if (!wrap || hasWrapped) return npos; // no match from startPos on
+				cur = this->_positions.cursor_at(0);
+				pos = 0;
+				hasWrapped = true;
+			} else if (_begins_with(this->_folded[this->_positions.id_at(cur)], needle)) {
+				return pos;
+			} else {
+				this->_positions.advance(cur);
+				++pos;
+			}
+		}
+	}
+
+	// Returns the first position, starting at startPos, whose string begins with the given text.
+	size_t find_prefix(const wchar_t* prefix, size_t startPos = 0, bool wrap = true) const {
+		return this->find(prefix, true, startPos, wrap);
+	}
+
+	// Returns the positions of all strings which begin with the given text, ascending.
+	std::vector<size_t> find_all_prefix(const wchar_t* prefix) const {
+		std::vector<size_t> found;
+		if (!prefix || !this->size()) return found;
+		std::wstring needle = fold(prefix);
+		this->_build_sorted();
+
+		for (auto it = this->_sorted.lower_bound(_sorted_less::key{&needle, 0});
+			it != this->_sorted.end() && _begins_with(this->_folded[*it], needle); ++it)
+		{
+			found.emplace_back(this->_positions.pos_of(*it));
+		}
+		std::sort(found.begin(), found.end());
+		return found;
+	}
+
+	// Returns the positions of all strings which contain the given text, ascending.
+	std::vector<size_t> find_substring(const wchar_t* text) const {
+		std::vector<size_t> found;
+		if (!text || !*text) return found;
+		std::wstring needle = fold(text);
+
+		if (needle.length() < 3) { // too short for trigrams, just scan
+			size_t pos = 0;
+			this->_positions.for_each([&](uint32_t id) -> void {
+				if (this->_folded[id].find(needle) != std::wstring::npos) found.emplace_back(pos);
+				++pos;
+			});
+			return found;
+		}
+
+		this->_build_trigrams();
+		const std::vector<uint32_t>* pShortest = nullptr; // candidates are the rarest trigram's postings
+		for (size_t i = 0; i + 3 <= needle.length(); ++i) {
+			auto it = this->_trigrams.find(_trigram_key(&needle[i]));
+			if (it == this->_trigrams.end()) return found; // trigram appears nowhere
+			if (!pShortest || it->second.size() < pShortest->size()) pShortest = &it->second;
+		}
+		for (uint32_t id : *pShortest) { // removed or changed strings may still be there, so check them all
+			if (this->_positions.contains(id) && this->_folded[id].find(needle) != std::wstring::npos) {
+				found.emplace_back(this->_positions.pos_of(id));
+			}
+		}
+		std::sort(found.begin(), found.end());
+		found.erase(std::unique(found.begin(), found.end()), found.end()); // an id reused for a string with the same trigram
+		return found;
+	}
+
+private:
+	static bool _begins_with(const std::wstring& s, const std::wstring& prefix) noexcept {
+		return s.compare(0, prefix.length(), prefix) == 0;
+	}
+
+	static uint64_t _trigram_key(const wchar_t* p) noexcept {
+		return (static_cast<uint64_t>(static_cast<uint16_t>(p[0])) << 32) |
+			(static_cast<uint64_t>(static_cast<uint16_t>(p[1])) << 16) |
+			static_cast<uint64_t>(static_cast<uint16_t>(p[2]));
+	}
+
+	uint32_t _new_id(std::wstring&& folded) {
+		if (this->_freeIds.empty()) {
+			this->_folded.emplace_back(std::move(folded));
+			return static_cast<uint32_t>(this->_folded.size() - 1);
+		}
+		uint32_t id = this->_freeIds.back();
+		this->_freeIds.pop_back();
+		this->_folded[id] = std::move(folded);
+		return id;
+	}
+
+	void _index(uint32_t id) {
+		if (this->_hasSorted) this->_sorted.insert(id);
+		if (this->_hasTrigrams) this->_add_trigrams(id);
+	}
+
+	void _unindex(uint32_t id) {
+		if (this->_hasSorted) this->_sorted.erase(id);
+		if (this->_hasTrigrams) { // postings are left behind, see _compact_trigrams()
+			size_t len = this->_folded[id].length();
+			this->_numStale += len >= 3 ? len - 2 : 0; // at most
+		}
+	}
+
+	void _add_trigrams(uint32_t id) const {
+		const std::wstring& s = this->_folded[id];
+		for (size_t i = 0; i + 3 <= s.length(); ++i) {
+			std::vector<uint32_t>& postings = this->_trigrams[_trigram_key(&s[i])];
+			if (postings.empty() || postings.back() != id) { // same trigram twice in a string
+				postings.emplace_back(id);
+				++this->_numPostings;
+			}
+		}
+	}
+
+	void _build_sorted() const {
+		if (this->_hasSorted) return;
+		struct entry final {
+			uint64_t head; // first 4 chars, so most comparisons don't touch the strings
+			uint32_t pos, id;
+		};
+		std::vector<entry> entries;
+		entries.reserve(this->size());
+		this->_positions.for_each([this, &entries](uint32_t id) -> void {
+			const std::wstring& s = this->_folded[id];
+			uint64_t head = 0;
+			for (size_t c = 0; c < 4; ++c) {
+				head = (head << 16) | (c < s.length() ? static_cast<uint16_t>(s[c]) : 0);
+			}
+			entries.push_back({head, static_cast<uint32_t>(entries.size()), id});
+		});
+		std::sort(entries.begin(), entries.end(), [this](const entry& a, const entry& b) -> bool {
+			if (a.head != b.head) return a.head < b.head;
+			int cmp = this->_folded[a.id].compare(this->_folded[b.id]);
+			return cmp < 0 || (cmp == 0 && a.pos < b.pos);
+		});
+		for (const entry& e : entries) {
+			this->_sorted.emplace_hint(this->_sorted.end(), e.id);
+		}
+		this->_hasSorted = true;
+	}
+
+	void _build_trigrams() const {
+		if (this->_hasTrigrams) return;
+		this->_positions.for_each([this](uint32_t id) -> void { this->_add_trigrams(id); });
+		this->_hasTrigrams = true;
+	}
+
+	void _compact_trigrams() {
+		if (this->_hasTrigrams && this->_numStale * 2 > this->_numPostings) { // about half are left behind
+			this->_trigrams.clear();
+			this->_numPostings = this->_numStale = 0;
+			this->_hasTrigrams = false;
+			this->_build_trigrams();
+		}
+	}
+};
+
+}//namespace _wli
+}//namespace wl
@@ -0,0 +1,51 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+
+// The widest SIMD instructions enabled at compile time; code using them must also
+// have a scalar fallback, for when none is.
+#if defined(__AVX2__)
+#define WINLAMB_SIMD_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WINLAMB_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace wl {
+namespace _wli {
+namespace simd {
+
+// Returns the index of the lowest set bit; mask can't be zero.
+inline unsigned bit_scan_forward(unsigned mask) noexcept {
+#ifdef _MSC_VER
+	unsigned long idx = 0;
+	_BitScanForward(&idx, mask);
+	return idx;
+#else
+	return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// Returns the index of the highest set bit; mask can't be zero.
+inline unsigned bit_scan_reverse(unsigned mask) noexcept {
+#ifdef _MSC_VER
+	unsigned long idx = 0;
+	_BitScanReverse(&idx, mask);
+	return idx;
+#else
+	return 31u - static_cast<unsigned>(__builtin_clz(mask));
+#endif
+}
+
+}//namespace simd
+}//namespace _wli
+}//namespace wl
@@ -6,8 +6,9 @@
  */
 
 #pragma once
-#include <functional>
+#include <utility>
 #include <vector>
+#include "callable.h"
 #include "params.h"
 
 namespace wl {
@@ -16,17 +17,28 @@ namespace _wli {
 // Generic storage for message identifiers and their respective lambda handlers.
 template<typename idT, typename retT>
 class store final {
+public:
+	using func_type = callable<retT(params)>; // retT is LRESULT or INT_PTR
+
 private:
 	struct _msg_unit final {
-		idT                         id;   // UINT, WORD or {UINT_PTR, UINT}
-		std::function<retT(params)> func; // retT is LRESULT or INT_PTR
+		idT    id{};        // UINT, WORD or {UINT_PTR, UINT}
+		size_t funcIdx = 0; // several ids may share the same func
 
 		_msg_unit() = default;
-		_msg_unit(idT id, std::function<retT(params)> func) noexcept :
-			id(id), func(std::move(func)) { }
+		_msg_unit(idT id, size_t funcIdx) noexcept :
+			id(id), funcIdx(funcIdx) { }
 	};
 
-	std::vector<_msg_unit> _msgUnits;
+	struct _index_slot final {
+		idT    id{};
+		size_t unitIdx = 0; // zero is the sentinel, so it means an empty slot
+	};
+
+	std::vector<_msg_unit>   _msgUnits;
+	std::vector<func_type>   _funcs;
+	std::vector<_index_slot> _index; // open addressing hash table, built by freeze()
+	size_t                   _indexMask = 0;
 
 public:
 	explicit store(size_t msgsReserve = 0) {
@@ -40,31 +52,76 @@ public:
 
 	void reserve(size_t msgsReserve) {
 		this->_msgUnits.reserve(msgsReserve + 1); // +1 because sentinel
+		this->_funcs.reserve(msgsReserve);
 	}
 
-	void add(idT id, std::function<retT(params)> func) {
-		this->_msgUnits.emplace_back(id, std::move(func)); // reverse search: messages can be overwritten by a later one
+	void add(idT id, func_type func) {
+		this->_index.clear(); // any frozen index is now stale, fall back to linear search
+		this->_funcs.emplace_back(std::move(func));
+		this->_msgUnits.emplace_back(id, this->_funcs.size() - 1); // reverse search: messages can be overwritten by a later one
 	}
 
-	void add(std::initializer_list<idT> ids, std::function<retT(params)> func) {
+	void add(std::initializer_list<idT> ids, func_type func) {
 		const idT* pIds = ids.begin();
 		this->add(pIds[0], std::move(func)); // store user func once
-		size_t funcIdx = this->_msgUnits.size() - 1;
+		size_t funcIdx = this->_funcs.size() - 1;
 		for (size_t i = 1; i < ids.size(); ++i) {
 			if (pIds[i] != pIds[0]) { // avoid overwriting
-				this->add(pIds[i], [this, funcIdx](params p) -> retT {
-					return this->_msgUnits[funcIdx].func(p); // store light wrapper to 1st func
-				});
+				this->_msgUnits.emplace_back(pIds[i], funcIdx); // other ids just point to 1st func
 			}
 		}
 	}
 
-	std::function<retT(params)>* find(idT id) {
+	// Builds the hash index, called once no more handlers are expected to be added.
+	void freeze() {
+		this->_index.clear();
+		if (this->empty()) return;
+
+		size_t numSlots = 8;
+		while (numSlots < (this->_msgUnits.size() - 1) * 2) numSlots <<= 1; // load factor at most 50%
+		this->_index.resize(numSlots);
+		this->_indexMask = numSlots - 1;
+
+		for (size_t i = 1; i < this->_msgUnits.size(); ++i) { // in registration order, so the last one wins
+			_index_slot* pSlot = this->_find_slot(this->_msgUnits[i].id);
+			pSlot->id = this->_msgUnits[i].id;
+			pSlot->unitIdx = i;
+		}
+	}
+
+	func_type* find(idT id) {
+		if (!this->_index.empty()) { // frozen, O(1) lookup
+			_index_slot* pSlot = this->_find_slot(id);
+			return pSlot->unitIdx ?
+				&this->_funcs[this->_msgUnits[pSlot->unitIdx].funcIdx] : nullptr;
+		}
+
 		this->_msgUnits[0].id = id; // sentinel for reverse linear search
 		_msg_unit* revRunner = &this->_msgUnits.back(); // pointer to last element
 		while (revRunner->id != id) --revRunner;
 		return revRunner == &this->_msgUnits[0] ? // if we stopped only at 1st element, id wasn't found
-			nullptr : &revRunner->func;
+			nullptr : &this->_funcs[revRunner->funcIdx];
+	}
+
+private:
+	_index_slot* _find_slot(const idT& id) noexcept {
+		// Linear probing; since the table is never full, it always stops at
+		// either the slot holding the id, or the empty slot where it would be.
+		size_t pos = _hash(id) & this->_indexMask;
+		while (this->_index[pos].unitIdx && this->_index[pos].id != id) {
+			pos = (pos + 1) & this->_indexMask;
+		}
+		return &this->_index[pos];
+	}
+
+	static size_t _hash(UINT_PTR id) noexcept {
+		// Fibonacci hashing, spreads contiguous identifiers like WM_ and command IDs.
+		unsigned long long h = static_cast<unsigned long long>(id) * 0x9E3779B97F4A7C15ull;
+		return static_cast<size_t>(h >> 29);
+	}
+
+	static size_t _hash(const std::pair<UINT_PTR, UINT>& id) noexcept {
+		return _hash(id.first ^ (static_cast<UINT_PTR>(id.second) * 0x01000193u));
 	}
 };
 
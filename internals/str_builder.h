@@ -0,0 +1,164 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "str_format.h"
+
+namespace wl {
+namespace _wli {
+
+// Builds a string by appending pieces. Short strings live on the stack; longer ones
+// go to heap chunks which are never moved, each one at least as big as all the text
+// before it, so appending never copies what was already written. The string is
+// materialized only once, at the end.
+class str_builder final {
+private:
+	struct _chunk final {
+		std::unique_ptr<wchar_t[]> buf;
+		size_t len, cap;
+	};
+
+	static const size_t _INLINE_LEN = 128; // chars on the stack
+	static const size_t _MIN_CHUNK = 1024; // chars of the first heap chunk
+
+	wchar_t             _inline[_INLINE_LEN];
+	size_t              _inlineLen = 0;
+	std::vector<_chunk> _chunks; // the last one is the tail, if any
+	size_t              _len = 0;
+
+public:
+	str_builder() = default;
+	str_builder(const str_builder&) = delete;
+	str_builder& operator=(const str_builder&) = delete;
+
+	// Constructor with an estimate of the final length.
+	explicit str_builder(size_t reserveChars) {
+		this->reserve(reserveChars);
+	}
+
+	size_t length() const noexcept { return this->_len; }
+	bool   empty() const noexcept  { return this->_len == 0; }
+
+	// Makes sure the given number of chars can be appended with no further allocations.
+	str_builder& reserve(size_t numChars) {
+		this->prepare(numChars);
+		return *this;
+	}
+
+	// Removes all the text, keeping the biggest chunk for reuse.
+	str_builder& clear() noexcept {
+		if (this->_chunks.size() > 1) {
+			std::swap(this->_chunks.front(), this->_chunks.back());
+			this->_chunks.resize(1);
+		}
+		if (!this->_chunks.empty()) this->_chunks.front().len = 0;
+		this->_inlineLen = 0;
+		this->_len = 0;
+		return *this;
+	}
+
+	// Returns a pointer to the tail, where up to numChars can be written, then commit()
+	// must be called.
+	wchar_t* prepare(size_t numChars) {
+		if (this->_chunks.empty()) {
+			if (_INLINE_LEN - this->_inlineLen >= numChars) return this->_inline + this->_inlineLen;
+		} else {
+			_chunk& tail = this->_chunks.back();
+			if (tail.cap - tail.len >= numChars) return tail.buf.get() + tail.len;
+		}
+		// What's left of the tail is skipped: text is never split across chunks.
+		size_t cap = std::max({numChars, _MIN_CHUNK, this->_len});
+		this->_chunks.push_back({std::unique_ptr<wchar_t[]>(new wchar_t[cap]), 0, cap});
+		return this->_chunks.back().buf.get();
+	}
+
+	// Accounts for numChars written at the pointer returned by prepare().
+	void commit(size_t numChars) noexcept {
+		if (this->_chunks.empty()) {
+			this->_inlineLen += numChars;
+		} else {
+			this->_chunks.back().len += numChars;
+		}
+		this->_len += numChars;
+	}
+
+	str_builder& append(std::wstring_view s) {
+		std::copy(s.cbegin(), s.cend(), this->prepare(s.length()));
+		this->commit(s.length());
+		return *this;
+	}
+
+	str_builder& append(const wchar_t* s, size_t len) {
+		return this->append(std::wstring_view{s, len});
+	}
+
+	str_builder& append(wchar_t ch) {
+		*this->prepare(1) = ch;
+		this->commit(1);
+		return *this;
+	}
+
+	// Appends the arguments formatted like str::fmt(), written straight into the tail.
+	template<typename ...argsT>
+	str_builder& append_fmt(fmt_string<typename fmt_identity<argsT>::type...> strFormat, const argsT&... args) {
+		fmt_engine::format_to(*this, strFormat, args...);
+		return *this;
+	}
+
+	// Calls func(std::wstring_view) for each contiguous piece of the text, in order. A
+	// surrogate pair is never split between two pieces.
+	template<typename funcT>
+	void for_each_piece(funcT&& func) const {
+		wchar_t pair[2];
+		bool hasHigh = false; // last piece ended with a high surrogate, held in pair[0]
+
+		auto emit = [&](std::wstring_view piece) -> void {
+			if (piece.empty()) return;
+			if (hasHigh) {
+				pair[1] = piece.front();
+				func(std::wstring_view{pair, 2});
+				piece.remove_prefix(1);
+				hasHigh = false;
+			}
+			if (!piece.empty() && piece.back() >= 0xD800 && piece.back() <= 0xDBFF) {
+				pair[0] = piece.back();
+				piece.remove_suffix(1);
+				hasHigh = true;
+			}
+			if (!piece.empty()) func(piece);
+		};
+
+		emit({this->_inline, this->_inlineLen});
+		for (const _chunk& chunk : this->_chunks) {
+			emit({chunk.buf.get(), chunk.len});
+		}
+		if (hasHigh) func(std::wstring_view{pair, 1});
+	}
+
+	// Returns the text as a single string, allocated once.
+	std::wstring str() const {
+		std::wstring ret;
+		this->append_to(ret);
+		return ret;
+	}
+
+	// Appends the text to the given string, reusing its memory when possible.
+	void append_to(std::wstring& s) const {
+		s.reserve(s.length() + this->_len);
+		this->for_each_piece([&s](std::wstring_view piece) -> void {
+			s.append(piece.data(), piece.length());
+		});
+	}
+};
+
+}//namespace _wli
+}//namespace wl
@@ -0,0 +1,352 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "str_transcode.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+namespace wl {
+namespace _wli {
+
+// Possible string encodings.
+enum class encoding { UNKNOWN, ASCII, WIN1252, UTF8, UTF16BE, UTF16LE, UTF32BE, UTF32LE, SCSU, BOCU1 };
+
+// Encoding information of a string.
+struct encoding_info final {
+	encoding encType = encoding::UNKNOWN;
+	size_t   bomSize = 0;
+};
+
+// Decodes text fed chunk by chunk, with constant memory. Unless told, the encoding is
+// decided from the BOM or from a bounded prefix, and code units split across chunks
+// are joined. Output is the same as decoding the whole data at once.
+class str_decoder final {
+public:
+	static constexpr size_t DETECT_LEN = 4096; // prefix used to guess the encoding
+
+private:
+	static const size_t _MIN_WIDE_ZEROS = 30; // percent of UTF-16 units with a zero byte, for ASCII-like text
+	static const size_t _MIN_UTF8_CONFIDENCE = 90; // percent of non-ASCII sequences which must be valid UTF-8
+
+	encoding          _encType = encoding::UNKNOWN; // until decided
+	bool              _isForced = false, _isAsciiSoFar = false, _isFirstChunk = true;
+	std::vector<BYTE> _pending; // prefix being examined, or a partial sequence
+
+public:
+	str_decoder() = default;
+
+	// The BOM, if matching the given encoding, is still skipped.
+	explicit str_decoder(encoding encType) :
+		_encType{encType}, _isForced{encType != encoding::UNKNOWN} { }
+
+	// Returns the encoding, which is UNKNOWN until enough data is fed.
+	encoding get_encoding() const noexcept {
+		return this->_isAsciiSoFar ? encoding::ASCII : this->_encType;
+	}
+
+	// Guesses the encoding of the given data: the BOM is checked, then a prefix of up to
+	// DETECT_LEN bytes. If it's all ASCII, the first non-ASCII byte found, if any,
+	// starts another prefix to choose between UTF-8 and Windows-1252.
+	static encoding_info detect(const BYTE* data, size_t sz) noexcept {
+		encoding_info info = _detect_bom(data, sz);
+		if (info.encType != encoding::UNKNOWN) return info;
+
+		size_t prefixLen = std::min(sz, DETECT_LEN);
+		info.encType = _guess(data, prefixLen, prefixLen == sz, true);
+		if (info.encType == encoding::ASCII) {
+			size_t firstNonAscii = prefixLen + str_transcode::ascii_length(data + prefixLen, sz - prefixLen);
+			if (firstNonAscii < sz) {
+				prefixLen = std::min(sz - firstNonAscii, DETECT_LEN);
+				info.encType = _guess(data + firstNonAscii, prefixLen, firstNonAscii + prefixLen == sz, false);
+			}
+		}
+		return info;
+	}
+
+	// Decodes a chunk, appending to out; a few trailing bytes may be kept until the
+	// next chunk. While the encoding isn't decided, the chunk is just stored.
+	str_decoder& decode(const BYTE* data, size_t sz, std::wstring& out) {
+		while (sz) {
+			if (this->_encType == encoding::UNKNOWN) {
+				size_t numTake = std::min(sz, DETECT_LEN - this->_pending.size());
+				this->_pending.insert(this->_pending.end(), data, data + numTake);
+				data += numTake;
+				sz -= numTake;
+				if (this->_pending.size() < DETECT_LEN) break; // wait for more
+				this->_decide_and_decode_prefix(false, out);
+			} else if (this->_isAsciiSoFar) {
+				size_t numAscii = str_transcode::ascii_length(data, sz);
+				this->_convert(data, numAscii, out);
+				data += numAscii;
+				sz -= numAscii;
+				if (sz) { // first non-ASCII byte, guess again from here
+					this->_encType = encoding::UNKNOWN;
+					this->_isAsciiSoFar = false;
+				}
+			} else {
+				this->_decode_chunk(data, sz, out);
+				break;
+			}
+		}
+		return *this;
+	}
+
+	// Decodes a chunk, appending to out.
+	str_decoder& decode(const std::vector<BYTE>& data, std::wstring& out) {
+		return data.empty() ? *this : this->decode(&data[0], data.size(), out);
+	}
+
+	// Decodes anything kept from previous chunks, appending to out. An incomplete
+	// trailing sequence becomes U+FFFD.
+	str_decoder& finish(std::wstring& out) {
+		if (this->_encType == encoding::UNKNOWN && !this->_pending.empty()) {
+			this->_decide_and_decode_prefix(true, out);
+		} else if (this->_isFirstChunk && !this->_pending.empty()) { // forced encoding, too short to check the BOM before
+			size_t bomSize = this->_matching_bom_size(&this->_pending[0], this->_pending.size());
+			this->_pending.erase(this->_pending.begin(), this->_pending.begin() + bomSize);
+		}
+		this->_isFirstChunk = false;
+		if (!this->_pending.empty()) {
+			this->_convert(&this->_pending[0], this->_pending.size(), out);
+			this->_pending.clear();
+		}
+		return *this;
+	}
+
+	// Discards any pending data and forgets the encoding, unless given in the constructor.
+	str_decoder& reset() noexcept {
+		if (!this->_isForced) this->_encType = encoding::UNKNOWN;
+		this->_isAsciiSoFar = false;
+		this->_isFirstChunk = true;
+		this->_pending.clear();
+		return *this;
+	}
+
+private:
+	static encoding_info _detect_bom(const BYTE* data, size_t sz) noexcept {
+		auto match = [&](const BYTE* pBom, size_t szBom) noexcept -> bool {
+			return sz >= szBom && !memcmp(data, pBom, szBom);
+		};
+
+		// https://en.wikipedia.org/wiki/Byte_order_mark
+
+		BYTE utf8[] = {0xEF, 0xBB, 0xBF};
+		if (match(utf8, 3)) return {encoding::UTF8, 3}; // BOM size in bytes
+
+		BYTE utf32le[] = {0xFF, 0xFE, 0x00, 0x00}; // before UTF-16LE, which has the same start
+		if (match(utf32le, 4)) return {encoding::UTF32LE, 4};
+
+		BYTE utf32be[] = {0x00, 0x00, 0xFE, 0xFF};
+		if (match(utf32be, 4)) return {encoding::UTF32BE, 4};
+
+		BYTE utf16be[] = {0xFE, 0xFF};
+		if (match(utf16be, 2)) return {encoding::UTF16BE, 2};
+
+		BYTE utf16le[] = {0xFF, 0xFE};
+		if (match(utf16le, 2)) return {encoding::UTF16LE, 2};
+
+		BYTE scsu[] = {0x0E, 0xFE, 0xFF};
+		if (match(scsu, 3)) return {encoding::SCSU, 3};
+
+		BYTE bocu1[] = {0xFB, 0xEE, 0x28};
+		if (match(bocu1, 3)) return {encoding::BOCU1, 3};
+
+		return {};
+	}
+
+	// Guesses the encoding of a prefix without BOM; isWhole tells whether it's all data.
+	static encoding _guess(const BYTE* data, size_t sz, bool isWhole, bool allowWide) noexcept {
+		if (allowWide) {
+			if (_looks_utf32(data, sz, false)) return encoding::UTF32LE;
+			if (_looks_utf32(data, sz, true)) return encoding::UTF32BE;
+
+			size_t evenZeros = 0, oddZeros = 0, numUnits = sz / 2;
+			for (size_t i = 0; i < numUnits * 2; i += 2) {
+				if (!data[i]) ++evenZeros;
+				if (!data[i + 1]) ++oddZeros;
+			}
+			if (numUnits && evenZeros * 100 < numUnits && oddZeros * 100 >= numUnits * _MIN_WIDE_ZEROS) {
+				return encoding::UTF16LE;
+			} else if (numUnits && oddZeros * 100 < numUnits && evenZeros * 100 >= numUnits * _MIN_WIDE_ZEROS) {
+				return encoding::UTF16BE;
+			}
+		}
+
+		size_t numValid = 0, numInvalid = 0; // non-ASCII sequences
+		for (size_t i = str_transcode::ascii_length(data, sz); i < sz; ) {
+			if (data[i] < 0x80) {
+				++i;
+				continue;
+			}
+			uint32_t cp = 0;
+			size_t numBytes = 0;
+			if (str_transcode::decode_utf8_char(data + i, sz - i, cp, numBytes)) {
+				++numValid;
+			} else if (isWhole || i + numBytes < sz) { // else it's just cut by the prefix end
+				++numInvalid;
+			}
+			i += numBytes;
+		}
+		if (!numValid && !numInvalid) return encoding::ASCII;
+		return (numValid * 100 >= (numValid + numInvalid) * _MIN_UTF8_CONFIDENCE) ?
+			encoding::UTF8 : encoding::WIN1252;
+	}
+
+	static bool _looks_utf32(const BYTE* data, size_t sz, bool bigEndian) noexcept {
+		size_t numUnits = sz / 4, numNonNull = 0;
+		for (size_t i = 0; i < numUnits; ++i) {
+			const BYTE* p = data + i * 4;
+			BYTE b2 = bigEndian ? p[1] : p[2], b3 = bigEndian ? p[0] : p[3];
+			if (b3 || b2 > 0x10) return false; // beyond U+10FFFF, which is very likely with other encodings
+			if (p[0] || p[1] || p[2] || p[3]) ++numNonNull;
+		}
+		return numNonNull > 0;
+	}
+
+	void _decide_and_decode_prefix(bool isWhole, std::wstring& out) {
+		std::vector<BYTE> prefix;
+		prefix.swap(this->_pending);
+		size_t bomSize = 0;
+
+		if (this->_isFirstChunk) {
+			encoding_info bom = _detect_bom(&prefix[0], prefix.size());
+			if (bom.encType != encoding::UNKNOWN && (!this->_isForced || bom.encType == this->_encType)) {
+				this->_encType = bom.encType;
+				bomSize = bom.bomSize;
+			}
+		}
+		if (this->_encType == encoding::UNKNOWN) {
+			this->_encType = _guess(&prefix[0], prefix.size(), isWhole, this->_isFirstChunk);
+			if (this->_encType == encoding::ASCII) {
+				this->_encType = encoding::UTF8; // until a non-ASCII byte shows up
+				this->_isAsciiSoFar = true;
+			}
+		}
+		this->_isFirstChunk = false;
+
+		switch (this->_encType) {
+		case encoding::SCSU:  throw std::invalid_argument("Standard compression scheme for Unicode: encoding not implemented.");
+		case encoding::BOCU1: throw std::invalid_argument("Binary ordered compression for Unicode: encoding not implemented.");
+		default: break;
+		}
+		this->decode(&prefix[0] + bomSize, prefix.size() - bomSize, out);
+	}
+
+	void _decode_chunk(const BYTE* data, size_t sz, std::wstring& out) {
+		if (this->_isFirstChunk) { // forced encoding, check the BOM anyway
+			if (this->_pending.size() + sz < 4) { // too short to tell yet
+				this->_pending.insert(this->_pending.end(), data, data + sz);
+				return;
+			}
+			this->_isFirstChunk = false;
+			if (!this->_pending.empty()) {
+				std::vector<BYTE> joined;
+				joined.swap(this->_pending);
+				joined.insert(joined.end(), data, data + sz);
+				size_t bomSize = this->_matching_bom_size(&joined[0], joined.size());
+				this->_decode_chunk(&joined[0] + bomSize, joined.size() - bomSize, out);
+				return;
+			}
+			size_t bomSize = this->_matching_bom_size(data, sz);
+			data += bomSize;
+			sz -= bomSize;
+		}
+
+		if (!this->_pending.empty()) { // complete the partial sequence from the previous chunk
+			size_t seqLen = this->_sequence_length(this->_pending[0]);
+			while (this->_pending.size() < seqLen && sz &&
+				(this->_encType != encoding::UTF8 || (*data & 0xC0) == 0x80)) // UTF-8 continuation byte
+			{
+				this->_pending.emplace_back(*data++);
+				--sz;
+			}
+			if (this->_pending.size() < seqLen && !sz) return; // still incomplete
+			this->_convert(&this->_pending[0], this->_pending.size(), out);
+			this->_pending.clear();
+		}
+
+		size_t completeLen = this->_complete_length(data, sz);
+		this->_convert(data, completeLen, out);
+		this->_pending.assign(data + completeLen, data + sz);
+	}
+
+	size_t _matching_bom_size(const BYTE* data, size_t sz) const noexcept {
+		encoding_info bom = _detect_bom(data, sz);
+		return bom.encType == this->_encType ? bom.bomSize : 0;
+	}
+
+	// Returns the number of bytes of the sequence beginning with the given byte.
+	size_t _sequence_length(BYTE first) const noexcept {
+		switch (this->_encType) {
+		case encoding::UTF8:    return str_transcode::utf8_sequence_length(first);
+		case encoding::UTF16BE:
+		case encoding::UTF16LE: return 2;
+		case encoding::UTF32BE:
+		case encoding::UTF32LE: return 4;
+		default:                return 1;
+		}
+	}
+
+	// Returns the length of the data without a trailing incomplete sequence.
+	size_t _complete_length(const BYTE* data, size_t sz) const noexcept {
+		switch (this->_encType) {
+		case encoding::UTF8:
+			for (size_t back = 1; back <= 3 && back <= sz; ++back) {
+				BYTE b = data[sz - back];
+				if ((b & 0xC0) != 0x80) { // not a continuation byte, so a sequence starts here
+					return (str_transcode::utf8_sequence_length(b) > back) ? sz - back : sz;
+				}
+			}
+			return sz;
+		case encoding::UTF16BE:
+		case encoding::UTF16LE: return sz & ~static_cast<size_t>(1);
+		case encoding::UTF32BE:
+		case encoding::UTF32LE: return sz & ~static_cast<size_t>(3);
+		default:                return sz;
+		}
+	}
+
+	// Converts data which has only complete sequences, but for the last call.
+	void _convert(const BYTE* data, size_t sz, std::wstring& out) const {
+		if (!sz) return;
+		size_t origLen = out.length();
+		bool isWide = this->_encType >= encoding::UTF16BE && this->_encType <= encoding::UTF32LE;
+		out.resize(origLen + (isWide ? sz / 2 : sz) + 1); // UTF-32 may need 2 chars for 4 bytes
+		wchar_t* pDest = &out[origLen];
+		size_t numChars = 0;
+
+		switch (this->_encType) {
+		case encoding::UNKNOWN:
+		case encoding::ASCII:   numChars = str_transcode::latin1_to_utf16(data, sz, pDest); break;
+		case encoding::WIN1252: numChars = str_transcode::win1252_to_utf16(data, sz, pDest); break;
+		case encoding::UTF8:    numChars = str_transcode::utf8_to_utf16(data, sz, pDest); break;
+		case encoding::UTF16BE:
+		case encoding::UTF16LE:
+			numChars = str_transcode::utf16_to_utf16(data, sz / 2, this->_encType == encoding::UTF16BE, pDest);
+			if (sz % 2) pDest[numChars++] = 0xFFFD; // odd byte at the end
+			break;
+		case encoding::UTF32BE:
+		case encoding::UTF32LE:
+			numChars = str_transcode::utf32_to_utf16(data, sz / 4, this->_encType == encoding::UTF32BE, pDest);
+			if (sz % 4) pDest[numChars++] = 0xFFFD; // partial unit at the end
+			break;
+		default: break; // SCSU and BOCU1 throw before reaching here
+		}
+		out.resize(origLen + numChars);
+	}
+};
+
+}//namespace _wli
+}//namespace wl
@@ -0,0 +1,411 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// With consteval, a bad format string is a compile error; otherwise it's checked when
+// the format is built, at compile time only if in a constant expression.
+#if defined(__cpp_consteval)
+#define WINLAMB_FMT_CONSTEVAL consteval
+#else
+#define WINLAMB_FMT_CONSTEVAL constexpr
+#endif
+
+namespace wl {
+namespace _wli {
+
+// What was parsed from one {} placeholder, plus the literal text before it.
+struct fmt_spec final {
+	size_t  litBegin = 0, litLen = 0; // literal text before the placeholder
+	bool    litHasEscapes = false; // literal has {{ or }}
+	wchar_t type = 0; // 0, 'x' or 'X'
+	int     precision = -1; // digits after the point, for floats
+};
+
+// Kind of each argument type accepted by str::fmt().
+template<typename T>
+constexpr wchar_t fmt_kind() noexcept {
+	using U = std::decay_t<T>;
+	static_assert(!std::is_same_v<U, const char*> && !std::is_same_v<U, char*> && !std::is_same_v<U, std::string>,
+		"Non-wide string being used on str::fmt(), str::to_wstring() can fix it.");
+	if constexpr (std::is_same_v<U, bool>) return L'b';
+	else if constexpr (std::is_same_v<U, wchar_t>) return L'c';
+	else if constexpr (std::is_integral_v<U>) return L'i';
+	else if constexpr (std::is_floating_point_v<U>) return L'f';
+	else {
+		static_assert(std::is_convertible_v<const U&, std::wstring_view>,
+			"Type not supported by str::fmt().");
+		return L's';
+	}
+}
+
+template<typename T>
+struct fmt_identity final { using type = T; };
+
+// Format string for str::fmt(), with {} placeholders, parsed when it's built. Each
+// placeholder may be {:x} or {:X} for hex integers, or {:.N} for N decimal places;
+// {{ and }} are literal braces.
+template<typename ...argsT>
+class fmt_string final {
+private:
+	static const size_t _NUM_ARGS = sizeof...(argsT);
+
+	const wchar_t* _s = nullptr;
+	fmt_spec       _specs[_NUM_ARGS + 1]{}; // the last one has only the trailing literal
+
+public:
+	template<size_t N>
+	WINLAMB_FMT_CONSTEVAL fmt_string(const wchar_t (&s)[N]) : _s{s} {
+		constexpr wchar_t kinds[_NUM_ARGS + 1] = {fmt_kind<argsT>()..., 0};
+		size_t numArgs = 0, i = 0, litBegin = 0;
+		bool litHasEscapes = false;
+
+		while (i < N - 1) { // without terminating null
+			if (s[i] == L'}') {
+				if (i + 1 >= N - 1 || s[i + 1] != L'}') throw std::invalid_argument("Unmatched } in format string.");
+				litHasEscapes = true;
+				i += 2;
+			} else if (s[i] != L'{') {
+				++i;
+			} else if (i + 1 < N - 1 && s[i + 1] == L'{') {
+				litHasEscapes = true;
+				i += 2;
+			} else {
+				if (numArgs == _NUM_ARGS) throw std::invalid_argument("More placeholders than arguments in format string.");
+				fmt_spec& spec = this->_specs[numArgs];
+				spec.litBegin = litBegin;
+				spec.litLen = i - litBegin;
+				spec.litHasEscapes = litHasEscapes;
+				++i; // skip {
+
+				if (i < N - 1 && s[i] == L':') {
+					++i;
+					if (i < N - 1 && (s[i] == L'x' || s[i] == L'X')) {
+						if (kinds[numArgs] != L'i') throw std::invalid_argument("Hex format for a non-integer argument.");
+						spec.type = s[i++];
+					} else if (i < N - 1 && s[i] == L'.') {
+						if (kinds[numArgs] != L'f') throw std::invalid_argument("Precision for a non-float argument.");
+						++i;
+						spec.precision = 0;
+						for (; i < N - 1 && s[i] >= L'0' && s[i] <= L'9' && spec.precision < 100; ++i) {
+							spec.precision = spec.precision * 10 + (s[i] - L'0');
+						}
+						if (spec.precision > 99) throw std::invalid_argument("Precision beyond 99 in format string.");
+					}
+				}
+				if (i >= N - 1 || s[i] != L'}') throw std::invalid_argument("Bad placeholder in format string.");
+				++i; // skip }
+				++numArgs;
+				litBegin = i;
+				litHasEscapes = false;
+			}
+		}
+		if (numArgs != _NUM_ARGS) throw std::invalid_argument("Fewer placeholders than arguments in format string.");
+
+		fmt_spec& last = this->_specs[_NUM_ARGS];
+		last.litBegin = litBegin;
+		last.litLen = i - litBegin;
+		last.litHasEscapes = litHasEscapes;
+	}
+
+	const wchar_t*  str() const noexcept              { return this->_s; }
+	const fmt_spec& spec(size_t index) const noexcept { return this->_specs[index]; }
+};
+
+// Buffer which lives on the stack while short, for building a string in a single pass.
+class fmt_buffer final {
+private:
+	static const size_t _STACK_LEN = 256;
+
+	wchar_t                    _stack[_STACK_LEN];
+	std::unique_ptr<wchar_t[]> _heap;
+	wchar_t*                   _p = _stack;
+	size_t                     _len = 0, _cap = _STACK_LEN;
+
+public:
+	fmt_buffer() = default;
+	fmt_buffer(const fmt_buffer&) = delete;
+	fmt_buffer& operator=(const fmt_buffer&) = delete;
+
+	std::wstring str() const { return {this->_p, this->_len}; }
+
+	// Returns a pointer where up to numChars can be written, then commit() must be called.
+	wchar_t* prepare(size_t numChars) {
+		if (this->_len + numChars > this->_cap) {
+			size_t newCap = std::max(this->_cap * 2, this->_len + numChars);
+			std::unique_ptr<wchar_t[]> newHeap(new wchar_t[newCap]);
+			std::copy(this->_p, this->_p + this->_len, newHeap.get());
+			this->_heap = std::move(newHeap);
+			this->_p = this->_heap.get();
+			this->_cap = newCap;
+		}
+		return this->_p + this->_len;
+	}
+
+	void commit(size_t numChars) noexcept {
+		this->_len += numChars;
+	}
+
+	void append(const wchar_t* s, size_t len) {
+		std::copy(s, s + len, this->prepare(len));
+		this->commit(len);
+	}
+
+	void append(wchar_t ch) {
+		*this->prepare(1) = ch;
+		this->commit(1);
+	}
+};
+
+// Conversions between numbers and strings, with no locale and no allocations.
+class str_number final {
+private:
+	str_number() = delete;
+
+	static constexpr char _DIGIT_PAIRS[] =
+		"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+		"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+		"8081828384858687888990919293949596979899";
+
+public:
+	static const size_t MAX_INT_LEN = 24; // a 64-bit integer, with sign, and room to spare
+	static const size_t MAX_FLOAT_LEN = 32; // shortest form of any double
+
+	// Writes the integer backwards, ending at pEnd; returns a pointer to its first char.
+	// The thousand separator is used only if not zero.
+	template<typename intT>
+	static wchar_t* write_int_backwards(intT number, wchar_t* pEnd, wchar_t separator = 0) noexcept {
+		using uintT = std::make_unsigned_t<intT>;
+		bool isNegative = number < 0;
+		uintT val = isNegative ? static_cast<uintT>(0 - static_cast<uintT>(number)) : static_cast<uintT>(number);
+		wchar_t* p = pEnd;
+
+		if (separator) {
+			size_t numDigits = 0;
+			do {
+				if (numDigits && numDigits % 3 == 0) *--p = separator;
+				*--p = static_cast<wchar_t>(L'0' + val % 10);
+				val /= 10;
+				++numDigits;
+			} while (val);
+		} else {
+			while (val >= 100) {
+				size_t pair = static_cast<size_t>(val % 100) * 2;
+				val /= 100;
+				*--p = static_cast<wchar_t>(_DIGIT_PAIRS[pair + 1]);
+				*--p = static_cast<wchar_t>(_DIGIT_PAIRS[pair]);
+			}
+			if (val >= 10) {
+				size_t pair = static_cast<size_t>(val) * 2;
+				*--p = static_cast<wchar_t>(_DIGIT_PAIRS[pair + 1]);
+				*--p = static_cast<wchar_t>(_DIGIT_PAIRS[pair]);
+			} else {
+				*--p = static_cast<wchar_t>(L'0' + val);
+			}
+		}
+		if (isNegative) *--p = L'-';
+		return p;
+	}
+
+	// Writes the integer in hex, backwards, ending at pEnd; returns a pointer to its first char.
+	template<typename intT>
+	static wchar_t* write_hex_backwards(intT number, wchar_t* pEnd, bool upper) noexcept {
+		const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+		auto val = static_cast<std::make_unsigned_t<intT>>(number); // negatives as two's complement
+		wchar_t* p = pEnd;
+		do {
+			*--p = static_cast<wchar_t>(digits[val & 0xF]);
+			val >>= 4;
+		} while (val);
+		return p;
+	}
+
+	// Writes the float at dest, which must have room for MAX_FLOAT_LEN chars, or more if
+	// precision is given; returns the number of chars written. Without precision, the
+	// shortest form which reads back the same value is written.
+	static size_t write_float(double number, wchar_t* dest, size_t destLen, int precision = -1) noexcept {
+		char buf[MAX_FLOAT_LEN + 310 + 99]; // 1e308 in fixed notation, with the max precision
+		size_t len = 0;
+#if defined(__cpp_lib_to_chars)
+		std::to_chars_result res = (precision < 0) ?
+			std::to_chars(buf, buf + sizeof(buf), number) :
+			std::to_chars(buf, buf + sizeof(buf), number, std::chars_format::fixed, precision);
+		len = (res.ec == std::errc{}) ? static_cast<size_t>(res.ptr - buf) : 0;
+#else
+		if (precision >= 0) {
+			len = std::max(0, snprintf(buf, sizeof(buf), "%.*f", precision, number));
+		} else {
+			for (int digits = 15; digits <= 17; ++digits) { // shortest of the round-trip candidates
+				len = std::max(0, snprintf(buf, sizeof(buf), "%.*g", digits, number));
+				if (digits == 17 || strtod(buf, nullptr) == number) break;
+			}
+		}
+#endif
+		len = std::min({len, destLen, sizeof(buf)});
+		for (size_t i = 0; i < len; ++i) dest[i] = static_cast<wchar_t>(buf[i]);
+		return len;
+	}
+
+	// Parses the whole string as an integer in base 10 or 16, with optional sign and
+	// surrounding blanks, in a single pass. Returns false if it's not a number, or if it
+	// doesn't fit intT, leaving out untouched.
+	template<typename intT>
+	static bool parse_int(std::wstring_view s, intT& out, int base = 10) noexcept {
+		static_assert(std::is_integral_v<intT>, "parse_int() needs an integer type.");
+		using uintT = std::make_unsigned_t<intT>;
+
+		size_t i = 0, len = _trimmed_length(s, i);
+		bool isNegative = false;
+		if (i < len && (s[i] == L'-' || s[i] == L'+')) {
+			isNegative = (s[i++] == L'-');
+			if (isNegative && !std::is_signed_v<intT>) return false;
+		}
+		if (i == len) return false; // no digits
+
+		uintT limit = isNegative ?
+			static_cast<uintT>(0 - static_cast<uintT>(std::numeric_limits<intT>::min())) :
+			static_cast<uintT>(std::numeric_limits<intT>::max());
+		uintT val = 0;
+		for (; i < len; ++i) {
+			unsigned digit = _digit_value(s[i]);
+			if (digit >= static_cast<unsigned>(base)) return false;
+			if (val > (limit - digit) / static_cast<uintT>(base)) return false; // overflow
+			val = static_cast<uintT>(val * base + digit);
+		}
+		out = isNegative ? static_cast<intT>(0 - val) : static_cast<intT>(val);
+		return true;
+	}
+
+	// Parses the whole string as a float, with optional surrounding blanks, in a single
+	// pass. Returns false if it's not a number, leaving out untouched.
+	static bool parse_float(std::wstring_view s, double& out) noexcept {
+		size_t i = 0, len = _trimmed_length(s, i);
+		char buf[128];
+		if (i == len || len - i >= sizeof(buf)) return false;
+
+		size_t numChars = 0;
+		for (; i < len; ++i) {
+			wchar_t ch = s[i];
+			if (!((ch >= L'0' && ch <= L'9') || ch == L'.' || ch == L'-' || ch == L'+' || ch == L'e' || ch == L'E')) {
+				return false; // also rejects inf, nan and hex floats
+			}
+			buf[numChars++] = static_cast<char>(ch);
+		}
+		const char* pFirst = buf + (buf[0] == '+' && numChars > 1 && buf[1] != '-' ? 1 : 0); // from_chars rejects +
+#if defined(__cpp_lib_to_chars)
+		double val = 0;
+		std::from_chars_result res = std::from_chars(pFirst, buf + numChars, val);
+		if (res.ec != std::errc{} || res.ptr != buf + numChars) return false;
+#else
+		buf[numChars] = '\0';
+		char* pEnd = nullptr;
+		double val = strtod(pFirst, &pEnd);
+		if (pEnd != buf + numChars) return false;
+#endif
+		out = val;
+		return true;
+	}
+
+private:
+	static size_t _trimmed_length(std::wstring_view s, size_t& first) noexcept {
+		size_t len = s.length();
+		while (first < len && (s[first] == L' ' || s[first] == L'\t')) ++first;
+		while (len > first && (s[len - 1] == L' ' || s[len - 1] == L'\t')) --len;
+		return len;
+	}
+
+	static unsigned _digit_value(wchar_t ch) noexcept {
+		if (ch >= L'0' && ch <= L'9') return ch - L'0';
+		if (ch >= L'a' && ch <= L'f') return ch - L'a' + 10;
+		if (ch >= L'A' && ch <= L'F') return ch - L'A' + 10;
+		return 99;
+	}
+};
+
+// Single-pass formatting of the arguments into a buffer, following the parsed format.
+class fmt_engine final {
+private:
+	fmt_engine() = delete;
+
+public:
+	template<typename ...argsT>
+	static std::wstring format(const fmt_string<argsT...>& fmt, const argsT&... args) {
+		fmt_buffer buf;
+		format_to(buf, fmt, args...);
+		return buf.str();
+	}
+
+	// Appends to any buffer with prepare(), commit() and append(), like fmt_buffer.
+	template<typename bufferT, typename ...argsT>
+	static void format_to(bufferT& buf, const fmt_string<argsT...>& fmt, const argsT&... args) {
+		_format(buf, fmt, std::index_sequence_for<argsT...>{}, args...);
+	}
+
+private:
+	template<typename bufferT, typename ...argsT, size_t ...indexes>
+	static void _format(bufferT& buf, const fmt_string<argsT...>& fmt,
+		std::index_sequence<indexes...>, const argsT&... args)
+	{
+		(( _append_literal(buf, fmt.str(), fmt.spec(indexes)),
+			_append_arg(buf, args, fmt.spec(indexes)) ), ...);
+		_append_literal(buf, fmt.str(), fmt.spec(sizeof...(argsT)));
+	}
+
+	template<typename bufferT>
+	static void _append_literal(bufferT& buf, const wchar_t* s, const fmt_spec& spec) {
+		const wchar_t* p = s + spec.litBegin;
+		if (!spec.litHasEscapes) {
+			buf.append(p, spec.litLen);
+			return;
+		}
+		for (size_t i = 0; i < spec.litLen; ++i) {
+			buf.append(p[i]);
+			if (p[i] == L'{' || p[i] == L'}') ++i; // skip the doubled brace
+		}
+	}
+
+	template<typename bufferT, typename T>
+	static void _append_arg(bufferT& buf, const T& arg, const fmt_spec& spec) {
+		constexpr wchar_t kind = fmt_kind<T>();
+		if constexpr (kind == L'b') {
+			buf.append(arg ? L"true" : L"false", arg ? 4 : 5);
+		} else if constexpr (kind == L'c') {
+			buf.append(arg);
+		} else if constexpr (kind == L'i') {
+			wchar_t tmp[str_number::MAX_INT_LEN];
+			wchar_t* pEnd = tmp + str_number::MAX_INT_LEN;
+			wchar_t* pFirst = spec.type ?
+				str_number::write_hex_backwards(arg, pEnd, spec.type == L'X') :
+				str_number::write_int_backwards(arg, pEnd);
+			buf.append(pFirst, pEnd - pFirst);
+		} else if constexpr (kind == L'f') {
+			size_t maxLen = str_number::MAX_FLOAT_LEN + (spec.precision >= 0 ? spec.precision + 310 : 0); // 1e308 in fixed notation
+			buf.commit(str_number::write_float(static_cast<double>(arg),
+				buf.prepare(maxLen), maxLen, spec.precision));
+		} else {
+			std::wstring_view s = _as_view(arg);
+			buf.append(s.data(), s.length());
+		}
+	}
+
+	static std::wstring_view _as_view(const wchar_t* s) noexcept { return s ? s : L""; }
+	static std::wstring_view _as_view(std::wstring_view s) noexcept { return s; }
+};
+
+}//namespace _wli
+}//namespace wl
@@ -6,9 +6,16 @@
  */
 
 #pragma once
+#include <cstring>
+#include <cwchar>
 #include <cwctype>
 #include <string>
+#include "str_decoder.h"
+#include "str_transcode.h"
+
+#ifdef _WIN32
 #include <Windows.h>
+#endif
 
 namespace wl {
 namespace _wli {
@@ -29,6 +36,10 @@ inline const wchar_t* format_raw_arg(const std::wstring& val) noexcept {
 
 template<typename ...argsT>
 inline std::wstring format_raw(size_t strFormatLen, const wchar_t* strFormat, const argsT&... args) {
+	wchar_t stackBuf[256]; // most results fit, so swprintf runs only once
+	int stackLen = swprintf(stackBuf, sizeof(stackBuf) / sizeof(wchar_t), strFormat, format_raw_arg(args)...);
+	if (stackLen >= 0) return {stackBuf, static_cast<size_t>(stackLen)};
+
 	// https://msdn.microsoft.com/en-us/magazine/dn913181.aspx
 	// https://stackoverflow.com/a/514921/6923555
 	size_t len = swprintf(nullptr, 0, strFormat, format_raw_arg(args)...);
@@ -38,40 +49,73 @@ inline std::wstring format_raw(size_t strFormatLen, const wchar_t* strFormat, co
 	return ret;
 }
 
+// Returns the char without its diacritic, if it's one of the Latin-1 letters handled by str::remove_diacritics().
+inline wchar_t remove_diacritic(wchar_t ch) noexcept {
+	static const wchar_t latin1[] = { // 0xC0 to 0xFF
+		L'A', L'A', L'A', L'A', L'A', L'A', 0xC6, L'C', L'E', L'E', L'E', L'E', L'I', L'I', L'I', L'I',
+		L'D', L'N', L'O', L'O', L'O', L'O', L'O', 0xD7, L'O', L'U', L'U', L'U', L'U', L'Y', 0xDE, 0xDF,
+		L'a', L'a', L'a', L'a', L'a', L'a', 0xE6, L'c', L'e', L'e', L'e', L'e', L'i', L'i', L'i', L'i',
+		L'd', L'n', L'o', L'o', L'o', L'o', L'o', 0xF7, L'o', L'u', L'u', L'u', L'u', L'y', 0xFE, 0xFF,
+	};
+	return (ch >= 0xC0 && ch <= 0xFF) ? latin1[ch - 0xC0] : ch;
+}
+
 inline bool ends_begins_first_check(const std::wstring& s, const wchar_t* what, size_t& whatLen) noexcept {
 	if (s.empty()) return false;
 
-	whatLen = lstrlenW(what);
+	whatLen = what ? wcslen(what) : 0; // like lstrlenW()
 	if (!whatLen || whatLen > s.length()) {
 		return false;
 	}
 	return true;
 }
 
+// Returns the length up to the first null, if any.
+inline size_t len_before_null(const BYTE* data, size_t sz) noexcept {
+	const void* pNull = memchr(data, 0, sz);
+	return pNull ? static_cast<const BYTE*>(pNull) - data : sz;
+}
+
 inline std::wstring parse_ascii(const BYTE* data, size_t sz) {
 	std::wstring ret;
 	if (data && sz) {
-		ret.resize(sz);
-		for (size_t i = 0; i < sz; ++i) {
-			if (!data[i]) { // found terminating null
-				ret.resize(i);
-				return ret;
-			}
-			ret[i] = static_cast<wchar_t>(data[i]); // raw conversion
-		}
+		ret.resize(len_before_null(data, sz)); // stop at terminating null, if any
+		if (!ret.empty()) str_transcode::latin1_to_utf16(data, ret.length(), &ret[0]); // raw conversion
 	}
-	return ret; // data didn't have a terminating null
+	return ret;
 }
 
+#ifdef _WIN32 // other code pages are converted by Win32
 inline std::wstring parse_encoded(const BYTE* data, size_t sz, UINT codePage) {
 	std::wstring ret;
 	if (data && sz) {
-		int neededLen = MultiByteToWideChar(codePage, 0, reinterpret_cast<const char*>(data),
-			static_cast<int>(sz), nullptr, 0);
-		ret.resize(neededLen);
-		MultiByteToWideChar(codePage, 0, reinterpret_cast<const char*>(data),
-			static_cast<int>(sz), &ret[0], neededLen);
-		ret.resize( lstrlenW(ret.c_str()) ); // trim_nulls()
+		sz = len_before_null(data, sz); // trim_nulls()
+		if (!sz) return ret;
+
+		if (codePage == CP_UTF8) { // one UTF-16 char for each byte is always enough
+			ret.resize(sz);
+			ret.resize(str_transcode::utf8_to_utf16(data, sz, &ret[0]));
+		} else if (codePage == 1252) {
+			ret.resize(sz);
+			str_transcode::win1252_to_utf16(data, sz, &ret[0]);
+		} else {
+			int neededLen = MultiByteToWideChar(codePage, 0, reinterpret_cast<const char*>(data),
+				static_cast<int>(sz), nullptr, 0);
+			ret.resize(neededLen);
+			MultiByteToWideChar(codePage, 0, reinterpret_cast<const char*>(data),
+				static_cast<int>(sz), &ret[0], neededLen);
+		}
+	}
+	return ret;
+}
+#endif
+
+inline std::wstring parse_wide(const BYTE* data, size_t sz, encoding encType) {
+	std::wstring ret;
+	if (data && sz) {
+		str_decoder(encType).decode(data, sz, ret).finish(ret);
+		size_t nullPos = ret.find(L'\0'); // trim_nulls()
+		if (nullPos != std::wstring::npos) ret.resize(nullPos);
 	}
 	return ret;
 }
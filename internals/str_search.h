@@ -0,0 +1,209 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <Windows.h>
+#include "simd.h"
+
+namespace wl {
+namespace _wli {
+
+// Simple case folding of UTF-16 code units, the same done by CharUpperBuffW, so
+// results are consistent with str::upper(). The table is built once per process.
+class case_fold final {
+private:
+	std::unique_ptr<wchar_t[]>               _table; // one entry for each code unit
+	std::vector<std::pair<wchar_t, wchar_t>> _changed; // all code units which fold to something else
+
+	case_fold() : _table(new wchar_t[0x10000]) {
+		for (size_t ch = 0; ch < 0x10000; ++ch) {
+			this->_table[ch] = static_cast<wchar_t>(ch);
+		}
+		CharUpperBuffW(&this->_table[0], 0xD800); // surrogates are left alone, so no pairs are formed
+		CharUpperBuffW(&this->_table[0xE000], 0x10000 - 0xE000);
+
+		for (size_t ch = 0; ch < 0x10000; ++ch) {
+			this->_table[ch] = this->_table[this->_table[ch]]; // so folding twice is the same as once
+			if (this->_table[ch] != ch) {
+				this->_changed.emplace_back(static_cast<wchar_t>(ch), this->_table[ch]);
+			}
+		}
+	}
+
+	static const case_fold& _instance() {
+		static const case_fold cf;
+		return cf;
+	}
+
+public:
+	// Returns the folded code unit.
+	static wchar_t fold(wchar_t ch) noexcept {
+		return _instance()._table[ch];
+	}
+
+	// Returns all code units which fold to the same as the given one, up to maxCount;
+	// returns zero if there are more.
+	static size_t variants_of(wchar_t ch, wchar_t* pOut, size_t maxCount) noexcept {
+		wchar_t folded = fold(ch);
+		size_t count = 0;
+		pOut[count++] = folded;
+		for (const std::pair<wchar_t, wchar_t>& changed : _instance()._changed) {
+			if (changed.second == folded) {
+				if (count == maxCount) return 0;
+				pOut[count++] = changed.first;
+			}
+		}
+		return count;
+	}
+};
+
+// Case-insensitive substring search, for a needle folded once. Candidates are found
+// by comparing the first and last chars, in SIMD blocks when available, then verified.
+class str_searcher final {
+public:
+	static const size_t npos = std::wstring_view::npos;
+
+private:
+	static const size_t _MAX_VARIANTS = 4;
+#if defined(WINLAMB_SIMD_AVX2)
+	static const size_t _BLOCK = 16; // chars compared at once
+#elif defined(WINLAMB_SIMD_SSE2)
+	static const size_t _BLOCK = 8;
+#endif
+
+	std::wstring _folded;
+	wchar_t      _firstVariants[_MAX_VARIANTS]{}, _lastVariants[_MAX_VARIANTS]{};
+	size_t       _numFirstVariants = 0, _numLastVariants = 0; // zero means too many, so no SIMD filter
+
+public:
+	explicit str_searcher(std::wstring_view needle) :
+		_folded(needle)
+	{
+		for (wchar_t& ch : this->_folded) ch = case_fold::fold(ch);
+		if (!this->_folded.empty()) {
+			this->_numFirstVariants = case_fold::variants_of(this->_folded.front(),
+				this->_firstVariants, _MAX_VARIANTS);
+			this->_numLastVariants = case_fold::variants_of(this->_folded.back(),
+				this->_lastVariants, _MAX_VARIANTS);
+		}
+	}
+
+	// Returns the length of the needle.
+	size_t length() const noexcept {
+		return this->_folded.length();
+	}
+
+	// Returns the index of the first occurrence at or after offset, or npos.
+	size_t find(std::wstring_view haystack, size_t offset = 0) const noexcept {
+		size_t len = this->_folded.length();
+		if (offset > haystack.length()) return npos;
+		if (!len) return offset;
+		if (haystack.length() - offset < len) return npos;
+
+		const wchar_t* pHay = haystack.data();
+		size_t lastStart = haystack.length() - len;
+		size_t i = offset;
+
+#if defined(WINLAMB_SIMD_AVX2) || defined(WINLAMB_SIMD_SSE2)
+		if (this->_numFirstVariants && this->_numLastVariants) {
+			for (; i + _BLOCK - 1 <= lastStart; i += _BLOCK) {
+				unsigned mask = this->_candidates_mask(pHay + i);
+				while (mask) {
+					unsigned bit = simd::bit_scan_forward(mask);
+					if (this->_matches_after_first(pHay + i + bit / 2)) return i + bit / 2;
+					mask &= ~(3u << bit); // each char has 2 bits in the mask
+				}
+			}
+		}
+#endif
+		for (; i <= lastStart; ++i) {
+			if (case_fold::fold(pHay[i]) == this->_folded[0] && this->_matches_after_first(pHay + i)) {
+				return i;
+			}
+		}
+		return npos;
+	}
+
+	// Returns the index of the last occurrence starting at or before offset, or npos.
+	size_t rfind(std::wstring_view haystack, size_t offset = npos) const noexcept {
+		size_t len = this->_folded.length();
+		if (len > haystack.length()) return npos;
+		size_t i = std::min(offset, haystack.length() - len); // first candidate, going backwards
+		if (!len) return i;
+
+		const wchar_t* pHay = haystack.data();
+
+#if defined(WINLAMB_SIMD_AVX2) || defined(WINLAMB_SIMD_SSE2)
+		if (this->_numFirstVariants && this->_numLastVariants) {
+			for (; i + 1 >= _BLOCK; i -= _BLOCK) { // block ends at i
+				const wchar_t* pBlock = pHay + i + 1 - _BLOCK;
+				unsigned mask = this->_candidates_mask(pBlock);
+				while (mask) {
+					unsigned bit = simd::bit_scan_reverse(mask);
+					if (this->_matches_after_first(pBlock + bit / 2)) return pBlock + bit / 2 - pHay;
+					mask &= ~(3u << (bit - 1)); // each char has 2 bits in the mask
+				}
+				if (i + 1 == _BLOCK) return npos; // block started at index zero
+			}
+		}
+#endif
+		for (;;) {
+			if (case_fold::fold(pHay[i]) == this->_folded[0] && this->_matches_after_first(pHay + i)) {
+				return i;
+			}
+			if (i-- == 0) return npos;
+		}
+	}
+
+private:
+	bool _matches_after_first(const wchar_t* p) const noexcept {
+		for (size_t k = 1; k < this->_folded.length(); ++k) {
+			if (p[k] != this->_folded[k] && // already folded, no lookup needed
+				case_fold::fold(p[k]) != this->_folded[k]) return false;
+		}
+		return true;
+	}
+
+#if defined(WINLAMB_SIMD_AVX2) || defined(WINLAMB_SIMD_SSE2)
+	// Returns a mask with 2 bits for each position of the block where the needle may start.
+	unsigned _candidates_mask(const wchar_t* p) const noexcept {
+		return _variants_mask(p, this->_firstVariants, this->_numFirstVariants) &
+			_variants_mask(p + this->_folded.length() - 1, this->_lastVariants, this->_numLastVariants);
+	}
+#endif
+
+#if defined(WINLAMB_SIMD_AVX2)
+	static unsigned _variants_mask(const wchar_t* p, const wchar_t* pVariants, size_t numVariants) noexcept {
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		__m256i eq = _mm256_setzero_si256();
+		for (size_t v = 0; v < numVariants; ++v) {
+			eq = _mm256_or_si256(eq, _mm256_cmpeq_epi16(block,
+				_mm256_set1_epi16(static_cast<short>(pVariants[v]))));
+		}
+		return static_cast<unsigned>(_mm256_movemask_epi8(eq));
+	}
+#elif defined(WINLAMB_SIMD_SSE2)
+	static unsigned _variants_mask(const wchar_t* p, const wchar_t* pVariants, size_t numVariants) noexcept {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i eq = _mm_setzero_si128();
+		for (size_t v = 0; v < numVariants; ++v) {
+			eq = _mm_or_si128(eq, _mm_cmpeq_epi16(block,
+				_mm_set1_epi16(static_cast<short>(pVariants[v]))));
+		}
+		return static_cast<unsigned>(_mm_movemask_epi8(eq));
+	}
+#endif
+};
+
+}//namespace _wli
+}//namespace wl
@@ -0,0 +1,252 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <cwctype>
+#include <iterator>
+#include <string_view>
+#include "simd.h"
+
+namespace wl {
+namespace _wli {
+
+// Scanning of wchar_t strings, in SIMD blocks when available.
+class str_scan final {
+private:
+	str_scan() = delete;
+
+#if defined(WINLAMB_SIMD_AVX2)
+	static const size_t _BLOCK = 16; // chars compared at once
+#elif defined(WINLAMB_SIMD_SSE2)
+	static const size_t _BLOCK = 8;
+#endif
+
+public:
+	static const size_t npos = std::wstring_view::npos;
+
+	// Returns the index of the first char, at or after offset, which is either a or b; or npos.
+	static size_t find_either(std::wstring_view s, size_t offset, wchar_t a, wchar_t b) noexcept {
+		const wchar_t* p = s.data();
+		size_t i = offset;
+#if defined(WINLAMB_SIMD_AVX2)
+		__m256i va = _mm256_set1_epi16(static_cast<short>(a)), vb = _mm256_set1_epi16(static_cast<short>(b));
+		for (; i + _BLOCK <= s.length(); i += _BLOCK) {
+			__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+			unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+				_mm256_or_si256(_mm256_cmpeq_epi16(block, va), _mm256_cmpeq_epi16(block, vb))));
+			if (mask) return i + simd::bit_scan_forward(mask) / 2; // each char has 2 bits in the mask
+		}
+#elif defined(WINLAMB_SIMD_SSE2)
+		__m128i va = _mm_set1_epi16(static_cast<short>(a)), vb = _mm_set1_epi16(static_cast<short>(b));
+		for (; i + _BLOCK <= s.length(); i += _BLOCK) {
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+			unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+				_mm_or_si128(_mm_cmpeq_epi16(block, va), _mm_cmpeq_epi16(block, vb))));
+			if (mask) return i + simd::bit_scan_forward(mask) / 2;
+		}
+#endif
+		for (; i < s.length(); ++i) {
+			if (p[i] == a || p[i] == b) return i;
+		}
+		return npos;
+	}
+
+	// Returns the index of the first occurrence of what, at or after offset; or npos.
+	static size_t find(std::wstring_view s, size_t offset, std::wstring_view what) noexcept {
+		if (what.empty()) return offset <= s.length() ? offset : npos;
+		while (offset + what.length() <= s.length()) {
+			offset = find_either(s, offset, what[0], what[0]);
+			if (offset == npos || offset + what.length() > s.length()) return npos;
+			if (s.compare(offset, what.length(), what) == 0) return offset;
+			++offset;
+		}
+		return npos;
+	}
+};
+
+// Lazy range of the tokens of a string split at a delimiter, which is removed. Tokens
+// are views into the string, which must outlive them. An empty string has no tokens.
+class str_split_range final {
+private:
+	std::wstring_view _s, _delimiter;
+
+public:
+	class iterator final {
+	private:
+		const str_split_range* _pRange = nullptr; // null at the end
+		size_t _base = 0, _head = 0; // current token is [base, head)
+		bool   _isLast = false; // no delimiter after the current token
+
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = std::wstring_view;
+		using difference_type = ptrdiff_t;
+		using pointer = const std::wstring_view*;
+		using reference = std::wstring_view;
+
+		iterator() = default;
+		explicit iterator(const str_split_range* pRange) noexcept : _pRange{pRange} { this->_find_head(); }
+
+		std::wstring_view operator*() const noexcept {
+			return this->_pRange->_s.substr(this->_base, this->_head - this->_base);
+		}
+
+		iterator& operator++() noexcept {
+			if (this->_isLast) {
+				this->_pRange = nullptr;
+			} else {
+				this->_base = this->_head + this->_pRange->_delimiter.length();
+				this->_find_head();
+			}
+			return *this;
+		}
+
+		bool operator==(const iterator& other) const noexcept {
+			return this->_pRange == other._pRange && (!this->_pRange || this->_base == other._base);
+		}
+		bool operator!=(const iterator& other) const noexcept { return !this->operator==(other); }
+
+	private:
+		void _find_head() noexcept {
+			const str_split_range& range = *this->_pRange;
+			this->_head = range._delimiter.empty() ? str_scan::npos : // whole string is one token
+				str_scan::find(range._s, this->_base, range._delimiter);
+			this->_isLast = (this->_head == str_scan::npos);
+			if (this->_isLast) this->_head = range._s.length();
+		}
+	};
+
+	str_split_range(std::wstring_view s, std::wstring_view delimiter) noexcept :
+		_s{s}, _delimiter{delimiter} { }
+
+	iterator begin() const noexcept { return this->_s.empty() ? iterator{} : iterator{this}; }
+	iterator end() const noexcept   { return {}; }
+};
+
+// Lazy range of the lines of a string, which may mix CR, LF and CRLF linebreaks. Lines
+// are views into the string, which must outlive them. An empty string has no lines.
+class str_lines_range final {
+private:
+	std::wstring_view _s;
+
+public:
+	class iterator final {
+	private:
+		const str_lines_range* _pRange = nullptr; // null at the end
+		size_t _base = 0, _head = 0; // current line is [base, head)
+
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = std::wstring_view;
+		using difference_type = ptrdiff_t;
+		using pointer = const std::wstring_view*;
+		using reference = std::wstring_view;
+
+		iterator() = default;
+		explicit iterator(const str_lines_range* pRange) noexcept : _pRange{pRange} { this->_find_head(); }
+
+		std::wstring_view operator*() const noexcept {
+			return this->_pRange->_s.substr(this->_base, this->_head - this->_base);
+		}
+
+		iterator& operator++() noexcept {
+			const std::wstring_view& s = this->_pRange->_s;
+			if (this->_head == s.length()) { // no linebreak after the current line
+				this->_pRange = nullptr;
+			} else {
+				this->_base = this->_head +
+					((s[this->_head] == L'\r' && this->_head + 1 < s.length() && s[this->_head + 1] == L'\n') ? 2 : 1);
+				this->_find_head();
+			}
+			return *this;
+		}
+
+		bool operator==(const iterator& other) const noexcept {
+			return this->_pRange == other._pRange && (!this->_pRange || this->_base == other._base);
+		}
+		bool operator!=(const iterator& other) const noexcept { return !this->operator==(other); }
+
+	private:
+		void _find_head() noexcept {
+			this->_head = str_scan::find_either(this->_pRange->_s, this->_base, L'\r', L'\n');
+			if (this->_head == str_scan::npos) this->_head = this->_pRange->_s.length();
+		}
+	};
+
+	explicit str_lines_range(std::wstring_view s) noexcept : _s{s} { }
+
+	iterator begin() const noexcept { return this->_s.empty() ? iterator{} : iterator{this}; }
+	iterator end() const noexcept   { return {}; }
+};
+
+// Lazy range of the tokens of a string separated by spaces, which may be enclosed in
+// double quotes; an unclosed quoted token is ignored. Tokens are views into the
+// string, which must outlive them.
+class str_quoted_range final {
+private:
+	std::wstring_view _s;
+
+public:
+	class iterator final {
+	private:
+		const str_quoted_range* _pRange = nullptr; // null at the end
+		size_t _base = 0, _len = 0, _next = 0; // current token, and where to look for the next one
+
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = std::wstring_view;
+		using difference_type = ptrdiff_t;
+		using pointer = const std::wstring_view*;
+		using reference = std::wstring_view;
+
+		iterator() = default;
+		explicit iterator(const str_quoted_range* pRange) noexcept : _pRange{pRange} { this->operator++(); }
+
+		std::wstring_view operator*() const noexcept {
+			return this->_pRange->_s.substr(this->_base, this->_len);
+		}
+
+		iterator& operator++() noexcept {
+			const std::wstring_view& s = this->_pRange->_s;
+			size_t i = this->_next;
+			while (i < s.length() && std::iswspace(s[i])) ++i; // some white space
+
+			if (i == s.length()) {
+				this->_pRange = nullptr;
+			} else if (s[i] == L'\"') { // begin of quoted token
+				size_t closing = str_scan::find_either(s, i + 1, L'\"', L'\"');
+				if (closing == str_scan::npos) {
+					this->_pRange = nullptr; // won't compute open-quoted
+				} else {
+					this->_base = i + 1;
+					this->_len = closing - this->_base;
+					this->_next = closing + 1; // 1st char after closing quote
+				}
+			} else { // 1st char of non-quoted token
+				size_t head = i + 1;
+				while (head < s.length() && !std::iswspace(s[head]) && s[head] != L'\"') ++head;
+				this->_base = i;
+				this->_len = head - i;
+				this->_next = head;
+			}
+			return *this;
+		}
+
+		bool operator==(const iterator& other) const noexcept {
+			return this->_pRange == other._pRange && (!this->_pRange || this->_next == other._next);
+		}
+		bool operator!=(const iterator& other) const noexcept { return !this->operator==(other); }
+	};
+
+	explicit str_quoted_range(std::wstring_view s) noexcept : _s{s} { }
+
+	iterator begin() const noexcept { return iterator{this}; }
+	iterator end() const noexcept   { return {}; }
+};
+
+}//namespace _wli
+}//namespace wl
@@ -0,0 +1,365 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include "simd.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+// The vector paths store 16-bit chars, so they need the wchar_t of Windows; elsewhere
+// the scalar paths write the same UTF-16 units into the wider wchar_t.
+#if (defined(WINLAMB_SIMD_AVX2) || defined(WINLAMB_SIMD_SSE2)) && WCHAR_MAX <= 0xFFFF
+#define WINLAMB_SIMD_UTF16
+#endif
+
+namespace wl {
+namespace _wli {
+
+#ifndef _WIN32
+using BYTE = unsigned char;
+#endif
+
+// Conversions between byte encodings and UTF-16, without Win32 round-trips. Each
+// function writes into a buffer sized by the caller, and returns the number of
+// elements written. Runs of ASCII chars are converted with SIMD, when available.
+// Invalid sequences become U+FFFD, like MultiByteToWideChar and WideCharToMultiByte.
+class str_transcode final {
+private:
+	str_transcode() = delete;
+
+#if defined(WINLAMB_SIMD_AVX2)
+	static const size_t _BLOCK = 32; // bytes converted at once
+#elif defined(WINLAMB_SIMD_SSE2)
+	static const size_t _BLOCK = 16;
+#endif
+
+	static const wchar_t _REPLACEMENT = 0xFFFD;
+
+public:
+	// Widens each byte to a wchar_t, as ISO-8859-1; dest must have room for sz chars.
+	static size_t latin1_to_utf16(const BYTE* src, size_t sz, wchar_t* dest) noexcept {
+		size_t i = 0;
+#ifdef WINLAMB_SIMD_UTF16
+		for (; i + _BLOCK <= sz; i += _BLOCK) {
+			_widen_block(src + i, dest + i);
+		}
+#endif
+		for (; i < sz; ++i) {
+			dest[i] = static_cast<wchar_t>(src[i]);
+		}
+		return sz;
+	}
+
+	// Converts Windows-1252 to UTF-16; dest must have room for sz chars.
+	static size_t win1252_to_utf16(const BYTE* src, size_t sz, wchar_t* dest) noexcept {
+		static const wchar_t cp1252[] = { // 0x80 to 0x9F, undefined ones are kept, like MultiByteToWideChar does
+			0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021, 0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+			0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014, 0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+		};
+		size_t i = 0;
+		while (i < sz) {
+#ifdef WINLAMB_SIMD_UTF16
+			if (i + _BLOCK <= sz) {
+				unsigned nonAscii = _non_ascii_mask(src + i);
+				_widen_block(src + i, dest + i); // non-ASCII chars written here are fixed below
+				i += nonAscii ? simd::bit_scan_forward(nonAscii) : _BLOCK;
+				if (!nonAscii) continue;
+			}
+#endif
+			BYTE b = src[i];
+			dest[i++] = (b >= 0x80 && b <= 0x9F) ? cp1252[b - 0x80] : static_cast<wchar_t>(b);
+		}
+		return sz;
+	}
+
+	// Returns the number of leading ASCII bytes.
+	static size_t ascii_length(const BYTE* src, size_t sz) noexcept {
+		size_t i = 0;
+#if defined(WINLAMB_SIMD_AVX2) || defined(WINLAMB_SIMD_SSE2) // bytes only, any wchar_t will do
+		for (; i + _BLOCK <= sz; i += _BLOCK) {
+			unsigned nonAscii = _non_ascii_mask(src + i);
+			if (nonAscii) return i + simd::bit_scan_forward(nonAscii);
+		}
+#endif
+		while (i < sz && src[i] < 0x80) ++i;
+		return i;
+	}
+
+	// Decodes the UTF-8 sequence starting at src, which has avail bytes, into a code
+	// point, and returns whether it's valid. If not, numBytes is the length of its
+	// maximal valid subpart, at least one; it can also reach avail if truncated.
+	static bool decode_utf8_char(const BYTE* src, size_t avail, uint32_t& cp, size_t& numBytes) noexcept {
+		BYTE b = src[0];
+		numBytes = 1;
+		if (b < 0x80) {
+			cp = b;
+			return true;
+		}
+
+		size_t numCont = 0; // continuation bytes expected
+		BYTE lo = 0x80, hi = 0xBF; // valid range of the first continuation byte
+		if (b < 0xC2) { // stray continuation byte, or overlong 2-byte sequence
+			return false;
+		} else if (b < 0xE0) {
+			numCont = 1; cp = b & 0x1F;
+		} else if (b < 0xF0) {
+			numCont = 2; cp = b & 0x0F;
+			if (b == 0xE0) lo = 0xA0; // overlong
+			else if (b == 0xED) hi = 0x9F; // surrogates
+		} else if (b < 0xF5) {
+			numCont = 3; cp = b & 0x07;
+			if (b == 0xF0) lo = 0x90; // overlong
+			else if (b == 0xF4) hi = 0x8F; // beyond U+10FFFF
+		} else {
+			return false;
+		}
+
+		for (; numBytes <= numCont && numBytes < avail; ++numBytes) {
+			BYTE c = src[numBytes];
+			if (c < lo || c > hi) break;
+			cp = (cp << 6) | (c & 0x3F);
+			lo = 0x80;
+			hi = 0xBF;
+		}
+		return numBytes > numCont;
+	}
+
+	// Returns the length of a UTF-8 sequence as told by its first byte; invalid ones are 1.
+	static size_t utf8_sequence_length(BYTE first) noexcept {
+		return (first >= 0xC2 && first < 0xE0) ? 2 :
+			(first >= 0xE0 && first < 0xF0) ? 3 :
+			(first >= 0xF0 && first < 0xF5) ? 4 : 1;
+	}
+
+	// Converts UTF-8 to UTF-16; dest must have room for sz chars, which is always enough.
+	// Each invalid sequence, as defined by the Unicode standard, becomes one U+FFFD.
+	static size_t utf8_to_utf16(const BYTE* src, size_t sz, wchar_t* dest, size_t* pNumErrors = nullptr) noexcept {
+		size_t i = 0, o = 0, numErrors = 0;
+		while (i < sz) {
+			BYTE b = src[i];
+			if (b < 0x80) {
+#ifdef WINLAMB_SIMD_UTF16
+				if (i + _BLOCK <= sz) { // since o <= i, there's always room for a whole block
+					unsigned nonAscii = _non_ascii_mask(src + i);
+					_widen_block(src + i, dest + o); // non-ASCII chars written here are overwritten below
+					size_t numAscii = nonAscii ? simd::bit_scan_forward(nonAscii) : _BLOCK;
+					i += numAscii;
+					o += numAscii;
+					continue;
+				}
+#endif
+				dest[o++] = static_cast<wchar_t>(b);
+				++i;
+				continue;
+			}
+
+			uint32_t cp = 0;
+			size_t k = 0;
+			if (!decode_utf8_char(src + i, sz - i, cp, k)) { // the maximal valid subpart is replaced
+				dest[o++] = _REPLACEMENT;
+				++numErrors;
+			} else if (cp >= 0x10000) {
+				cp -= 0x10000;
+				dest[o++] = static_cast<wchar_t>(0xD800 + (cp >> 10));
+				dest[o++] = static_cast<wchar_t>(0xDC00 + (cp & 0x3FF));
+			} else {
+				dest[o++] = static_cast<wchar_t>(cp);
+			}
+			i += k;
+		}
+		if (pNumErrors) *pNumErrors = numErrors;
+		return o;
+	}
+
+	// Converts UTF-16 in the given byte order to native UTF-16; dest must have room for
+	// numUnits chars. Lone surrogates are kept.
+	static size_t utf16_to_utf16(const BYTE* src, size_t numUnits, bool bigEndian, wchar_t* dest) noexcept {
+		if (!bigEndian && sizeof(wchar_t) == 2) {
+			if (numUnits) memcpy(dest, src, numUnits * sizeof(wchar_t));
+			return numUnits;
+		}
+		size_t i = 0;
+#ifdef WINLAMB_SIMD_UTF16
+		for (; i + _BLOCK <= numUnits; i += _BLOCK) { // only big-endian gets here
+			_swap_block(src + i * 2, dest + i);
+		}
+#endif
+		for (; i < numUnits; ++i) {
+			const BYTE* p = src + i * 2;
+			dest[i] = static_cast<wchar_t>(bigEndian ? (p[0] << 8) | p[1] : p[0] | (p[1] << 8));
+		}
+		return numUnits;
+	}
+
+	// Converts UTF-32 in the given byte order to UTF-16; dest must have room for twice
+	// numUnits chars. Each invalid code point becomes one U+FFFD.
+	static size_t utf32_to_utf16(const BYTE* src, size_t numUnits, bool bigEndian, wchar_t* dest, size_t* pNumErrors = nullptr) noexcept {
+		size_t o = 0, numErrors = 0;
+		for (size_t i = 0; i < numUnits; ++i) {
+			const BYTE* p = src + i * 4;
+			uint32_t cp = bigEndian ?
+				(static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3] :
+				(static_cast<uint32_t>(p[3]) << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+			if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+				dest[o++] = _REPLACEMENT;
+				++numErrors;
+			} else if (cp >= 0x10000) {
+				cp -= 0x10000;
+				dest[o++] = static_cast<wchar_t>(0xD800 + (cp >> 10));
+				dest[o++] = static_cast<wchar_t>(0xDC00 + (cp & 0x3FF));
+			} else {
+				dest[o++] = static_cast<wchar_t>(cp);
+			}
+		}
+		if (pNumErrors) *pNumErrors = numErrors;
+		return o;
+	}
+
+	// Returns the exact number of bytes utf16_to_utf8() will write.
+	static size_t utf8_length(const wchar_t* src, size_t len) noexcept {
+		size_t i = 0, numBytes = 0;
+		while (i < len) {
+#ifdef WINLAMB_SIMD_UTF16
+			if (i + _BLOCK <= len && _is_ascii_block(src + i)) {
+				i += _BLOCK;
+				numBytes += _BLOCK;
+				continue;
+			}
+#endif
+			wchar_t ch = src[i++];
+			if (ch < 0x80) {
+				numBytes += 1;
+			} else if (ch < 0x800) {
+				numBytes += 2;
+			} else if (ch >= 0xD800 && ch <= 0xDBFF && i < len && src[i] >= 0xDC00 && src[i] <= 0xDFFF) {
+				numBytes += 4;
+				++i;
+			} else {
+				numBytes += 3; // lone surrogates too, as U+FFFD
+			}
+		}
+		return numBytes;
+	}
+
+	// Converts UTF-16 to UTF-8; dest must have room for utf8_length() bytes. Each lone
+	// surrogate becomes one U+FFFD.
+	static size_t utf16_to_utf8(const wchar_t* src, size_t len, BYTE* dest, size_t* pNumErrors = nullptr) noexcept {
+		size_t i = 0, o = 0, numErrors = 0;
+		while (i < len) {
+#ifdef WINLAMB_SIMD_UTF16
+			if (i + _BLOCK <= len && _is_ascii_block(src + i)) {
+				_narrow_block(src + i, dest + o);
+				i += _BLOCK;
+				o += _BLOCK;
+				continue;
+			}
+#endif
+			uint32_t cp = src[i++];
+			if (cp >= 0xD800 && cp <= 0xDFFF) {
+				if (cp <= 0xDBFF && i < len && src[i] >= 0xDC00 && src[i] <= 0xDFFF) {
+					cp = 0x10000 + ((cp - 0xD800) << 10) + (src[i++] - 0xDC00);
+				} else {
+					cp = _REPLACEMENT;
+					++numErrors;
+				}
+			}
+
+			if (cp < 0x80) {
+				dest[o++] = static_cast<BYTE>(cp);
+			} else if (cp < 0x800) {
+				dest[o++] = static_cast<BYTE>(0xC0 | (cp >> 6));
+				dest[o++] = static_cast<BYTE>(0x80 | (cp & 0x3F));
+			} else if (cp < 0x10000) {
+				dest[o++] = static_cast<BYTE>(0xE0 | (cp >> 12));
+				dest[o++] = static_cast<BYTE>(0x80 | ((cp >> 6) & 0x3F));
+				dest[o++] = static_cast<BYTE>(0x80 | (cp & 0x3F));
+			} else {
+				dest[o++] = static_cast<BYTE>(0xF0 | (cp >> 18));
+				dest[o++] = static_cast<BYTE>(0x80 | ((cp >> 12) & 0x3F));
+				dest[o++] = static_cast<BYTE>(0x80 | ((cp >> 6) & 0x3F));
+				dest[o++] = static_cast<BYTE>(0x80 | (cp & 0x3F));
+			}
+		}
+		if (pNumErrors) *pNumErrors = numErrors;
+		return o;
+	}
+
+private:
+#if defined(WINLAMB_SIMD_AVX2)
+	static unsigned _non_ascii_mask(const BYTE* p) noexcept { // one bit for each byte
+		return static_cast<unsigned>(_mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))));
+	}
+
+	static bool _is_ascii_block(const wchar_t* p) noexcept {
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 16));
+		return _mm256_testz_si256(_mm256_or_si256(a, b), _mm256_set1_epi16(static_cast<short>(0xFF80)));
+	}
+
+	static void _widen_block(const BYTE* src, wchar_t* dest) noexcept {
+		__m256i lo = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+		__m256i hi = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), lo);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + 16), hi);
+	}
+
+	static void _narrow_block(const wchar_t* src, BYTE* dest) noexcept { // all chars must be ASCII
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 16));
+		__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8); // packus works per 128-bit lane
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), packed);
+	}
+
+	static void _swap_block(const BYTE* src, wchar_t* dest) noexcept { // byte order of 32 UTF-16 chars
+		for (size_t half = 0; half < 2; ++half) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + half * 32));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + half * 16),
+				_mm256_or_si256(_mm256_slli_epi16(v, 8), _mm256_srli_epi16(v, 8)));
+		}
+	}
+#elif defined(WINLAMB_SIMD_SSE2)
+	static unsigned _non_ascii_mask(const BYTE* p) noexcept { // one bit for each byte
+		return static_cast<unsigned>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+	}
+
+	static bool _is_ascii_block(const wchar_t* p) noexcept {
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 8));
+		__m128i high = _mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi16(static_cast<short>(0xFF80)));
+		return _mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) == 0xFFFF;
+	}
+
+	static void _widen_block(const BYTE* src, wchar_t* dest) noexcept {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		__m128i zero = _mm_setzero_si128();
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_unpacklo_epi8(block, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 8), _mm_unpackhi_epi8(block, zero));
+	}
+
+	static void _narrow_block(const wchar_t* src, BYTE* dest) noexcept { // all chars must be ASCII
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 8));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_packus_epi16(a, b));
+	}
+
+	static void _swap_block(const BYTE* src, wchar_t* dest) noexcept { // byte order of 16 UTF-16 chars
+		for (size_t half = 0; half < 2; ++half) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + half * 16));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + half * 8),
+				_mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+		}
+	}
+#endif
+};
+
+}//namespace _wli
+}//namespace wl
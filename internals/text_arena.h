@@ -0,0 +1,104 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <algorithm>
+#include <string_view>
+#include <vector>
+
+namespace wl {
+namespace _wli {
+
+// Many null-terminated strings packed back to back in a single buffer, addressed
+// by index. Clearing keeps the memory, so a reused arena doesn't allocate again.
+class text_arena final {
+private:
+	static const size_t _MIN_FREE = 64; // chars available to each string at first try
+
+	std::vector<wchar_t> _chars;
+	std::vector<size_t>  _offsets{0}; // start of each string, plus one past the end of the last
+
+public:
+	// Returns the number of strings.
+	size_t size() const noexcept {
+		return this->_offsets.size() - 1;
+	}
+
+	bool empty() const noexcept {
+		return this->size() == 0;
+	}
+
+	// Returns a view to the given string.
+	std::wstring_view operator[](size_t index) const noexcept {
+		return {&this->_chars[this->_offsets[index]],
+			this->_offsets[index + 1] - this->_offsets[index] - 1}; // without terminating null
+	}
+
+	// Returns the given string as a null-terminated pointer.
+	const wchar_t* c_str(size_t index) const noexcept {
+		return &this->_chars[this->_offsets[index]];
+	}
+
+	// Removes all strings, keeping the memory.
+	text_arena& clear() noexcept {
+		this->_offsets.resize(1);
+		return *this;
+	}
+
+	// Preallocates memory for the given number of strings, with the given total length.
+	text_arena& reserve(size_t numStrings, size_t numChars) {
+		this->_offsets.reserve(numStrings + 1);
+		if (this->_chars.size() < numChars + numStrings) {
+			this->_chars.resize(numChars + numStrings); // room for the terminating nulls
+		}
+		return *this;
+	}
+
+	// Appends a copy of the string.
+	text_arena& push_back(std::wstring_view s) {
+		wchar_t* pDest = this->_make_room(s.length() + 1);
+		std::copy(s.cbegin(), s.cend(), pDest);
+		pDest[s.length()] = L'\0';
+		return this->_commit(s.length());
+	}
+
+	// Appends a string written straight into the arena by filler(wchar_t* buf, size_t
+	// bufLen), which returns the number of chars written, without the terminating null.
+	// If it returns bufLen - 1, the string is assumed to be truncated, and filler is
+	// called again with a bigger buffer.
+	template<typename fillerT>
+	text_arena& emplace_with(fillerT&& filler) {
+		size_t bufLen = _MIN_FREE;
+		for (;;) {
+			wchar_t* pDest = this->_make_room(bufLen);
+			bufLen = this->_chars.size() - this->_offsets.back(); // use all the room there is
+			size_t len = filler(pDest, bufLen);
+			if (len < bufLen - 1) {
+				pDest[len] = L'\0'; // in case filler didn't write it
+				return this->_commit(len);
+			}
+			bufLen *= 2;
+		}
+	}
+
+private:
+	wchar_t* _make_room(size_t numChars) {
+		size_t used = this->_offsets.back();
+		if (this->_chars.size() - used < numChars) {
+			this->_chars.resize(std::max(this->_chars.size() * 2, used + numChars)); // grows geometrically
+		}
+		return &this->_chars[used];
+	}
+
+	text_arena& _commit(size_t len) {
+		this->_offsets.emplace_back(this->_offsets.back() + len + 1);
+		return *this;
+	}
+};
+
+}//namespace _wli
+}//namespace wl
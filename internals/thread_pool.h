@@ -0,0 +1,247 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "callable.h"
+
+namespace wl {
+namespace _wli {
+
+// Process-wide work-stealing thread pool, which runs the background tasks of all windows.
+class thread_pool final {
+public:
+	enum class priority { HIGH, NORMAL, LOW };
+
+private:
+	struct _worker final {
+		std::mutex                   mtx;
+		std::deque<callable<void()>> tasks; // owner pops from back, thieves steal from front
+		std::thread                  thread;
+	};
+
+	std::mutex                   _mtx; // guards startup, shutdown and the global queues
+	std::condition_variable      _cv;
+	std::deque<callable<void()>> _globalTasks[3]; // one per priority, fed by non-pool threads
+	std::vector<std::unique_ptr<_worker>> _workers;
+	std::atomic<size_t>          _pending{0};
+	std::atomic<size_t>          _numGlobal{0}; // lets workers skip locking when the global queues are empty
+	bool                         _started = false, _stopping = false;
+
+public:
+	~thread_pool() {
+		this->shutdown();
+	}
+
+	thread_pool() = default;
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	// Returns the process-wide pool; worker threads are only created at the first submit().
+	static thread_pool& instance() noexcept {
+		static thread_pool pool;
+		return pool;
+	}
+
+	// Queues a task; it must not throw, since there's nobody to catch it.
+	void submit(priority prio, callable<void()> task) {
+		this->_start_if_needed();
+		_worker* pSelf = _current_worker();
+		++this->_pending; // before pushing, so it never underflows when the task is popped right away
+
+		try {
+			if (pSelf && prio != priority::HIGH) { // nested task: keep it local, cache-friendly
+				std::lock_guard<std::mutex> lk(pSelf->mtx);
+				pSelf->tasks.emplace_back(std::move(task));
+			} else {
+				std::lock_guard<std::mutex> lk(this->_mtx);
+				this->_globalTasks[static_cast<size_t>(prio)].emplace_back(std::move(task));
+				++this->_numGlobal;
+			}
+		} catch (...) {
+			--this->_pending; // otherwise the workers would spin on a task that doesn't exist
+			throw;
+		}
+
+		{ std::lock_guard<std::mutex> lk(this->_mtx); } // so a worker can't miss the wake-up
+		this->_cv.notify_one();
+	}
+
+	// Calls func(i) for each i in [0, count), spread among the pool threads and the calling
+	// one, which helps instead of just blocking; returns when all calls are done. Any
+	// exception thrown by func is rethrown here.
+	template<typename funcT>
+	void parallel_for(size_t count, funcT&& func) {
+		if (count == 0) return;
+		if (count == 1) {
+			func(static_cast<size_t>(0));
+			return;
+		}
+
+		struct _loop final {
+			std::atomic<size_t>     next{0}, done{0};
+			std::mutex              mtx;
+			std::condition_variable cv;
+			std::exception_ptr      curExcept; // first one thrown
+		};
+		std::shared_ptr<_loop> pLoop = std::make_shared<_loop>(); // helpers may start after we return
+
+		// A helper only touches func after claiming an index, which can't happen once all are done.
+		auto runClaimed = [pLoop, count, &func]() noexcept -> void {
+			for (size_t i = pLoop->next++; i < count; i = pLoop->next++) {
+				try {
+					func(i);
+				} catch (...) {
+					std::lock_guard<std::mutex> lk(pLoop->mtx);
+					if (!pLoop->curExcept) pLoop->curExcept = std::current_exception();
+				}
+				if (++pLoop->done == count) {
+					std::lock_guard<std::mutex> lk(pLoop->mtx);
+					pLoop->cv.notify_all();
+				}
+			}
+		};
+
+		size_t numHelpers = std::min(count - 1, _num_threads());
+		for (size_t h = 0; h < numHelpers; ++h) {
+			this->submit(priority::HIGH, runClaimed);
+		}
+		runClaimed();
+
+		std::unique_lock<std::mutex> lk(pLoop->mtx);
+		pLoop->cv.wait(lk, [&pLoop, count]() noexcept -> bool {
+			return pLoop->done == count;
+		});
+		if (pLoop->curExcept) std::rethrow_exception(pLoop->curExcept);
+	}
+
+	// Runs all pending tasks, then joins the worker threads; called by run_main().
+	void shutdown() noexcept {
+		{
+			std::lock_guard<std::mutex> lk(this->_mtx);
+			if (!this->_started || this->_stopping) return;
+			this->_stopping = true;
+		}
+		this->_cv.notify_all();
+
+		for (std::unique_ptr<_worker>& w : this->_workers) {
+			if (w->thread.joinable()) w->thread.join();
+		}
+
+		std::lock_guard<std::mutex> lk(this->_mtx);
+		this->_workers.clear();
+		this->_workers.shrink_to_fit(); // so nothing is reported by _CrtDumpMemoryLeaks()
+		this->_started = this->_stopping = false;
+	}
+
+private:
+	static size_t _num_threads() noexcept {
+		size_t numThreads = std::thread::hardware_concurrency();
+		return numThreads ? numThreads : 2; // information not available
+	}
+
+	static _worker*& _current_worker() noexcept {
+		static thread_local _worker* pCur = nullptr; // set only within pool threads
+		return pCur;
+	}
+
+	void _start_if_needed() {
+		std::lock_guard<std::mutex> lk(this->_mtx);
+		if (this->_started) return; // also true while shutting down, so running tasks can still queue nested ones
+
+		size_t numWorkers = _num_threads();
+
+		this->_workers.reserve(numWorkers);
+		for (size_t i = 0; i < numWorkers; ++i) {
+			this->_workers.emplace_back(new _worker);
+		}
+		for (size_t i = 0; i < numWorkers; ++i) {
+			this->_workers[i]->thread = std::thread([this, i]() noexcept -> void {
+				this->_worker_loop(i);
+			});
+		}
+		this->_started = true;
+	}
+
+	void _worker_loop(size_t idx) noexcept {
+		_worker* pSelf = this->_workers[idx].get();
+		_current_worker() = pSelf;
+		callable<void()> task;
+
+		for (;;) {
+			if (this->_try_pop(idx, task)) {
+				--this->_pending;
+				try {
+					task();
+				} catch (...) { } // tasks are expected to route their own exceptions
+				task = nullptr;
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lk(this->_mtx);
+			this->_cv.wait(lk, [this]() noexcept -> bool {
+				return this->_pending > 0 || this->_stopping;
+			});
+			if (this->_stopping && this->_pending == 0) break; // graceful: queues drained
+		}
+		_current_worker() = nullptr;
+	}
+
+	bool _try_pop(size_t idx, callable<void()>& task) noexcept {
+		_worker* pSelf = this->_workers[idx].get();
+		if (this->_numGlobal > 0) {
+			std::lock_guard<std::mutex> lk(this->_mtx); // high priority comes before local work
+			std::deque<callable<void()>>& high = this->_globalTasks[static_cast<size_t>(priority::HIGH)];
+			if (!high.empty()) {
+				task = std::move(high.front());
+				high.pop_front();
+				--this->_numGlobal;
+				return true;
+			}
+		}
+		{
+			std::lock_guard<std::mutex> lk(pSelf->mtx); // own queue, LIFO
+			if (!pSelf->tasks.empty()) {
+				task = std::move(pSelf->tasks.back());
+				pSelf->tasks.pop_back();
+				return true;
+			}
+		}
+		if (this->_numGlobal > 0) {
+			std::lock_guard<std::mutex> lk(this->_mtx);
+			for (size_t p = static_cast<size_t>(priority::NORMAL); p <= static_cast<size_t>(priority::LOW); ++p) {
+				if (!this->_globalTasks[p].empty()) {
+					task = std::move(this->_globalTasks[p].front());
+					this->_globalTasks[p].pop_front();
+					--this->_numGlobal;
+					return true;
+				}
+			}
+		}
+		for (size_t i = 1; i < this->_workers.size(); ++i) { // steal from the others, FIFO
+			_worker* pVictim = this->_workers[(idx + i) % this->_workers.size()].get();
+			std::lock_guard<std::mutex> lk(pVictim->mtx);
+			if (!pVictim->tasks.empty()) {
+				task = std::move(pVictim->tasks.front());
+				pVictim->tasks.pop_front();
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+}//namespace _wli
+}//namespace wl
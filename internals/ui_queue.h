@@ -0,0 +1,201 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <Windows.h>
+#include "callable.h"
+#include "lippincott.h"
+
+namespace wl {
+namespace _wli {
+
+// Lock-free multi-producer queue of callbacks to be run in the UI thread of a window.
+// It's shared-owned, so it can be safely posted to even after the window is gone.
+class ui_queue final {
+private:
+	struct _node final {
+		callable<void()> func;
+		UINT_PTR         coalesceKey = 0; // zero means no coalescing
+		UINT             generation = 0;  // window lifetime the callback belongs to
+		_node*           next = nullptr;
+		bool             skip = false;    // superseded by a newer node with same key
+	};
+
+	std::atomic<_node*>   _head{nullptr}; // MPSC stack, newest first
+	std::atomic<HWND>     _hWnd{nullptr}; // window to be woken, null while there's none
+	std::atomic<DWORD>    _threadId{0};
+	std::atomic<bool>     _wakePosted{false};
+	std::atomic<UINT>     _generation{0}; // incremented each time the window is destroyed
+	std::vector<UINT_PTR> _seenKeys; // used only by the UI thread while draining
+	const UINT            _wakeMsg;
+	const WPARAM          _wakeWp;
+
+public:
+	~ui_queue() {
+		_delete_nodes(this->_head.exchange(nullptr));
+	}
+
+	ui_queue(UINT wakeMsg, WPARAM wakeWp) noexcept :
+		_wakeMsg(wakeMsg), _wakeWp(wakeWp) { }
+
+	ui_queue(const ui_queue&) = delete;
+	ui_queue& operator=(const ui_queue&) = delete;
+
+	// Identifies the current window lifetime.
+	UINT generation() const noexcept {
+		return this->_generation.load(std::memory_order_acquire);
+	}
+
+	// UI thread of the window, zero if it was never created.
+	DWORD thread_id() const noexcept {
+		return this->_threadId.load(std::memory_order_acquire);
+	}
+
+	// Tells if the message is the wake message posted by this queue.
+	bool is_wake_msg(UINT msg, WPARAM wp, LPARAM lp) const noexcept {
+		return msg == this->_wakeMsg && wp == this->_wakeWp && lp == reinterpret_cast<LPARAM>(this);
+	}
+
+	// Starts delivering to the window, waking it if callbacks were posted before it
+	// existed; called by the UI thread when the window is created.
+	void begin(HWND hWnd) noexcept {
+		this->_threadId.store(GetCurrentThreadId(), std::memory_order_release);
+		this->_hWnd.store(hWnd);
+		this->_wakePosted.store(false); // a flag left by a previous window would block all wakes
+		if (this->_head.load()) {
+			this->_wake();
+		}
+	}
+
+	// Queues the callback, waking the window if needed; returns false, discarding
+	// the callback, if the window of the given generation was already destroyed.
+	bool post(UINT generation, callable<void()> func, UINT_PTR coalesceKey = 0) {
+		if (generation != this->generation()) return false;
+
+		_node* pNode = new _node{std::move(func), coalesceKey, generation};
+		_node* pHead = this->_head.load(std::memory_order_relaxed);
+		do {
+			pNode->next = pHead;
+		} while (!this->_head.compare_exchange_weak(pHead, pNode)); // sequentially consistent, see begin()
+
+		this->_wake();
+		return true; // a stale node which slipped in is deleted by the next drain() or cancel()
+	}
+
+	// Runs all queued callbacks, in posting order; called by the UI thread.
+	void drain() noexcept {
+		this->_wakePosted.store(false, std::memory_order_release); // further posts will wake us again
+		_node* pNewest = this->_head.exchange(nullptr, std::memory_order_acquire);
+		UINT curGen = this->generation();
+
+		// Walking newest to oldest, older nodes with an already seen key are superseded.
+		this->_seenKeys.clear();
+		_node* pOldest = nullptr;
+		while (pNewest) { // also reverse the list, so callbacks run in posting order
+			if (pNewest->generation != curGen) {
+				pNewest->skip = true;
+			} else if (pNewest->coalesceKey) {
+				if (std::find(this->_seenKeys.cbegin(), this->_seenKeys.cend(),
+					pNewest->coalesceKey) != this->_seenKeys.cend())
+				{
+					pNewest->skip = true;
+				} else {
+					this->_seenKeys.emplace_back(pNewest->coalesceKey);
+				}
+			}
+			_node* pNext = pNewest->next;
+			pNewest->next = pOldest;
+			pOldest = pNewest;
+			pNewest = pNext;
+		}
+
+		for (_node* pRun = pOldest; pRun; pRun = pRun->next) {
+			if (pRun->skip) continue;
+			if (pRun->generation != this->generation()) break; // a callback destroyed the window
+			try {
+				pRun->func(); // invoke user callback
+			} catch (...) {
+				lippincott();
+				PostQuitMessage(-1);
+			}
+		}
+		_delete_nodes(pOldest);
+	}
+
+	// Discards all queued callbacks and invalidates the current generation; called on WM_NCDESTROY.
+	void cancel() noexcept {
+		this->_hWnd.store(nullptr);
+		this->_generation.fetch_add(1, std::memory_order_acq_rel);
+		this->_wakePosted.store(false); // the pending message died with the window
+		_delete_nodes(this->_head.exchange(nullptr, std::memory_order_acquire));
+	}
+
+private:
+	void _wake() noexcept {
+		// All callbacks posted until the UI thread wakes up are run together, so a
+		// single message is posted no matter how many callbacks are queued.
+		if (!this->_wakePosted.exchange(true)) {
+			// Posting and begin() both write before reading what the other wrote, so with
+			// sequentially consistent operations at least one of them sees the node and the window.
+			HWND hWnd = this->_hWnd.load();
+			if (!hWnd || !PostMessageW(hWnd, this->_wakeMsg, this->_wakeWp, reinterpret_cast<LPARAM>(this))) {
+				this->_wakePosted.store(false); // no window yet, or it's gone; begin() will wake the next one
+			}
+		}
+	}
+
+	static void _delete_nodes(_node* pNode) noexcept {
+		while (pNode) {
+			_node* pNext = pNode->next;
+			delete pNode; // callbacks which never ran are just destroyed
+			pNode = pNext;
+		}
+	}
+};
+
+// Handle to the UI thread of a window, which can outlive the window itself.
+// After the window is destroyed, anything posted through it is discarded.
+class ui_context final {
+private:
+	std::shared_ptr<ui_queue> _queue;
+	UINT                      _generation = 0;
+
+public:
+	ui_context() = default;
+
+	// If the window doesn't exist yet, anything posted runs right after it's created.
+	explicit ui_context(std::shared_ptr<ui_queue> queue) noexcept :
+		_queue(std::move(queue)), _generation(_queue->generation()) { }
+
+	explicit operator bool() const noexcept {
+		return this->_queue != nullptr;
+	}
+
+	// Tells if the window is still alive.
+	bool is_alive() const noexcept {
+		return this->_queue && this->_queue->generation() == this->_generation;
+	}
+
+	// Tells if the calling thread is the UI thread of the window.
+	bool is_ui_thread() const noexcept {
+		return this->_queue && this->_queue->thread_id() == GetCurrentThreadId();
+	}
+
+	// Queues code to run asynchronously in the UI thread; returns false, discarding it, if the window is gone.
+	bool post(callable<void()> func, UINT_PTR coalesceKey = 0) const {
+		if (!this->_queue) return false;
+		std::shared_ptr<ui_queue> queue = this->_queue; // the callback may own this context, so keep everything on the stack
+		return queue->post(this->_generation, std::move(func), coalesceKey);
+	}
+};
+
+}//namespace _wli
+}//namespace wl
@@ -6,11 +6,16 @@
  */
 
 #pragma once
+#include <algorithm>
+#include <memory>
 #include "internals/base_focus_pubm.h"
 #include "internals/base_native_ctrl_pubm.h"
 #include "internals/listview_column_collection.h"
 #include "internals/listview_item_collection.h"
+#include "internals/listview_model.h"
+#include "internals/listview_row_source.h"
 #include "internals/listview_styler.h"
+#include "internals/search_index.h"
 #include "internals/member_image_list.h"
 #include "menu.h"
 #include "subclass.h"
@@ -28,6 +33,9 @@ public:
 	using item              = _wli::listview_item;
 	using item_collection   = _wli::listview_item_collection;
 	using column_collection = _wli::listview_column_collection;
+	using row_source        = _wli::listview_row_source;
+	using model             = _wli::listview_model;
+	using text_arena        = _wli::text_arena;
 
 	enum class view : WORD {
 		DETAILS   = LV_VIEW_DETAILS,
@@ -38,10 +46,16 @@ public:
 	};
 
 private:
-	HWND                   _hWnd = nullptr;
-	_wli::base_native_ctrl _baseNativeCtrl{_hWnd};
-	subclass               _subclass;
-	menu                   _contextMenu;
+	HWND                     _hWnd = nullptr;
+	_wli::base_native_ctrl   _baseNativeCtrl{_hWnd};
+	subclass                 _subclass;
+	HWND                     _hParent = nullptr; // subclassed to catch the owner-data notifications
+	menu                     _contextMenu;
+	row_source*              _pRowSource = nullptr;
+	model*                   _pModel = nullptr; // bound by set_model(), unbound when the listview is gone
+	_wli::listview_row_cache _rowCache;
+	std::wstring             _dispInfoBuf;
+	std::unique_ptr<_wli::search_index> _pSearchIndex; // captions, if enabled
 
 public:
 	// Wraps window style changes done by Get/SetWindowLongPtr.
@@ -60,6 +74,10 @@ public:
 	_wli::member_image_list<listview> imageList32{this, 32};
 
 	~listview() {
+		if (this->_pModel) {
+			this->_pModel->bind({}, nullptr); // results still on their way won't reach us
+		}
+		this->_remove_parent_subclass();
 		this->_contextMenu.destroy();
 	}
 
@@ -97,10 +115,22 @@ public:
 			this->_show_context_menu(true, p.has_ctrl(), p.has_shift());
 			return 0;
 		});
+
+		this->_subclass.on_message({LVM_INSERTITEMW, LVM_DELETEITEM, LVM_DELETEALLITEMS,
+			LVM_SETITEMTEXTW, LVM_SETITEMW, LVM_SORTITEMS, LVM_SORTITEMSEX},
+			[this](params p) -> LRESULT
+		{
+			if (!this->_pSearchIndex) { // no search index, nothing to keep in sync
+				return DefSubclassProc(this->_hWnd, p.message, p.wParam, p.lParam);
+			}
+			return this->_process_search_index_msg(p);
+		});
 	}
 
-	listview(listview&&) = default;
-	listview& operator=(listview&&) = default; // movable only
+	// Not movable: the parent subclass, the bound model and the message handlers all
+	// point to this instance, so a moved-from listview would tear them down.
+	listview(listview&&) = delete;
+	listview& operator=(listview&&) = delete;
 
 	// Ties this class instance to an existing native control.
 	listview& assign(HWND hCtrl) {
@@ -147,12 +177,230 @@ public:
 		return static_cast<view>(ListView_GetView(this->_hWnd));
 	}
 
+	// Keeps an index of the item captions, so searches are case- and diacritic-insensitive
+	// and don't query the control. It's kept in sync as items are added, changed or
+	// removed. LVM_FINDITEM is not affected, and keeps the native matching, which
+	// ignores case only. The listview must have been assigned.
+	listview& enable_search_index(bool enable = true) {
+		if (!enable) {
+			this->_pSearchIndex.reset();
+			return *this;
+		} else if (!this->_subclass.hwnd()) {
+			throw std::logic_error("Search index requires an assigned listview.");
+		} else if (GetWindowLongPtrW(this->_hWnd, GWL_STYLE) & LVS_OWNERDATA) {
+			throw std::logic_error("Virtual listview is searched through its row source.");
+		}
+
+		if (!this->_pSearchIndex) {
+			this->_pSearchIndex.reset(new _wli::search_index);
+			this->_rebuild_search_index();
+		}
+		return *this;
+	}
+
+	// Returns the first item, starting at the given one, whose caption begins with the
+	// given text, or an item with listview_item::npos index if none is found. Requires
+	// the search index.
+	item find_prefix(const wchar_t* prefix, size_t startIndex = 0) const {
+		return this->items[this->_search_index().find_prefix(prefix, startIndex)];
+	}
+
+	// Returns the first item, starting at the given one, whose caption is the given
+	// text, or an item with listview_item::npos index if none is found. Requires the
+	// search index.
+	item find_exact(const wchar_t* text, size_t startIndex = 0) const {
+		return this->items[this->_search_index().find(text, false, startIndex)];
+	}
+
+	// Returns all items whose caption contains the given text. Requires the search index.
+	std::vector<item> find_substring(const wchar_t* text) const {
+		std::vector<size_t> found = this->_search_index().find_substring(text);
+		std::vector<item> ret;
+		ret.reserve(found.size());
+		for (size_t idx : found) {
+			ret.emplace_back(this->items[idx]);
+		}
+		return ret;
+	}
+
+	// Puts the listview, which must have been created with LVS_OWNERDATA, in virtual
+	// mode: rows are not stored, but retrieved on demand from the source, which must
+	// outlive the listview. Items can't be added or removed; call reload_row_source()
+	// when the source changes.
+	listview& set_row_source(row_source& source) {
+		if (!(GetWindowLongPtrW(this->_hWnd, GWL_STYLE) & LVS_OWNERDATA)) {
+			throw std::logic_error("Virtual listview must be created with LVS_OWNERDATA style.");
+		}
+
+		this->_pRowSource = &source;
+		if (!this->_hParent) {
+			this->_install_parent_subclass();
+		}
+		return this->reload_row_source();
+	}
+
+	// Puts the listview in virtual mode, fed by the model, which must outlive the listview.
+	// Sorting and filtering run in background, and the listview is refreshed in the
+	// UI thread of the window the context belongs to, usually its parent.
+	listview& set_model(model& m, const _wli::ui_context& ctx) {
+		this->set_row_source(m);
+		if (this->_pModel && this->_pModel != &m) {
+			this->_pModel->bind({}, nullptr);
+		}
+		this->_pModel = &m;
+		m.bind(ctx, [this]() -> void { this->reload_row_source(); });
+		m.refresh();
+		return *this;
+	}
+
+	// Updates the number of items from the row source, and redraws the listview.
+	listview& reload_row_source() noexcept {
+		if (this->_pRowSource) {
+			this->_rowCache.clear();
+			ListView_SetItemCountEx(this->_hWnd, static_cast<int>(this->_pRowSource->count()),
+				LVSICF_NOSCROLL); // keep scroll position; selection is kept only if count is the same
+			InvalidateRect(this->_hWnd, nullptr, TRUE);
+		}
+		return *this;
+	}
+
 private:
 	listview& _install_subclass() {
 		this->_subclass.install_subclass(*this);
 		return *this;
 	}
 
+	const _wli::search_index& _search_index() const {
+		if (!this->_pSearchIndex) {
+			throw std::logic_error("Search index is not enabled.");
+		}
+		return *this->_pSearchIndex;
+	}
+
+	void _rebuild_search_index() {
+		size_t numItems = this->items.count();
+		this->_pSearchIndex->clear().reserve(numItems);
+		for (size_t i = 0; i < numItems; ++i) {
+			this->_pSearchIndex->push_back(this->items[i].get_text());
+		}
+	}
+
+	static const wchar_t* _caption_of(const LVITEMW* pLvi, bool checkMask) noexcept {
+		return ((!checkMask || (pLvi->mask & LVIF_TEXT)) && pLvi->pszText &&
+			pLvi->pszText != LPSTR_TEXTCALLBACKW) ? pLvi->pszText : L""; // callback texts are not known by the control either
+	}
+
+	LRESULT _process_search_index_msg(params p) {
+		LRESULT ret = DefSubclassProc(this->_hWnd, p.message, p.wParam, p.lParam);
+		const LVITEMW* pLvi = reinterpret_cast<const LVITEMW*>(p.lParam);
+
+		switch (p.message) {
+		case LVM_INSERTITEMW:
+			if (ret != -1) this->_pSearchIndex->insert(static_cast<size_t>(ret), _caption_of(pLvi, true));
+			break;
+		case LVM_DELETEITEM:
+			if (ret) this->_pSearchIndex->erase(p.wParam);
+			break;
+		case LVM_DELETEALLITEMS:
+			if (ret) this->_pSearchIndex->clear();
+			break;
+		case LVM_SETITEMTEXTW:
+			if (ret && pLvi->iSubItem == 0) this->_pSearchIndex->set(p.wParam, _caption_of(pLvi, false)); // mask is ignored
+			break;
+		case LVM_SETITEMW:
+			if (ret && pLvi->iSubItem == 0 && (pLvi->mask & LVIF_TEXT)) {
+				this->_pSearchIndex->set(static_cast<size_t>(pLvi->iItem), _caption_of(pLvi, true));
+			}
+			break;
+		case LVM_SORTITEMS:
+		case LVM_SORTITEMSEX:
+			if (ret) this->_rebuild_search_index(); // positions are all changed
+		}
+		return ret;
+	}
+
+	void _install_parent_subclass() {
+		// A bare subclass, not a wl::subclass, so all other messages of the parent,
+		// including its post_thread_ui() wakes, go straight to its own procedure.
+		this->_hParent = GetParent(this->_hWnd);
+		SetWindowSubclass(this->_hParent, _parent_subclass_proc,
+			reinterpret_cast<UINT_PTR>(this), reinterpret_cast<DWORD_PTR>(this));
+	}
+
+	void _remove_parent_subclass() noexcept {
+		if (this->_hParent) {
+			RemoveWindowSubclass(this->_hParent, _parent_subclass_proc, reinterpret_cast<UINT_PTR>(this));
+			this->_hParent = nullptr;
+		}
+	}
+
+	static LRESULT CALLBACK _parent_subclass_proc(HWND hWnd, UINT msg,
+		WPARAM wp, LPARAM lp, UINT_PTR idSubclass, DWORD_PTR refData) noexcept
+	{
+		listview* pSelf = reinterpret_cast<listview*>(refData);
+
+		if (msg == WM_NOTIFY && reinterpret_cast<NMHDR*>(lp)->hwndFrom == pSelf->_hWnd) {
+			try { // any exception from the row source
+				switch (reinterpret_cast<NMHDR*>(lp)->code) {
+				case LVN_GETDISPINFO:
+					pSelf->_on_getdispinfo(reinterpret_cast<NMLVDISPINFOW*>(lp)->item);
+					return 0;
+				case LVN_ODCACHEHINT:
+					pSelf->_on_odcachehint(*reinterpret_cast<NMLVCACHEHINT*>(lp));
+					return 0;
+				case LVN_ODFINDITEM:
+					return pSelf->_on_odfinditem(*reinterpret_cast<NMLVFINDITEMW*>(lp));
+				}
+			} catch (...) {
+				_wli::lippincott();
+				PostQuitMessage(-1);
+				return 0;
+			}
+		} else if (msg == WM_NCDESTROY) {
+			pSelf->_remove_parent_subclass();
+		}
+		return DefSubclassProc(hWnd, msg, wp, lp);
+	}
+
+	void _on_getdispinfo(LVITEMW& lvi) {
+		if (!this->_pRowSource || lvi.iItem < 0) return;
+		size_t row = static_cast<size_t>(lvi.iItem);
+
+		if ((lvi.mask & LVIF_TEXT) && lvi.pszText && lvi.cchTextMax > 0) {
+			const std::wstring* pText = this->_rowCache.get(row, lvi.iSubItem);
+			if (!pText) { // not prefetched
+				this->_dispInfoBuf = this->_pRowSource->text(row, lvi.iSubItem);
+				pText = &this->_dispInfoBuf;
+			}
+			size_t len = std::min(pText->length(), static_cast<size_t>(lvi.cchTextMax - 1)); // truncate to buffer size
+			pText->copy(lvi.pszText, len);
+			lvi.pszText[len] = L'\0';
+		}
+		if ((lvi.mask & LVIF_IMAGE) && lvi.iSubItem == 0) {
+			lvi.iImage = this->_pRowSource->icon(row);
+		}
+		if (lvi.mask & LVIF_STATE) {
+			lvi.state = (lvi.state & ~lvi.stateMask) | (this->_pRowSource->state(row) & lvi.stateMask);
+		}
+	}
+
+	void _on_odcachehint(const NMLVCACHEHINT& hint) {
+		if (!this->_pRowSource || hint.iFrom < 0 || hint.iTo < hint.iFrom) return;
+		size_t first = static_cast<size_t>(hint.iFrom), last = static_cast<size_t>(hint.iTo);
+		this->_pRowSource->prefetch(first, last);
+		this->_rowCache.fill(*this->_pRowSource, first, last,
+			Header_GetItemCount(ListView_GetHeader(this->_hWnd)));
+	}
+
+	LRESULT _on_odfinditem(const NMLVFINDITEMW& nmfi) const {
+		const LVFINDINFOW& lfi = nmfi.lvfi;
+		if (!this->_pRowSource || !(lfi.flags & (LVFI_STRING | LVFI_PARTIAL)) || !lfi.psz) return -1;
+		size_t found = this->_pRowSource->find(lfi.psz, (lfi.flags & LVFI_PARTIAL) != 0,
+			nmfi.iStart < 0 ? 0 : static_cast<size_t>(nmfi.iStart),
+			(lfi.flags & LVFI_WRAP) != 0);
+		return found == row_source::npos ? -1 : static_cast<LRESULT>(found);
+	}
+
 	int _show_context_menu(bool followCursor, bool hasCtrl, bool hasShift) noexcept {
 		if (!this->_contextMenu.hmenu()) return -1; // no context menu assigned
 
@@ -7,6 +7,7 @@
 
 #pragma once
 #include <string>
+#include <string_view>
 #include <system_error>
 #include <Windows.h>
 
@@ -83,16 +84,22 @@ public:
 	}
 
 private:
-	std::wstring _get_caption(UINT identif, BOOL byPos) const {
-		wchar_t captionBuf[64]{}; // arbitrary buffer length
+	std::wstring_view _get_caption(UINT identif, BOOL byPos, std::wstring& buf) const {
 		MENUITEMINFOW mii{};
 		mii.cbSize     = sizeof(mii);
-		mii.cch        = ARRAYSIZE(captionBuf);
-		mii.dwTypeData = captionBuf;
-		mii.fMask      = MIIM_STRING;
+		mii.fMask      = MIIM_STRING; // with null dwTypeData, just retrieves the length
+
+		if (!GetMenuItemInfoW(this->_hMenu, identif, byPos, &mii) || !mii.cch) {
+			buf.clear();
+			return buf;
+		}
+		buf.resize(mii.cch + 1, L'\0'); // room for terminating null
+		mii.cch        = static_cast<UINT>(buf.size());
+		mii.dwTypeData = &buf[0];
 
 		GetMenuItemInfoW(this->_hMenu, identif, byPos, &mii);
-		return captionBuf;
+		buf.resize(mii.cch);
+		return buf;
 	}
 
 	menu& _set_caption(UINT identif, const wchar_t* caption, BOOL byPos) noexcept {
@@ -106,12 +113,14 @@ private:
 	}
 
 public:
-	std::wstring get_caption_by_pos(size_t pos) const { return this->_get_caption(static_cast<UINT>(pos), TRUE); }
-	std::wstring get_caption_by_id(WORD cmdId) const  { return this->_get_caption(cmdId, FALSE); }
-	menu&        set_caption_by_pos(size_t pos, const wchar_t* caption) noexcept      { return this->_set_caption(static_cast<UINT>(pos), caption, TRUE); }
-	menu&        set_caption_by_pos(size_t pos, const std::wstring& caption) noexcept { return this->_set_caption(static_cast<UINT>(pos), caption.c_str(), TRUE); }
-	menu&        set_caption_by_id(WORD cmdId, const wchar_t* caption) noexcept       { return this->_set_caption(cmdId, caption, FALSE); }
-	menu&        set_caption_by_id(WORD cmdId, const std::wstring& caption) noexcept  { return this->_set_caption(cmdId, caption.c_str(), FALSE); }
+	std::wstring      get_caption_by_pos(size_t pos) const { std::wstring buf; this->_get_caption(static_cast<UINT>(pos), TRUE, buf); return buf; }
+	std::wstring      get_caption_by_id(WORD cmdId) const  { std::wstring buf; this->_get_caption(cmdId, FALSE, buf); return buf; }
+	std::wstring_view get_caption_by_pos(size_t pos, std::wstring& buf) const { return this->_get_caption(static_cast<UINT>(pos), TRUE, buf); }
+	std::wstring_view get_caption_by_id(WORD cmdId, std::wstring& buf) const  { return this->_get_caption(cmdId, FALSE, buf); }
+	menu&             set_caption_by_pos(size_t pos, const wchar_t* caption) noexcept      { return this->_set_caption(static_cast<UINT>(pos), caption, TRUE); }
+	menu&             set_caption_by_pos(size_t pos, const std::wstring& caption) noexcept { return this->_set_caption(static_cast<UINT>(pos), caption.c_str(), TRUE); }
+	menu&             set_caption_by_id(WORD cmdId, const wchar_t* caption) noexcept       { return this->_set_caption(cmdId, caption, FALSE); }
+	menu&             set_caption_by_id(WORD cmdId, const std::wstring& caption) noexcept  { return this->_set_caption(cmdId, caption.c_str(), FALSE); }
 
 	menu& append_separator() noexcept {
 		InsertMenuW(this->_hMenu, -1, MF_BYPOSITION | MF_SEPARATOR, 0, nullptr);
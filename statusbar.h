@@ -6,6 +6,7 @@
  */
 
 #pragma once
+#include <string_view>
 #include <vector>
 #include "internals/base_native_ctrl_pubm.h"
 #include "internals/params.h"
@@ -136,12 +137,18 @@ public:
 
 	std::wstring get_text(size_t iPart) const {
 		std::wstring buf;
+		this->get_text(iPart, buf);
+		return buf;
+	}
+
+	// Retrieves the text into the given buffer, reusing its memory, and returns a view to it.
+	std::wstring_view get_text(size_t iPart, std::wstring& buf) const {
 		int len = LOWORD(SendMessageW(this->_hWnd, SB_GETTEXTLENGTH, iPart, 0));
+		buf.resize(len + 1, L'\0');
 		if (len) {
-			buf.resize(len + 1, L'\0');
 			SendMessageW(this->_hWnd, SB_GETTEXT, iPart, reinterpret_cast<LPARAM>(&buf[0]));
-			buf.resize(len);
 		}
+		buf.resize(len);
 		return buf;
 	}
 
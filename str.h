@@ -8,7 +8,12 @@
 #pragma once
 #include <stdexcept>
 #include <vector>
+#include "internals/str_builder.h"
+#include "internals/str_decoder.h"
+#include "internals/str_format.h"
 #include "internals/str_priv.h"
+#include "internals/str_search.h"
+#include "internals/str_tokenizer.h"
 
 namespace wl {
 
@@ -74,6 +79,18 @@ inline std::wstring format(const std::wstring& strFormat, const argsT&... args)
 		std::forward<const argsT&>(args)...);
 }
 
+// Type-safe and locale-independent formatting, with {} placeholders, {:x} for hex
+// integers and {:.2} for 2 decimal places; floats are written in their shortest form.
+// The format string is parsed once, at compile time if the compiler supports consteval.
+template<typename ...argsT>
+inline std::wstring fmt(_wli::fmt_string<typename _wli::fmt_identity<argsT>::type...> strFormat, const argsT&... args) {
+	return _wli::fmt_engine::format(strFormat, args...);
+}
+
+// Builds a long string out of many pieces with few allocations: short text stays on
+// the stack, and formatted values are written straight into it.
+using builder = _wli::str_builder;
+
 // Compares two strings, case insensitive.
 inline bool eqi(const std::wstring& s, const wchar_t* what) noexcept {
 	return !lstrcmpiW(s.c_str(), what); // str::eq() would be just operator==(), that's why there's no str::eq()
@@ -150,67 +167,67 @@ inline std::wstring reverse(const wchar_t* s) {
 }
 
 // Simple diacritics removal, in-place.
+// Handles ÁáÀàÃãÂâÄäÉéÈèÊêËëÍíÌìÎîÏïÓóÒòÕõÔôÖöÚúÙùÛûÜüÇçÅåÐðÑñØøÝý.
 inline std::wstring& remove_diacritics(std::wstring& s) noexcept {
-	const wchar_t* diacritics   = L"ÁáÀàÃãÂâÄäÉéÈèÊêËëÍíÌìÎîÏïÓóÒòÕõÔôÖöÚúÙùÛûÜüÇçÅåÐðÑñØøÝý";
-	const wchar_t* replacements = L"AaAaAaAaAaEeEeEeEeIiIiIiIiOoOoOoOoOoUuUuUuUuCcAaDdNnOoYy";
 	for (wchar_t& ch : s) {
-		const wchar_t* pDiac = diacritics;
-		const wchar_t* pRepl = replacements;
-		while (*pDiac) {
-			if (ch == *pDiac) ch = *pRepl; // in-place replacement
-			++pDiac;
-			++pRepl;
-		}
+		ch = _wli::str_priv::remove_diacritic(ch); // in-place replacement, single table lookup
 	}
 	return s;
 }
 
+// Case-insensitive substring search, with the needle preprocessed once, so it can be
+// used on many haystacks without allocations.
+using searcher = _wli::str_searcher;
+
 // Finds index of substring within string, case insensitive.
 inline size_t findi(const std::wstring& haystack, const wchar_t* needle, size_t offset = 0) {
-	std::wstring haystack2 = upper(haystack);
-	std::wstring needle2 = needle;
-	CharUpperBuffW(&needle2[0], static_cast<DWORD>(needle2.length()));
-	return haystack2.find(needle2, offset);
+	return searcher(needle).find(haystack, offset);
 }
 
 // Finds index of substring within string, case insensitive.
 inline size_t findi(const std::wstring& haystack, const std::wstring& needle, size_t offset = 0) {
-	return findi(haystack, needle.c_str(), offset);
+	return searcher(needle).find(haystack, offset);
 }
 
 // Finds index of substring within string, case insensitive, reverse search.
-inline size_t rfindi(const std::wstring& haystack, const wchar_t* needle, size_t offset = 0) {
-	std::wstring haystack2 = upper(haystack);
-	std::wstring needle2 = needle;
-	CharUpperBuffW(&needle2[0], static_cast<DWORD>(needle2.length()));
-	return haystack2.rfind(needle2, offset);
+inline size_t rfindi(const std::wstring& haystack, const wchar_t* needle, size_t offset = std::wstring::npos) {
+	return searcher(needle).rfind(haystack, offset);
 }
 
 // Finds index of substring within string, case insensitive, reverse search.
-inline size_t rfindi(const std::wstring& haystack, const std::wstring& needle, size_t offset = 0) {
-	return rfindi(haystack, needle, offset);
+inline size_t rfindi(const std::wstring& haystack, const std::wstring& needle, size_t offset = std::wstring::npos) {
+	return searcher(needle).rfind(haystack, offset);
 }
 
 // Finds all occurrences of a substring, case sensitive, and replaces them all, in-place.
 inline std::wstring& replace(std::wstring& haystack, const std::wstring& needle, const std::wstring& replacement) {
 	if (haystack.empty() || needle.empty()) return haystack;
 
-	std::wstring output;
+	std::wstring_view hay = haystack;
+	size_t found = hay.find(needle);
+	if (found == std::wstring::npos) return haystack; // nothing to replace, no allocations
+
+	if (needle.length() == replacement.length()) { // same length, no need to move anything
+		do {
+			haystack.replace(found, needle.length(), replacement);
+			found = hay.find(needle, found + needle.length());
+		} while (found != std::wstring::npos);
+		return haystack;
+	}
+
+	builder output(haystack.length() + (replacement.length() > needle.length() ? // room for a few growing replacements
+		4 * (replacement.length() - needle.length()) : 0));
 	size_t base = 0;
-	size_t found = 0;
 
 	for (;;) {
-		found = haystack.find(needle, found);
-		output.insert(output.length(), haystack, base, found - base);
-		if (found != std::wstring::npos) {
-			output.append(replacement);
-			base = found = found + needle.length();
-		} else {
-			break;
-		}
+		output.append(hay.substr(base, found - base));
+		if (found == std::wstring::npos) break;
+		output.append(replacement);
+		base = found + needle.length();
+		found = hay.find(needle, base);
 	}
 
-	haystack.swap(output); // behaves like an in-place operation
+	haystack = output.str(); // behaves like an in-place operation
 	return haystack;
 }
 
@@ -218,25 +235,24 @@ inline std::wstring& replace(std::wstring& haystack, const std::wstring& needle,
 inline std::wstring& replacei(std::wstring& haystack, const std::wstring& needle, const std::wstring& replacement) {
 	if (haystack.empty() || needle.empty()) return haystack;
 
-	std::wstring haystackU = upper(haystack);
-	std::wstring needleU = upper(needle);
+	searcher needleSearcher(needle);
+	size_t found = needleSearcher.find(haystack);
+	if (found == std::wstring::npos) return haystack; // nothing to replace, no allocations
 
-	std::wstring output;
+	std::wstring_view hay = haystack;
+	builder output(haystack.length() + (replacement.length() > needle.length() ?
+		4 * (replacement.length() - needle.length()) : 0));
 	size_t base = 0;
-	size_t found = 0;
 
 	for (;;) {
-		found = haystackU.find(needleU, found);
-		output.insert(output.length(), haystack, base, found - base);
-		if (found != std::wstring::npos) {
-			output.append(replacement);
-			base = found = found + needle.length();
-		} else {
-			break;
-		}
+		output.append(hay.substr(base, found - base));
+		if (found == std::wstring::npos) break;
+		output.append(replacement);
+		base = found + needle.length();
+		found = needleSearcher.find(haystack, base);
 	}
 
-	haystack.swap(output); // behaves like an in-place operation
+	haystack = output.str(); // behaves like an in-place operation
 	return haystack;
 }
 
@@ -288,59 +304,34 @@ inline bool is_float(const std::wstring& s) noexcept {
 	return true;
 }
 
-// Possible string encodings.
-enum class encoding { UNKNOWN, ASCII, WIN1252, UTF8, UTF16BE, UTF16LE, UTF32BE, UTF32LE, SCSU, BOCU1 };
-
-// Encoding information of a string.
-struct encoding_info final {
-	encoding encType = encoding::UNKNOWN;
-	size_t   bomSize = 0;
-};
-
-// Returns encoding information about the given string.
-inline encoding_info get_encoding(const BYTE* data, size_t sz) noexcept {
-	auto match = [&](const BYTE* pBom, int szBom) noexcept -> bool {
-		return (sz >= static_cast<size_t>(szBom)) &&
-			!memcmp(data, pBom, sizeof(BYTE) * szBom);
-	};
-
-	// https://en.wikipedia.org/wiki/Byte_order_mark
-
-	BYTE utf8[] = {0xEF, 0xBB, 0xBF}; // UTF-8 BOM
-	if (match(utf8, 3)) return {encoding::UTF8, 3}; // BOM size in bytes
-
-	BYTE utf16be[] = {0xFE, 0xFF};
-	if (match(utf16be, 2)) return {encoding::UTF16BE, 2};
-
-	BYTE utf16le[] = {0xFF, 0xFE};
-	if (match(utf16le, 2)) return {encoding::UTF16LE, 2};
+// Parses the whole string as an integer in base 10 or 16, validating it in the same
+// pass. Blanks around it are accepted. Returns false if it's not a number or doesn't
+// fit the type, leaving out untouched.
+template<typename intT>
+inline bool parse_int(std::wstring_view s, intT& out, int base = 10) noexcept {
+	return _wli::str_number::parse_int(s, out, base);
+}
 
-	BYTE utf32be[] = {0x00, 0x00, 0xFE, 0xFF};
-	if (match(utf32be, 4)) return {encoding::UTF32BE, 4};
+// Parses the whole string as a float, validating it in the same pass, regardless of
+// locale. Blanks around it are accepted. Returns false if it's not a number, leaving
+// out untouched.
+inline bool parse_float(std::wstring_view s, double& out) noexcept {
+	return _wli::str_number::parse_float(s, out);
+}
 
-	BYTE utf32le[] = {0xFF, 0xFE, 0x00, 0x00};
-	if (match(utf32le, 4)) return {encoding::UTF32LE, 4};
+// Possible string encodings.
+using encoding = _wli::encoding;
 
-	BYTE scsu[] = {0x0E, 0xFE, 0xFF};
-	if (match(scsu, 3)) return {encoding::SCSU, 3};
+// Encoding information of a string.
+using encoding_info = _wli::encoding_info;
 
-	BYTE bocu1[] = {0xFB, 0xEE, 0x28};
-	if (match(bocu1, 3)) return {encoding::BOCU1, 3};
+// Decodes text chunk by chunk, guessing the encoding from its beginning.
+using decoder = _wli::str_decoder;
 
-	// No BOM found, guess UTF-8 without BOM, or Windows-1252 (superset of ISO-8859-1).
-	bool canBeWin1252 = false;
-	for (size_t i = 0; i < sz; ++i) {
-		if (data[i] > 0x7F) { // 127
-			canBeWin1252 = true;
-			if (i <= sz - 2 && (
-				(data[i] == 0xC2 && (data[i+1] >= 0xA1 && data[i+1] <= 0xBF)) || // http://www.utf8-chartable.de
-				(data[i] == 0xC3 && (data[i+1] >= 0x80 && data[i+1] <= 0xBF)) ))
-			{
-				return {encoding::UTF8, 0}; // UTF-8 without BOM
-			}
-		}
-	}
-	return {(canBeWin1252 ? encoding::WIN1252 : encoding::ASCII), 0};
+// Returns encoding information about the given string. Without BOM, the guess is
+// made from a prefix, plus a window at the first non-ASCII byte, if any.
+inline encoding_info get_encoding(const BYTE* data, size_t sz) noexcept {
+	return _wli::str_decoder::detect(data, sz);
 }
 
 // Returns encoding information about the given string.
@@ -368,21 +359,37 @@ inline std::vector<BYTE> to_utf8_blob(const std::wstring& s, write_bom writeBom)
 	std::vector<BYTE> ret;
 	if (!s.empty()) {
 		BYTE utf8bom[]{0xEF, 0xBB, 0xBF};
-		int szBom = (writeBom == write_bom::YES) ? ARRAYSIZE(utf8bom) : 0;
+		size_t szBom = (writeBom == write_bom::YES) ? ARRAYSIZE(utf8bom) : 0;
 
-		int neededLen = WideCharToMultiByte(CP_UTF8, 0,
-			s.c_str(), static_cast<int>(s.length()),
-			nullptr, 0, nullptr, 0);
-		ret.resize(neededLen + szBom);
+		ret.resize(szBom + _wli::str_transcode::utf8_length(s.c_str(), s.length())); // exact size, allocated once
+		if (writeBom == write_bom::YES) {
+			memcpy(&ret[0], utf8bom, szBom);
+		}
+		_wli::str_transcode::utf16_to_utf8(s.c_str(), s.length(), &ret[0 + szBom]);
+	}
+	return ret;
+}
 
+// Converts the contents of a builder to an UTF-8 blob, with no intermediary string.
+inline std::vector<BYTE> to_utf8_blob(const builder& b, write_bom writeBom) {
+	std::vector<BYTE> ret;
+	if (!b.empty()) {
+		BYTE utf8bom[]{0xEF, 0xBB, 0xBF};
+		size_t szBom = (writeBom == write_bom::YES) ? ARRAYSIZE(utf8bom) : 0;
+
+		size_t szBlob = szBom;
+		b.for_each_piece([&szBlob](std::wstring_view piece) -> void {
+			szBlob += _wli::str_transcode::utf8_length(piece.data(), piece.length());
+		});
+		ret.resize(szBlob); // exact size, allocated once
 		if (writeBom == write_bom::YES) {
 			memcpy(&ret[0], utf8bom, szBom);
 		}
 
-		WideCharToMultiByte(CP_UTF8, 0,
-			s.c_str(), static_cast<int>(s.length()),
-			reinterpret_cast<char*>(&ret[0 + szBom]),
-			neededLen, nullptr, nullptr);
+		BYTE* pDest = &ret[0] + szBom;
+		b.for_each_piece([&pDest](std::wstring_view piece) -> void {
+			pDest += _wli::str_transcode::utf16_to_utf8(piece.data(), piece.length(), pDest);
+		});
 	}
 	return ret;
 }
@@ -396,28 +403,31 @@ inline std::string to_ascii(const std::wstring& s) {
 	return ret;
 }
 
-// Conversion to wstring.
-inline std::wstring to_wstring(const BYTE* data, size_t sz) {
-	if (!data || !sz) return {};
-
-	encoding_info fileEnc = get_encoding(data, sz);
-	data += fileEnc.bomSize; // skip BOM, if any
-
-	switch (fileEnc.encType) {
+// Conversion to wstring, from data in the given encoding, without BOM.
+inline std::wstring to_wstring(const BYTE* data, size_t sz, encoding encType) {
+	switch (encType) {
 	case encoding::UNKNOWN:
 	case encoding::ASCII:   return _wli::str_priv::parse_ascii(data, sz);
 	case encoding::WIN1252: return _wli::str_priv::parse_encoded(data, sz, 1252);
 	case encoding::UTF8:    return _wli::str_priv::parse_encoded(data, sz, CP_UTF8);
-	case encoding::UTF16BE: throw std::invalid_argument("UTF-16 big endian: encoding not implemented.");
-	case encoding::UTF16LE: throw std::invalid_argument("UTF-16 little endian: encoding not implemented.");
-	case encoding::UTF32BE: throw std::invalid_argument("UTF-32 big endian: encoding not implemented.");
-	case encoding::UTF32LE: throw std::invalid_argument("UTF-32 little endian: encoding not implemented.");
+	case encoding::UTF16BE:
+	case encoding::UTF16LE:
+	case encoding::UTF32BE:
+	case encoding::UTF32LE: return _wli::str_priv::parse_wide(data, sz, encType);
 	case encoding::SCSU:    throw std::invalid_argument("Standard compression scheme for Unicode: encoding not implemented.");
 	case encoding::BOCU1:   throw std::invalid_argument("Binary ordered compression for Unicode: encoding not implemented.");
 	default:                throw std::invalid_argument("Unknown encoding.");
 	}
 }
 
+// Conversion to wstring, guessing the encoding.
+inline std::wstring to_wstring(const BYTE* data, size_t sz) {
+	if (!data || !sz) return {};
+
+	encoding_info fileEnc = get_encoding(data, sz);
+	return to_wstring(data + fileEnc.bomSize, sz - fileEnc.bomSize, fileEnc.encType); // skip BOM, if any
+}
+
 // Conversion to wstring.
 inline std::wstring to_wstring(const std::vector<BYTE>& data) {
 	return to_wstring(&data[0], data.size());
@@ -434,74 +444,45 @@ inline std::wstring to_wstring(const std::string& s) {
 }
 
 // Converts number to wstring, adding thousand separator.
-inline std::wstring to_wstring_with_separator(int number, wchar_t separator = L',') {
-	std::wstring ret;
-	ret.reserve(32); // arbitrary
-
-	int abso = abs(number);
-	BYTE blocks = 0;
-	while (abso >= 1000) {
-		abso = (abso - (abso % 1000)) / 1000;
-		++blocks;
-	}
-
-	abso = abs(number);
-	bool firstPass = true;
-	do {
-		int num = abso % 1000;
-		wchar_t buf[8]{};
-
-		if (blocks) {
-			if (num < 100) lstrcatW(buf, L"0");
-			if (num < 10) lstrcatW(buf, L"0");
-		}
-
-#pragma warning (disable: 4996)
-		_itow(num, buf + lstrlenW(buf), 10);
-#pragma warning (default: 4996)
+template<typename intT, typename = std::enable_if_t<std::is_integral_v<intT>>>
+inline std::wstring to_wstring_with_separator(intT number, wchar_t separator = L',') {
+	wchar_t buf[_wli::str_number::MAX_INT_LEN + 8]; // room for the separators
+	wchar_t* pEnd = buf + ARRAYSIZE(buf);
+	return {_wli::str_number::write_int_backwards(number, pEnd, separator), pEnd};
+}
 
-		if (firstPass) {
-			firstPass = false;
-		} else {
-			ret.insert(0, 1, separator);
-		}
+// Lazily splits the string at the given characters, which will be removed. Tokens
+// are views into the string, with no copies.
+inline _wli::str_split_range split_view(std::wstring_view s, std::wstring_view delimiter) noexcept {
+	return {s, delimiter};
+}
 
-		ret.insert(0, buf);
-		abso = (abso - (abso % 1000)) / 1000;
-	} while (blocks--);
+// Lazily splits a string line by line, with any mix of CR, LF and CRLF linebreaks.
+// Lines are views into the string, with no copies.
+inline _wli::str_lines_range split_lines_view(std::wstring_view s) noexcept {
+	return _wli::str_lines_range{s};
+}
 
-	if (number < 0) ret.insert(0, 1, L'-'); // prepend minus signal
-	return ret;
+// Lazily splits string into tokens, which may be enclosed in double quotes. Tokens are
+// views into the string, with no copies.
+inline _wli::str_quoted_range split_quoted_view(std::wstring_view s) noexcept {
+	return _wli::str_quoted_range{s};
 }
 
-// Converts number to wstring, adding thousand separator.
-inline std::wstring to_wstring_with_separator(size_t number, wchar_t separator = L',') {
-	return to_wstring_with_separator(static_cast<int>(number), separator);
+// Returns a view to the string without leading and trailing spaces, using std::iswspace.
+inline std::wstring_view trim_view(std::wstring_view s) noexcept {
+	size_t iFirst = 0, iPastLast = s.length();
+	while (iFirst < iPastLast && std::iswspace(s[iFirst])) ++iFirst;
+	while (iPastLast > iFirst && std::iswspace(s[iPastLast - 1])) --iPastLast;
+	return s.substr(iFirst, iPastLast - iFirst);
 }
 
 // Splits the string at the given characters, the characters themselves will be removed.
 inline std::vector<std::wstring> split(const std::wstring& s, const wchar_t* delimiter) {
 	std::vector<std::wstring> ret;
-	if (s.empty()) return ret;
-
-	if (!delimiter) {
-		ret.emplace_back(s); // one single line
-		return ret;
-	}
-
-	size_t base = 0, head = 0;
-
-	for (;;) {
-		head = s.find(delimiter, head);
-		if (head == std::wstring::npos) break;
-		ret.emplace_back();
-		ret.back().insert(0, s, base, head - base);
-		head += lstrlenW(delimiter);
-		base = head;
+	for (std::wstring_view token : split_view(s, delimiter ? delimiter : L"")) { // null delimiter: one single line
+		ret.emplace_back(token);
 	}
-
-	ret.emplace_back();
-	ret.back().insert(0, s, base, s.length() - base);
 	return ret;
 }
 
@@ -510,9 +491,13 @@ inline std::vector<std::wstring> split(const std::wstring& s, const std::wstring
 	return split(s, delimiter.c_str());
 }
 
-// Splits a string line by line.
+// Splits a string line by line, with any mix of CR, LF and CRLF linebreaks.
 inline std::vector<std::wstring> split_lines(const std::wstring& s) {
-	return split(s, get_linebreak(s));
+	std::vector<std::wstring> ret;
+	for (std::wstring_view line : split_lines_view(s)) {
+		ret.emplace_back(line);
+	}
+	return ret;
 }
 
 // Splits a zero-delimited multi-string.
@@ -521,23 +506,11 @@ inline std::vector<std::wstring> split_multi_zero(const wchar_t* s) {
 	// L"first one\0second one\0third one\0"
 	// Assumes a well-formed multiStr, which ends with two nulls.
 
-	// Count number of null-delimited strings; string end with double null.
-	size_t numStrings = 0;
-	const wchar_t* pRun = s;
-	while (*pRun) {
-		++numStrings;
-		pRun += lstrlenW(pRun) + 1;
-	}
-
-	// Alloc return array of strings.
 	std::vector<std::wstring> ret;
-	ret.reserve(numStrings);
-
-	// Copy each string.
-	pRun = s;
-	for (size_t i = 0; i < numStrings; ++i) {
-		ret.emplace_back(pRun);
-		pRun += lstrlenW(pRun) + 1;
+	for (const wchar_t* pRun = s; *pRun; ) {
+		size_t len = lstrlenW(pRun);
+		ret.emplace_back(pRun, len);
+		pRun += len + 1;
 	}
 	return ret;
 }
@@ -547,69 +520,10 @@ inline std::vector<std::wstring> split_quoted(const wchar_t* s) {
 	// Example quoted string:
 	// "First one" NoQuoteSecond "Third one"
 
-	// Count number of strings.
-	size_t numStrings = 0;
-	const wchar_t* pRun = s;
-	while (*pRun) {
-		if (*pRun == L'\"') { // begin of quoted string
-			++pRun; // point to 1st char of string
-			for (;;) {
-				if (!*pRun) {
-					break; // won't compute open-quoted
-				} else if (*pRun == L'\"') {
-					++pRun; // point to 1st char after closing quote
-					++numStrings;
-					break;
-				}
-				++pRun;
-			}
-		} else if (!std::iswspace(*pRun)) { // 1st char of non-quoted string
-			++pRun; // point to 2nd char of string
-			while (*pRun && !std::iswspace(*pRun) && *pRun != L'\"') ++pRun; // passed string
-			++numStrings;
-		} else {
-			++pRun; // some white space
-		}
-	}
-
-	// Alloc return array of strings.
 	std::vector<std::wstring> ret;
-	ret.reserve(numStrings);
-
-	// Alloc and copy each string.
-	pRun = s;
-	const wchar_t* pBase;
-	int i = 0;
-	while (*pRun) {
-		if (*pRun == L'\"') { // begin of quoted string
-			++pRun; // point to 1st char of string
-			pBase = pRun;
-			for (;;) {
-				if (!*pRun) {
-					break; // won't compute open-quoted
-				} else if (*pRun == L'\"') {
-					ret.emplace_back();
-					ret.back().insert(0, pBase, pRun - pBase); // copy to buffer
-					++i; // next string
-
-					++pRun; // point to 1st char after closing quote
-					break;
-				}
-				++pRun;
-			}
-		} else if (!std::iswspace(*pRun)) { // 1st char of non-quoted string
-			pBase = pRun;
-			++pRun; // point to 2nd char of string
-			while (*pRun && !std::iswspace(*pRun) && *pRun != L'\"') ++pRun; // passed string
-
-			ret.emplace_back();
-			ret.back().insert(0, pBase, pRun - pBase); // copy to buffer
-			++i; // next string
-		} else {
-			++pRun; // some white space
-		}
+	for (std::wstring_view token : split_quoted_view(s)) {
+		ret.emplace_back(token);
 	}
-
 	return ret;
 }
 
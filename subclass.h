@@ -39,6 +39,7 @@ public:
 	void remove_subclass() noexcept {
 		if (this->hwnd()) {
 			RemoveWindowSubclass(this->hwnd(), _subclass_proc, this->_subclassId);
+			this->_baseMsg.detachHook(); // queued post_thread_ui() callbacks are dropped
 			this->_hWnd = nullptr; // clear HWND
 		}
 	}
@@ -55,6 +56,7 @@ public:
 			this->_subclassId = _next_id();
 			SetWindowSubclass(hCtrl, _subclass_proc, this->_subclassId,
 				reinterpret_cast<DWORD_PTR>(this));
+			this->_baseMsg.attachHook(); // the subclass has no WM_NCCREATE
 		}
 	}
 
@@ -0,0 +1,72 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+// Throughput of file_aio on the POSIX backend, in GB/s: many small requests in flight
+// and one big request split into parallel chunks, against a single positional call.
+// Reads mostly hit the page cache, so this measures the dispatch, not the disk.
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "internals/file_aio.h"
+#include "test.h"
+
+using wl::_wli::file_aio;
+using wl::_wli::file_aio_backend;
+
+template<typename funcT>
+static void measure(const char* what, size_t numBytes, funcT&& func) {
+	auto t0 = std::chrono::steady_clock::now();
+	func();
+	double secs = test::seconds_since(t0);
+	std::printf("%-34s %8.1f ms  %6.2f GB/s\n", what, secs * 1000, numBytes / secs / 1e9);
+}
+
+int main(int argc, char** argv) {
+	test::rng(argc, argv);
+	const size_t total = 256 << 20;
+	std::vector<unsigned char> src(total), dest(total);
+	for (unsigned char& b : src) b = static_cast<unsigned char>(test::rng()());
+
+	std::string path = "winlamb_bench_file_aio_XXXXXX";
+	int fd = mkstemp(&path[0]);
+	CHECK(fd >= 0);
+	file_aio aio(fd);
+
+	measure("write_at, 1 call", total, [&]() {
+		size_t done = 0;
+		CHECK(!file_aio_backend::write_at(fd, 0, src.data(), total, done));
+	});
+	measure("write, 256 requests of 1 MB", total, [&]() {
+		for (size_t off = 0; off < total; off += 1 << 20) {
+			aio.write(off, &src[off], 1 << 20, nullptr);
+		}
+		aio.wait();
+	});
+	measure("read_at, 1 call", total, [&]() {
+		size_t done = 0;
+		CHECK(!file_aio_backend::read_at(fd, 0, dest.data(), total, done));
+	});
+	measure("read, 1 request in 4 MB chunks", total, [&]() {
+		aio.read(0, dest.data(), total, nullptr);
+		aio.wait();
+	});
+	std::memset(dest.data(), 0, total);
+	measure("read, 4096 requests of 64 KB", total, [&]() {
+		for (size_t off = 0; off < total; off += 64 << 10) {
+			aio.read(off, &dest[off], 64 << 10, nullptr);
+		}
+		aio.wait();
+	});
+	CHECK(std::memcmp(src.data(), dest.data(), total) == 0);
+
+	close(fd);
+	unlink(path.c_str());
+	return 0;
+}
@@ -0,0 +1,77 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+// Cost of 10,000 saves of a small settings file, on the POSIX backend: a plain
+// truncate and write, which a crash can tear, against the atomic write at each
+// durability, and the write-behind queue, which coalesces them.
+
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "internals/file_write_behind.h"
+#include "test.h"
+
+using wl::_wli::BYTE;
+using wl::_wli::file_atomic_backend;
+using wl::_wli::file_write_behind;
+using durability = file_atomic_backend::durability;
+
+static const int NUM_SAVES = 10000;
+
+template<typename funcT>
+static void measure(const char* what, funcT&& func) {
+	auto t0 = std::chrono::steady_clock::now();
+	func();
+	double secs = test::seconds_since(t0);
+	std::printf("%-32s %9.1f ms  %8.1f us/save\n", what, secs * 1000, secs * 1e6 / NUM_SAVES);
+}
+
+int main(int argc, char** argv) {
+	test::rng(argc, argv);
+	char dirName[] = "winlamb_bench_file_atomic_XXXXXX";
+	CHECK(mkdtemp(dirName));
+	std::string dir = dirName, path = dir + "/settings.ini";
+	std::wstring wpath(path.begin(), path.end());
+	std::vector<BYTE> data(600, 'a');
+
+	measure("plain write, not atomic", [&]() {
+		for (int i = 0; i < NUM_SAVES; ++i) {
+			data[0] = static_cast<BYTE>('a' + i % 26);
+			int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+			CHECK(fd >= 0);
+			CHECK(write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size()));
+			close(fd);
+		}
+	});
+
+	const std::pair<durability, const char*> durs[] = {
+		{durability::NONE, "atomic, NONE"}, {durability::DATA, "atomic, DATA"}, {durability::FULL, "atomic, FULL"}};
+	for (const auto& d : durs) {
+		measure(d.second, [&]() {
+			for (int i = 0; i < NUM_SAVES; ++i) {
+				data[0] = static_cast<BYTE>('a' + i % 26);
+				CHECK(!file_atomic_backend::write(wpath, data.data(), data.size(), d.first));
+			}
+		});
+	}
+
+	file_write_behind& q = file_write_behind::instance();
+	measure("write-behind, DATA, coalesced", [&]() {
+		for (int i = 0; i < NUM_SAVES; ++i) {
+			data[0] = static_cast<BYTE>('a' + i % 26);
+			q.write(wpath, data, durability::DATA);
+		}
+		q.flush();
+	});
+	q.shutdown();
+
+	unlink(path.c_str());
+	rmdir(dir.c_str());
+	return 0;
+}
@@ -0,0 +1,76 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+// search_index over a corpus of 1M random words: the time to fill it and build the
+// structures, then the latency of type-ahead and substring queries, alone and with
+// insertions and removals in between, as a sorted control would do.
+
+#include <algorithm>
+#include <cwctype>
+#include <string>
+#include <vector>
+#include "internals/search_index.h"
+#include "test.h"
+
+using wl::_wli::search_index;
+
+static std::wstring random_word() { // syllables of a consonant and a vowel, some accented
+	static const wchar_t consonants[] = L"bcdfglmnprstvz", vowels[] = L"aeiouáéíóúãõ";
+	std::wstring w;
+	size_t n = 2 + test::rand_below(4);
+	for (size_t i = 0; i < n; ++i) {
+		w += consonants[test::rand_below(14)];
+		w += vowels[test::rand_below(12)];
+	}
+	if (test::rand_below(2)) w[0] = static_cast<wchar_t>(std::towupper(w[0]));
+	return w;
+}
+
+template<typename funcT>
+static void time_each(const char* name, size_t n, funcT&& func) {
+	auto t0 = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < n; ++i) func(i);
+	std::printf("%-34s %9.2f us each\n", name, test::seconds_since(t0) * 1e6 / n);
+}
+
+int main(int argc, char** argv) {
+	test::rng(argc, argv);
+	const size_t numWords = 1000000;
+	std::vector<std::wstring> words(numWords);
+	for (std::wstring& w : words) w = random_word();
+
+	search_index idx;
+	auto t0 = std::chrono::steady_clock::now();
+	idx.reserve(numWords);
+	for (const std::wstring& w : words) idx.push_back(w);
+	std::printf("%-34s %9.2f ms\n", "fill 1M words", test::seconds_since(t0) * 1e3);
+	t0 = std::chrono::steady_clock::now();
+	idx.find_prefix(L"x");
+	std::printf("%-34s %9.2f ms\n", "build sorted set", test::seconds_since(t0) * 1e3);
+	t0 = std::chrono::steady_clock::now();
+	idx.find_substring(L"xyz");
+	std::printf("%-34s %9.2f ms\n", "build trigrams", test::seconds_since(t0) * 1e3);
+
+	volatile size_t sink = 0;
+	std::vector<std::wstring> typed(1000);
+	for (std::wstring& t : typed) t = random_word().substr(0, 1 + test::rand_below(5));
+	time_each("type-ahead find_prefix", typed.size(), [&](size_t i) { sink = sink + idx.find_prefix(typed[i].c_str(), i * 997 % numWords); });
+	time_each("find exact", typed.size(), [&](size_t i) { sink = sink + idx.find(words[i * 991].c_str(), false); });
+	time_each("find_substring, 4+ chars", 200, [&](size_t i) { sink = sink + idx.find_substring(words[i].substr(1, 5).c_str()).size(); });
+
+	time_each("insert in the middle", 10000, [&](size_t i) { idx.insert(test::rand_below(idx.size()), words[i]); });
+	time_each("erase in the middle", 10000, [&](size_t) { idx.erase(test::rand_below(idx.size())); });
+	time_each("insert + type-ahead, interleaved", 10000, [&](size_t i) {
+		idx.insert(test::rand_below(idx.size()), words[i]);
+		sink = sink + idx.find_prefix(typed[i % typed.size()].c_str());
+	});
+	time_each("set + find_substring, interleaved", 1000, [&](size_t i) {
+		idx.set(test::rand_below(idx.size()), words[i + 5]);
+		sink = sink + idx.find_substring(words[i].substr(0, 6).c_str()).size();
+	});
+	return 0;
+}
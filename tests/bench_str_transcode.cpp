@@ -0,0 +1,70 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+// Throughput of str_transcode in GB/s of input, over 64 MB buffers: pure ASCII,
+// ASCII text with some accented words, and text mostly outside ASCII.
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "internals/str_transcode.h"
+#include "test.h"
+
+using wl::_wli::BYTE;
+using wl::_wli::str_transcode;
+
+static std::vector<BYTE> make_text(size_t sz, int nonAsciiPercent) {
+	static const char* words[] = {"lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit"};
+	static const char* accented[] = {"a\xC3\xA7\xC3\xA3o", "cora\xC3\xA7\xC3\xA3o", "\xE2\x82\xAC", "\xE6\x97\xA5\xE6\x9C\xAC", "\xF0\x9F\x98\x80"};
+	std::vector<BYTE> out;
+	out.reserve(sz + 16);
+	while (out.size() < sz) {
+		const char* w = (static_cast<int>(test::rand_below(100)) < nonAsciiPercent) ?
+			accented[test::rand_below(5)] : words[test::rand_below(8)];
+		while (*w) out.push_back(static_cast<BYTE>(*w++));
+		out.push_back(test::rand_below(12) ? ' ' : '\n');
+	}
+	while (out.size() > sz && out.back() >= 0x80) out.pop_back(); // don't end mid-sequence
+	out.resize(std::min(out.size(), sz));
+	return out;
+}
+
+template<typename funcT>
+static void run(const char* name, size_t numBytes, funcT&& func) {
+	func(); // warm up
+	const int reps = 5;
+	auto t0 = std::chrono::steady_clock::now();
+	for (int i = 0; i < reps; ++i) func();
+	double secs = test::seconds_since(t0);
+	std::printf("%-28s %6.2f GB/s\n", name, numBytes * reps / secs / 1e9);
+}
+
+int main(int argc, char** argv) {
+	test::rng(argc, argv);
+	const size_t sz = 64 << 20;
+	std::vector<wchar_t> wide(sz);
+	std::vector<BYTE> narrow(sz * 3);
+	volatile size_t sink = 0;
+
+	for (int pct : {0, 5, 80}) {
+		std::vector<BYTE> text = make_text(sz, pct);
+		char name[64];
+		std::snprintf(name, sizeof(name), "utf8_to_utf16 %d%%", pct);
+		size_t len = 0;
+		run(name, text.size(), [&]() { len = str_transcode::utf8_to_utf16(text.data(), text.size(), wide.data()); sink = sink + len; });
+		std::snprintf(name, sizeof(name), "utf16_to_utf8 %d%%", pct);
+		run(name, len * sizeof(wchar_t), [&]() { sink = sink + str_transcode::utf16_to_utf8(wide.data(), len, narrow.data()); });
+		std::snprintf(name, sizeof(name), "win1252_to_utf16 %d%%", pct);
+		run(name, text.size(), [&]() { sink = sink + str_transcode::win1252_to_utf16(text.data(), text.size(), wide.data()); });
+	}
+
+	std::vector<BYTE> ascii = make_text(sz, 0);
+	run("latin1_to_utf16", ascii.size(), [&]() { sink = sink + str_transcode::latin1_to_utf16(ascii.data(), ascii.size(), wide.data()); });
+	run("ascii_length", ascii.size(), [&]() { sink = sink + str_transcode::ascii_length(ascii.data(), ascii.size()); });
+	run("utf16_to_utf16 big-endian", ascii.size(), [&]() { sink = sink + str_transcode::utf16_to_utf16(ascii.data(), ascii.size() / 2, true, wide.data()); });
+	return 0;
+}
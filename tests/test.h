@@ -0,0 +1,40 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+// Checks for the test programs, which have no framework: each one is a main() which
+// returns zero, and a failed check prints where it happened and aborts.
+#define CHECK(cond) \
+	do { if (!(cond)) { std::fprintf(stderr, "%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #cond); std::abort(); } } while (0)
+
+#define CHECK_EQ(a, b) \
+	do { if (!((a) == (b))) { std::fprintf(stderr, "%s(%d): CHECK_EQ(%s, %s) failed\n", __FILE__, __LINE__, #a, #b); std::abort(); } } while (0)
+
+namespace test {
+
+// Random generator with a fixed seed, so a failure can be reproduced; the seed can
+// be given as the first command line argument.
+inline std::mt19937& rng(int argc = 0, char** argv = nullptr) {
+	static std::mt19937 gen(argc > 1 ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10)) : 42u);
+	return gen;
+}
+
+inline size_t rand_below(size_t n) {
+	return n ? static_cast<size_t>(rng()() % n) : 0;
+}
+
+// Seconds elapsed since the given point, for the benchmarks.
+inline double seconds_since(std::chrono::steady_clock::time_point t0) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+}//namespace test
@@ -0,0 +1,176 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+// Tests of file_aio on the POSIX backend: random reads and writes checked against a
+// model of the file, errors, and a request whose submission fails partway, with
+// allocations made to throw one by one.
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "internals/file_aio.h"
+#include "test.h"
+
+using wl::_wli::file_aio;
+using wl::_wli::file_aio_backend;
+using wl::_wli::thread_pool;
+
+// Allocations of the current thread throw once this reaches zero; negative disarms.
+static thread_local long t_allocsToFailure = -1;
+
+void* operator new(size_t sz) {
+	if (t_allocsToFailure >= 0 && t_allocsToFailure-- == 0) throw std::bad_alloc();
+	if (void* p = std::malloc(sz ? sz : 1)) return p;
+	throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+static int open_temp(std::string& path) {
+	path = "winlamb_test_file_aio_XXXXXX";
+	int fd = mkstemp(&path[0]);
+	CHECK(fd >= 0);
+	return fd;
+}
+
+static void test_random_requests() {
+	std::string path;
+	int fd = open_temp(path);
+	std::vector<unsigned char> model; // what the file must contain
+
+	for (int round = 0; round < 20; ++round) {
+		file_aio aio(fd);
+		std::atomic<size_t> numDone{0}, numErrors{0};
+		std::vector<std::vector<unsigned char>> bufs;
+		size_t numReqs = 1 + test::rand_below(40);
+
+		// Writes never overlap each other, since their order is not defined.
+		size_t off = test::rand_below(model.size() + 1000);
+		for (size_t r = 0; r < numReqs; ++r) {
+			size_t sz = test::rand_below(8) ? test::rand_below(100000) : file_aio::CHUNK * 2 + test::rand_below(100000);
+			bufs.emplace_back(sz);
+			for (unsigned char& b : bufs.back()) b = static_cast<unsigned char>(test::rand_below(256));
+			aio.write(off, bufs.back().data(), sz, [&numDone, &numErrors, sz](file_aio::result res) -> void {
+				if (res.error || res.transferred != sz) ++numErrors;
+				++numDone;
+			});
+			if (model.size() < off + sz) model.resize(off + sz, 0); // a hole reads as zeros
+			std::memcpy(model.data() + off, bufs.back().data(), sz);
+			off += sz + test::rand_below(3) * test::rand_below(5000);
+		}
+		aio.wait();
+		CHECK_EQ(aio.in_flight(), 0u);
+		CHECK_EQ(numDone.load(), numReqs);
+		CHECK_EQ(numErrors.load(), 0u);
+
+		// Reads may overlap, and go past the end of the file.
+		std::vector<std::vector<unsigned char>> dests(numReqs);
+		std::vector<size_t> offs(numReqs), gots(numReqs, static_cast<size_t>(-1));
+		for (size_t r = 0; r < numReqs; ++r) {
+			offs[r] = test::rand_below(model.size() + 10);
+			dests[r].resize(test::rand_below(4) ? test::rand_below(200000) : file_aio::CHUNK * 3);
+			aio.read(offs[r], dests[r].data(), dests[r].size(), [&gots, r](file_aio::result res) -> void {
+				CHECK(!res.error);
+				gots[r] = res.transferred;
+			});
+		}
+		aio.wait();
+		for (size_t r = 0; r < numReqs; ++r) {
+			size_t expected = std::min(dests[r].size(), model.size() - std::min(offs[r], model.size()));
+			CHECK_EQ(gots[r], expected);
+			CHECK(std::memcmp(dests[r].data(), model.data() + offs[r], expected) == 0);
+		}
+	}
+
+	std::vector<unsigned char> whole(model.size() + 1);
+	size_t done = 0;
+	CHECK(!file_aio_backend::read_at(fd, 0, whole.data(), whole.size(), done));
+	CHECK_EQ(done, model.size());
+	CHECK(std::memcmp(whole.data(), model.data(), done) == 0);
+	close(fd);
+	unlink(path.c_str());
+}
+
+static void test_errors() {
+	file_aio bad(-1);
+	std::atomic<int> numCalls{0};
+	unsigned char buf[16];
+	bad.read(0, buf, sizeof(buf), [&numCalls](file_aio::result res) -> void {
+		CHECK(res.error == std::error_code(EBADF, std::system_category()));
+		CHECK_EQ(res.transferred, 0u);
+		++numCalls;
+	});
+	bad.write(0, buf, file_aio::CHUNK * 2, [&numCalls](file_aio::result res) -> void {
+		CHECK(res.error);
+		++numCalls;
+	});
+	bad.read(0, buf, 0, [&numCalls](file_aio::result res) -> void { // zero-length still completes
+		CHECK(!res.error);
+		++numCalls;
+	});
+	bad.read(0, buf, sizeof(buf), nullptr);
+	bad.wait();
+	CHECK_EQ(numCalls.load(), 3);
+
+	{
+		file_aio aio(-1);
+		aio.read(0, buf, sizeof(buf), [&numCalls](file_aio::result) -> void { ++numCalls; });
+	} // destructor waits
+	CHECK_EQ(numCalls.load(), 4);
+}
+
+static void test_failed_submission() {
+	std::string path;
+	int fd = open_temp(path); // empty, so the chunks read nothing
+	std::vector<unsigned char> buf(file_aio::CHUNK * 10);
+	file_aio aio(fd);
+	aio.read(0, buf.data(), 1, nullptr); // starts the pool threads
+
+	bool failedSome = true;
+	for (long k = 0; failedSome; ++k) { // the k-th allocation of the request throws
+		std::atomic<int> numCalls{0};
+		std::error_code err;
+		bool thrown = false;
+		t_allocsToFailure = k;
+		try {
+			aio.read(0, buf.data(), buf.size(), [&numCalls, &err](file_aio::result res) -> void {
+				err = res.error;
+				++numCalls;
+			});
+		} catch (const std::bad_alloc&) {
+			thrown = true;
+		}
+		failedSome = t_allocsToFailure < 0;
+		t_allocsToFailure = -1;
+
+		aio.wait(); // would hang if the request was left counted
+		CHECK_EQ(aio.in_flight(), 0u);
+		if (thrown) {
+			CHECK_EQ(numCalls.load(), 0); // never existed
+		} else {
+			CHECK_EQ(numCalls.load(), 1);
+			CHECK_EQ(static_cast<bool>(err), failedSome); // queued chunks report the failure
+		}
+	}
+	close(fd);
+	unlink(path.c_str());
+}
+
+int main(int argc, char** argv) {
+	test::rng(argc, argv);
+	test_random_requests();
+	test_errors();
+	test_failed_submission();
+	thread_pool::instance().shutdown(); // would hang if a failed submit was left pending
+	std::puts("file_aio: OK");
+	return 0;
+}
@@ -0,0 +1,196 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+// Durability harness of the atomic writes, on the POSIX backend: a child process
+// saves new versions of a file in a loop and is killed at random moments, and the
+// file must always hold one complete version, never older than the last one seen.
+// Then the write-behind queue: coalescing, errors, and the writes done at exit.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <csignal>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "internals/file_write_behind.h"
+#include "test.h"
+
+using wl::_wli::BYTE;
+using wl::_wli::file_atomic_backend;
+using wl::_wli::file_write_behind;
+using durability = file_atomic_backend::durability;
+
+static std::string g_dir; // scratch directory, removed at the end
+
+static std::string path_of(const char* name) { return g_dir + "/" + name; }
+static std::wstring wpath_of(const char* name) { std::string p = path_of(name); return {p.begin(), p.end()}; }
+
+// A version is its number, then a size which varies with it, filled with a pattern
+// which depends on both, so a torn or mixed file can't pass for any version.
+static std::vector<BYTE> version(uint32_t ver) {
+	std::vector<BYTE> data(8 + (ver * 7919) % 70000);
+	uint32_t sz = static_cast<uint32_t>(data.size());
+	std::memcpy(&data[0], &ver, 4);
+	std::memcpy(&data[4], &sz, 4);
+	for (size_t i = 8; i < data.size(); ++i) data[i] = static_cast<BYTE>(ver * 31 + i);
+	return data;
+}
+
+static std::vector<BYTE> read_file(const std::string& path) {
+	std::vector<BYTE> data;
+	int fd = open(path.c_str(), O_RDONLY);
+	CHECK(fd >= 0);
+	BYTE buf[65536];
+	for (ssize_t n; (n = read(fd, buf, sizeof(buf))) > 0; ) data.insert(data.end(), buf, buf + n);
+	close(fd);
+	return data;
+}
+
+static uint32_t check_version(const std::string& path) {
+	std::vector<BYTE> data = read_file(path);
+	CHECK(data.size() >= 8);
+	uint32_t ver = 0;
+	std::memcpy(&ver, &data[0], 4);
+	CHECK(data == version(ver));
+	return ver;
+}
+
+static size_t count_temp_files() {
+	size_t n = 0;
+	DIR* pDir = opendir(g_dir.c_str());
+	while (dirent* pEnt = readdir(pDir)) n += std::strstr(pEnt->d_name, ".tmp") != nullptr;
+	closedir(pDir);
+	return n;
+}
+
+static void test_killed_writer(bool writeBehind) {
+	const char* name = writeBehind ? "behind.dat" : "atomic.dat";
+	std::vector<BYTE> v0 = version(0);
+	CHECK(!file_atomic_backend::write(wpath_of(name), v0.data(), v0.size(), durability::NONE));
+
+	uint32_t lastSeen = 0;
+	for (int round = 0; round < 150; ++round) {
+		pid_t pid = fork();
+		CHECK(pid >= 0);
+		if (!pid) { // child: saves newer versions until killed
+			durability dur = static_cast<durability>(round % 3);
+			file_write_behind::instance().set_delay(std::chrono::milliseconds(1)); // so it writes before the kill
+			for (uint32_t ver = lastSeen + 1; ; ++ver) {
+				std::vector<BYTE> data = version(ver);
+				if (writeBehind) {
+					file_write_behind::instance().write(wpath_of(name), std::move(data), dur);
+				} else if (file_atomic_backend::write(wpath_of(name), data.data(), data.size(), dur)) {
+					_exit(1);
+				}
+			}
+		}
+		usleep(static_cast<useconds_t>(200 + test::rand_below(20000)));
+		kill(pid, SIGKILL);
+		int status = 0;
+		waitpid(pid, &status, 0);
+		CHECK(WIFSIGNALED(status)); // didn't fail by itself
+
+		uint32_t ver = check_version(path_of(name)); // a whole version, old or new
+		CHECK(ver >= lastSeen);
+		lastSeen = ver;
+	}
+	CHECK(lastSeen > 0);
+	std::printf("killed %s writer 150 times, last version %u, %zu temp files left\n",
+		writeBehind ? "write-behind" : "atomic", lastSeen, count_temp_files());
+}
+
+static void test_queued_at_exit() {
+	std::fflush(stdout); // or the child's exit() prints it again
+	pid_t pid = fork(); // before this process starts the queue thread, which fork() wouldn't copy
+	CHECK(pid >= 0);
+	if (!pid) {
+		file_write_behind& q = file_write_behind::instance();
+		q.set_delay(std::chrono::milliseconds(10000)); // still waiting when exit() is called
+		for (uint32_t ver = 1; ver <= 100; ++ver) q.write(wpath_of("exit.dat"), version(ver), durability::NONE);
+		std::exit(0); // static destructors write the queue
+	}
+	int status = 0;
+	waitpid(pid, &status, 0);
+	CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	CHECK_EQ(check_version(path_of("exit.dat")), 100u);
+}
+
+static void test_atomic_write() {
+	std::string path = path_of("mode.dat");
+	std::vector<BYTE> v1 = version(1), v2 = version(2);
+	CHECK(!file_atomic_backend::write(wpath_of("mode.dat"), v1.data(), v1.size(), durability::FULL));
+	CHECK(chmod(path.c_str(), 0640) == 0);
+	CHECK(!file_atomic_backend::write(wpath_of("mode.dat"), v2.data(), v2.size(), durability::DATA));
+	struct stat st{};
+	CHECK(stat(path.c_str(), &st) == 0);
+	CHECK_EQ(st.st_mode & 07777, 0640u); // kept
+	CHECK_EQ(check_version(path), 2u);
+
+	CHECK(!file_atomic_backend::write(wpath_of("empty.dat"), nullptr, 0, durability::NONE));
+	CHECK(read_file(path_of("empty.dat")).empty());
+
+	size_t numTemp = count_temp_files();
+	std::error_code err = file_atomic_backend::write(wpath_of("none/x.dat"), v1.data(), v1.size(), durability::NONE);
+	CHECK(err == std::error_code(ENOENT, std::system_category()));
+	CHECK_EQ(count_temp_files(), numTemp);
+}
+
+static void test_write_behind() {
+	file_write_behind& q = file_write_behind::instance();
+	q.set_delay(std::chrono::milliseconds(20));
+	for (uint32_t ver = 1; ver <= 2000; ++ver) {
+		q.write(wpath_of("queue.dat"), version(ver), durability::NONE);
+		if (ver % 500 == 0) q.write(wpath_of("other.dat"), version(ver), durability::DATA);
+	}
+	CHECK(q.num_pending() <= 2); // coalesced
+	q.flush();
+	CHECK_EQ(q.num_pending(), 0u);
+	CHECK_EQ(check_version(path_of("queue.dat")), 2000u);
+	CHECK_EQ(check_version(path_of("other.dat")), 2000u);
+
+	q.write(wpath_of("none/x.dat"), version(1), durability::NONE);
+	bool thrown = false;
+	try {
+		q.flush();
+	} catch (const std::system_error& e) {
+		thrown = e.code() == std::error_code(ENOENT, std::system_category());
+	}
+	CHECK(thrown);
+	q.flush(); // the error was reported once
+	q.shutdown();
+}
+
+static void remove_dir() {
+	DIR* pDir = opendir(g_dir.c_str());
+	while (dirent* pEnt = readdir(pDir)) {
+		if (std::strcmp(pEnt->d_name, ".") && std::strcmp(pEnt->d_name, "..")) unlink(path_of(pEnt->d_name).c_str());
+	}
+	closedir(pDir);
+	rmdir(g_dir.c_str());
+}
+
+int main(int argc, char** argv) {
+	test::rng(argc, argv);
+	char dirName[] = "winlamb_test_file_atomic_XXXXXX";
+	CHECK(mkdtemp(dirName));
+	g_dir = dirName;
+
+	test_killed_writer(false);
+	test_killed_writer(true);
+	test_queued_at_exit();
+	test_atomic_write();
+	test_write_behind();
+
+	remove_dir();
+	std::puts("file_atomic: OK");
+	return 0;
+}
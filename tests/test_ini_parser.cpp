@@ -0,0 +1,216 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+// Fuzz test of ini_document against the line-by-line parser file_ini used before,
+// rewritten here: random documents in several encodings, loaded into empty and into
+// populated maps. The old parser split lines at the first kind of linebreak it found,
+// so each document uses one kind; mixed ones are split at each, by design.
+
+#include <cwctype>
+#include <string>
+#include <vector>
+#include "internals/ini_parser.h"
+#include "test.h"
+
+using wl::_wli::BYTE;
+using wl::_wli::ini_document;
+using wl::_wli::str_transcode;
+
+// The part of insert_order_map used by merge_into(); that one only builds with MSVC.
+template<typename valueT>
+class ordered_map final {
+public:
+	struct entry final {
+		std::wstring key;
+		valueT       value;
+	};
+
+private:
+	std::vector<entry> _entries;
+
+public:
+	bool   empty() const noexcept { return this->_entries.empty(); }
+	size_t size() const noexcept  { return this->_entries.size(); }
+	void   reserve(size_t n)      { this->_entries.reserve(n); }
+	typename std::vector<entry>::iterator       begin()       { return this->_entries.begin(); }
+	typename std::vector<entry>::iterator       end()         { return this->_entries.end(); }
+	typename std::vector<entry>::const_iterator begin() const { return this->_entries.begin(); }
+	typename std::vector<entry>::const_iterator end() const   { return this->_entries.end(); }
+
+	valueT& append_unique(std::wstring key) {
+		this->_entries.push_back({std::move(key), {}});
+		return this->_entries.back().value;
+	}
+
+	valueT& operator[](const std::wstring& key) { // linear, like insert_order_map
+		for (entry& e : this->_entries) {
+			if (e.key == key) return e.value;
+		}
+		return this->append_unique(key);
+	}
+
+	bool operator==(const ordered_map& other) const {
+		if (this->_entries.size() != other._entries.size()) return false;
+		for (size_t i = 0; i < this->_entries.size(); ++i) {
+			if (this->_entries[i].key != other._entries[i].key || !(this->_entries[i].value == other._entries[i].value)) return false;
+		}
+		return true;
+	}
+};
+
+using keys_map = ordered_map<std::wstring>;
+using sections_map = ordered_map<keys_map>;
+
+static std::wstring trim(std::wstring s) { // str::trim()
+	size_t iFirst = 0, iPastLast = s.length();
+	while (iFirst < iPastLast && std::iswspace(s[iFirst])) ++iFirst;
+	while (iPastLast > iFirst && std::iswspace(s[iPastLast - 1])) --iPastLast;
+	return s.substr(iFirst, iPastLast - iFirst);
+}
+
+static std::vector<std::wstring> split_lines(const std::wstring& s) { // str::split_lines()
+	std::vector<std::wstring> lines;
+	if (s.empty()) return lines;
+	std::wstring delimiter;
+	for (size_t i = 0; i + 1 < s.length() && delimiter.empty(); ++i) { // str::get_linebreak()
+		if (s[i] == L'\r') delimiter = s[i + 1] == L'\n' ? L"\r\n" : L"\r";
+		else if (s[i] == L'\n') delimiter = s[i + 1] == L'\r' ? L"\n\r" : L"\n";
+	}
+	if (delimiter.empty()) return {s};
+	size_t base = 0;
+	for (size_t head; (head = s.find(delimiter, base)) != std::wstring::npos; base = head + delimiter.length()) {
+		lines.push_back(s.substr(base, head - base));
+	}
+	lines.push_back(s.substr(base));
+	return lines;
+}
+
+static void old_load(const std::wstring& content, sections_map& sections) { // file_ini::load_from_file()
+	keys_map* curSection = nullptr; // section-less keys will be ignored
+	for (std::wstring line : split_lines(content)) {
+		line = trim(line);
+		if (line.empty()) { // skip blank lines
+			continue;
+		} else if (line[0] == L'[' && line.back() == L']') { // begin of section found
+			curSection = &sections[trim(line.substr(1, line.length() - 2))];
+		} else if (curSection && line[0] != L';' && line[0] != L'#') {
+			size_t idxEq = line.find_first_of(L'=');
+			if (idxEq != std::wstring::npos) {
+				(*curSection)[line.substr(0, idxEq)] = line.substr(idxEq + 1);
+			}
+		}
+	}
+}
+
+static std::wstring random_text() {
+	static const wchar_t* tokens[] = {L"[", L"]", L"=", L";", L"#", L" ", L"\t", L"\v", L"\f",
+		L"a", L"b", L"key", L"sec", L"é", L"€", L" ", L"　", L"[a]", L"[ b ]", L"k=v"};
+	static const wchar_t* breaks[] = {L"\r\n", L"\n", L"\r", L"\n\r"};
+	const wchar_t* br = breaks[test::rand_below(4)];
+	std::wstring text;
+	for (size_t n = test::rand_below(60); n > 0; --n) {
+		text.append(test::rand_below(5) ? tokens[test::rand_below(20)] : br);
+	}
+	return text;
+}
+
+static std::vector<BYTE> encode(const std::wstring& text, bool& isAscii) {
+	isAscii = true;
+	for (wchar_t ch : text) isAscii &= ch < 0x80;
+	std::vector<BYTE> bytes;
+	switch (test::rand_below(isAscii ? 4 : 3)) {
+	case 0: // UTF-8 with BOM
+		bytes = {0xEF, 0xBB, 0xBF};
+		bytes.resize(3 + str_transcode::utf8_length(text.data(), text.length()));
+		str_transcode::utf16_to_utf8(text.data(), text.length(), bytes.data() + 3);
+		break;
+	case 1:
+	case 2: { // UTF-16 with BOM
+		bool bigEndian = test::rand_below(2) == 0;
+		bytes = bigEndian ? std::vector<BYTE>{0xFE, 0xFF} : std::vector<BYTE>{0xFF, 0xFE};
+		for (wchar_t ch : text) {
+			BYTE lo = static_cast<BYTE>(ch), hi = static_cast<BYTE>(ch >> 8);
+			bytes.push_back(bigEndian ? hi : lo);
+			bytes.push_back(bigEndian ? lo : hi);
+		}
+		break;
+	}
+	default: // plain ASCII
+		bytes.assign(text.begin(), text.end());
+	}
+	return bytes;
+}
+
+static void test_against_old_parser() {
+	for (int i = 0; i < 100000; ++i) {
+		sections_map expected, got;
+		bool isMerge = test::rand_below(3) == 0;
+		if (isMerge) { // loading into a populated object
+			std::wstring previous = random_text();
+			old_load(previous, expected);
+			old_load(previous, got);
+		}
+
+		std::wstring text = random_text();
+		bool isAscii = false;
+		std::vector<BYTE> bytes = encode(text, isAscii);
+		old_load(text, expected);
+
+		ini_document doc;
+		doc.parse(bytes.data(), bytes.size());
+		doc.merge_into(got);
+		CHECK(got == expected);
+
+		if (isMerge) continue;
+		CHECK_EQ(doc.num_sections(), expected.size());
+		for (const sections_map::entry& sec : expected) { // the hashed lookups agree too
+			CHECK(doc.has(sec.key));
+			for (const keys_map::entry& key : sec.value) {
+				const wchar_t* value = doc.get_if_exists(sec.key, key.key);
+				CHECK(value && key.value == value);
+			}
+		}
+	}
+}
+
+static void test_document() {
+	const char* text = "x=1\n[s]\nk=v\nnokey\n[open\n;c\n[t]\n k = spaced \n[s]\nk=w\n";
+	ini_document doc;
+	doc.parse(reinterpret_cast<const BYTE*>(text), std::char_traits<char>::length(text));
+	CHECK_EQ(doc.num_sections(), 2u);
+	CHECK_EQ(doc.num_keys(), 2u);
+	CHECK(std::wstring{doc.get_if_exists(L"s", L"k")} == L"w"); // last value
+	CHECK(std::wstring{doc.get_if_exists(L"t", L"k ")} == L" spaced"); // only the line is trimmed
+	CHECK(!doc.get_if_exists(L"s", L"x"));
+	CHECK(!doc.has(L"open"));
+
+	CHECK_EQ(doc.issues().size(), 3u);
+	CHECK_EQ(doc.issues()[0].line, 1u); // not within a section
+	CHECK_EQ(doc.issues()[1].line, 4u); // no value
+	CHECK_EQ(doc.issues()[2].line, 5u); // section not closed
+
+	doc.set(L"s", L"k", L"z").set(L"new", L"a", L"b");
+	CHECK(doc.serialize() == L"[s]\r\nk=z\r\n\r\n[t]\r\nk = spaced\r\n\r\n[new]\r\na=b\r\n");
+
+	sections_map sections; // merging keeps the order of what's there
+	sections[L"t"][L"first"] = L"1";
+	sections[L"t"][L"k "] = L"old";
+	doc.merge_into(sections);
+	CHECK_EQ(sections.size(), 3u);
+	CHECK(sections.begin()->key == L"t");
+	CHECK(sections[L"t"].begin()->key == L"first");
+	CHECK(sections[L"t"][L"k "] == L" spaced");
+	CHECK(sections[L"new"][L"a"] == L"b");
+}
+
+int main(int argc, char** argv) {
+	test::rng(argc, argv);
+	test_document();
+	test_against_old_parser();
+	std::puts("ini_parser: OK");
+	return 0;
+}
@@ -0,0 +1,228 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+// Tests of the log layout used by file_log, with crashes simulated on a memory image:
+// the log cut at every byte, every byte corrupted, and a power loss after a record was
+// appended over discarded ones. Also the CRC-32C against a bitwise reference.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "internals/log_format.h"
+#include "test.h"
+
+using wl::_wli::BYTE;
+using wl::_wli::crc32c;
+using wl::_wli::log_format;
+
+using record = std::vector<BYTE>;
+
+static uint32_t crc32c_bitwise(const BYTE* p, size_t sz) {
+	uint32_t crc = 0xFFFF'FFFF;
+	for (size_t i = 0; i < sz; ++i) {
+		crc ^= p[i];
+		for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ (0x82F6'3B78 & (0u - (crc & 1)));
+	}
+	return ~crc;
+}
+
+static void test_crc32c() {
+	CHECK_EQ(crc32c::of("123456789", 9), 0xE306'9283u);
+	CHECK_EQ(crc32c::of("", 0), 0u);
+	BYTE zeros[32] = {}, ones[32];
+	std::memset(ones, 0xFF, sizeof(ones));
+	CHECK_EQ(crc32c::of(zeros, 32), 0x8A91'36AAu); // RFC 3720, B.4
+	CHECK_EQ(crc32c::of(ones, 32), 0x62A8'AB43u);
+
+	std::vector<BYTE> data(5000);
+	for (BYTE& b : data) b = static_cast<BYTE>(test::rand_below(256));
+	for (int i = 0; i < 2000; ++i) {
+		size_t off = test::rand_below(16), sz = test::rand_below(data.size() - off);
+		size_t split = test::rand_below(sz + 1);
+		uint32_t expected = crc32c_bitwise(&data[off], sz);
+		CHECK_EQ(crc32c::of(&data[off], sz), expected);
+		CHECK_EQ(crc32c::update(crc32c::of(&data[off], split), &data[off + split], sz - split), expected);
+	}
+}
+
+static record random_record() {
+	record rec(test::rand_below(8) ? test::rand_below(40) : test::rand_below(3000));
+	for (BYTE& b : rec) b = static_cast<BYTE>(test::rand_below(256));
+	return rec;
+}
+
+// Appends the records after end, as file_log does, returning the new end.
+static uint64_t append(std::vector<BYTE>& img, uint64_t end, const std::vector<record>& recs) {
+	for (const record& rec : recs) {
+		uint64_t sz = log_format::record_size(rec.size());
+		if (img.size() < end + sz) img.resize(static_cast<size_t>(end + sz) + test::rand_below(200), 0);
+		log_format::write_record(&img[static_cast<size_t>(end)], rec.data(), rec.size());
+		end += sz;
+	}
+	return end;
+}
+
+static std::vector<BYTE> new_log(const std::vector<record>& recs, uint64_t& end) {
+	std::vector<BYTE> img(log_format::HEADER_SIZE, 0);
+	CHECK(log_format::is_blank(img.data()));
+	log_format::write_header(img.data());
+	CHECK(log_format::has_header(img.data()));
+	end = append(img, log_format::HEADER_SIZE, recs);
+	return img;
+}
+
+// Recovers the image, like file_log::open(), checking the records which survived.
+static uint64_t check_recover(std::vector<BYTE>& img, const std::vector<record>& expected) {
+	size_t numRecords = 0;
+	uint64_t zeroedEnd = 0;
+	uint64_t end = log_format::recover(img.data(), img.size(), numRecords, zeroedEnd);
+	CHECK_EQ(numRecords, expected.size());
+	CHECK(zeroedEnd >= end && zeroedEnd <= img.size());
+	for (size_t i = static_cast<size_t>(end); i < img.size(); ++i) CHECK_EQ(img[i], 0);
+
+	uint64_t offset = log_format::HEADER_SIZE, next = 0;
+	const BYTE* pPayload = nullptr;
+	size_t payloadSz = 0;
+	for (const record& rec : expected) {
+		CHECK(log_format::read_record(img.data(), end, offset, pPayload, payloadSz, next));
+		CHECK(record(pPayload, pPayload + payloadSz) == rec);
+		offset = next;
+	}
+	CHECK_EQ(offset, end);
+	CHECK(!log_format::read_record(img.data(), img.size(), end, pPayload, payloadSz, next));
+	return end;
+}
+
+static void test_torn_tail() {
+	std::vector<record> recs;
+	for (int i = 0; i < 30; ++i) recs.push_back(random_record());
+	recs.push_back({}); // a zero-length record must not be taken as the end
+	recs.push_back(random_record());
+	uint64_t end = 0;
+	std::vector<BYTE> img = new_log(recs, end);
+
+	std::vector<uint64_t> ends{log_format::HEADER_SIZE};
+	for (const record& rec : recs) ends.push_back(ends.back() + log_format::record_size(rec.size()));
+
+	for (uint64_t cut = log_format::HEADER_SIZE; cut <= end; ++cut) {
+		for (bool garbage : {false, true}) { // after the cut, pages never written, or a torn sector
+			std::vector<BYTE> crashed = img;
+			for (size_t i = static_cast<size_t>(cut); i < crashed.size(); ++i) {
+				crashed[i] = garbage ? static_cast<BYTE>(test::rand_below(256)) : 0;
+			}
+			size_t numIntact = 0; // a cut in zero padding, say, leaves the record whole
+			while (numIntact < recs.size() && std::equal(img.begin() + static_cast<size_t>(ends[numIntact]),
+				img.begin() + static_cast<size_t>(ends[numIntact + 1]), crashed.begin() + static_cast<size_t>(ends[numIntact]))) ++numIntact;
+			std::vector<record> survivors(recs.begin(), recs.begin() + numIntact);
+			CHECK_EQ(check_recover(crashed, survivors), ends[numIntact]);
+		}
+	}
+}
+
+static void test_corruption() {
+	std::vector<record> recs;
+	for (int i = 0; i < 12; ++i) recs.push_back(random_record());
+	uint64_t end = 0;
+	std::vector<BYTE> img = new_log(recs, end);
+
+	size_t numBefore = 0;
+	uint64_t recEnd = log_format::HEADER_SIZE + log_format::record_size(recs[0].size());
+	for (uint64_t pos = log_format::HEADER_SIZE; pos < end; ++pos) {
+		while (pos >= recEnd) recEnd += log_format::record_size(recs[++numBefore].size());
+		std::vector<BYTE> corrupted = img;
+		corrupted[static_cast<size_t>(pos)] ^= static_cast<BYTE>(1 << test::rand_below(8));
+		check_recover(corrupted, std::vector<record>(recs.begin(), recs.begin() + numBefore));
+	}
+}
+
+static void test_stale_record_after_power_loss() {
+	// R2 was torn by a crash, so reopening discards R2 and R3, and R4, the same size
+	// as R2, is appended in its place. If the zeroing isn't flushed, a power loss
+	// leaves R1, R4 and the stale R3 on the disk.
+	record r1 = random_record(), r2(100, 2), r3 = random_record(), r4(100, 4);
+	uint64_t end = 0;
+	std::vector<BYTE> disk = new_log({r1, r2, r3}, end);
+	uint64_t r2Offset = log_format::HEADER_SIZE + log_format::record_size(r1.size());
+	disk[static_cast<size_t>(r2Offset + 50)] ^= 0xFF;
+
+	for (bool flushZeroed : {true, false}) {
+		std::vector<BYTE> disk2 = disk, mem = disk; // the mapped file, and what reached the disk
+		size_t numRecords = 0;
+		uint64_t zeroedEnd = 0;
+		uint64_t end2 = log_format::recover(mem.data(), mem.size(), numRecords, zeroedEnd);
+		CHECK_EQ(numRecords, 1u);
+		CHECK_EQ(end2, r2Offset);
+		CHECK(zeroedEnd > end2 + log_format::record_size(r2.size()) && zeroedEnd <= end); // up to R3's last nonzero byte
+		if (flushZeroed) { // what file_log::open() does
+			std::memcpy(&disk2[static_cast<size_t>(end2)], &mem[static_cast<size_t>(end2)], static_cast<size_t>(zeroedEnd - end2));
+		}
+
+		uint64_t end3 = append(mem, end2, {r4});
+		std::memcpy(&disk2[static_cast<size_t>(end2)], &mem[static_cast<size_t>(end2)], static_cast<size_t>(end3 - end2)); // commit()
+
+		if (flushZeroed) {
+			check_recover(disk2, {r1, r4});
+		} else {
+			check_recover(disk2, {r1, r4, r3}); // the bug this guards against
+		}
+	}
+}
+
+static void test_random_crashes() {
+	for (int round = 0; round < 300; ++round) {
+		std::vector<record> survivors;
+		std::vector<BYTE> disk(log_format::HEADER_SIZE, 0);
+		log_format::write_header(disk.data());
+
+		for (int reopen = 0; reopen < 5; ++reopen) {
+			size_t numRecords = 0;
+			uint64_t zeroedEnd = 0;
+			uint64_t end = log_format::recover(disk.data(), disk.size(), numRecords, zeroedEnd);
+			CHECK_EQ(numRecords, survivors.size());
+
+			std::vector<record> recs;
+			for (size_t i = test::rand_below(10); i > 0; --i) recs.push_back(random_record());
+			std::vector<BYTE> mem = disk;
+			uint64_t newEnd = append(mem, end, recs);
+
+			// Crash: the committed records reached the disk, then a random part of
+			// the last one, in pages written back out of order.
+			size_t numCommitted = recs.empty() ? 0 : test::rand_below(recs.size());
+			uint64_t committedEnd = end;
+			for (size_t i = 0; i < numCommitted; ++i) committedEnd += log_format::record_size(recs[i].size());
+			if (disk.size() < mem.size()) disk.resize(mem.size(), 0);
+			std::memcpy(&disk[static_cast<size_t>(end)], &mem[static_cast<size_t>(end)], static_cast<size_t>(committedEnd - end));
+			for (uint64_t i = committedEnd; i < newEnd; ++i) {
+				if (test::rand_below(4)) disk[static_cast<size_t>(i)] = mem[static_cast<size_t>(i)];
+			}
+			survivors.insert(survivors.end(), recs.begin(), recs.begin() + numCommitted);
+			for (size_t i = numCommitted; i < recs.size(); ++i) { // uncommitted ones may have been written whole
+				size_t sz = static_cast<size_t>(log_format::record_size(recs[i].size()));
+				if (std::memcmp(&disk[static_cast<size_t>(committedEnd)], &mem[static_cast<size_t>(committedEnd)], sz)) break;
+				survivors.push_back(recs[i]);
+				committedEnd += sz;
+			}
+
+			std::vector<BYTE> img = disk;
+			uint64_t recoveredEnd = check_recover(img, survivors);
+			std::memcpy(&disk[static_cast<size_t>(recoveredEnd)], &img[static_cast<size_t>(recoveredEnd)], // flushed at open
+				disk.size() - static_cast<size_t>(recoveredEnd));
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	test::rng(argc, argv);
+	test_crc32c();
+	test_torn_tail();
+	test_corruption();
+	test_stale_record_after_power_loss();
+	test_random_crashes();
+	std::puts("log_format: OK");
+	return 0;
+}
@@ -0,0 +1,151 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+// Unit tests of search_index, then random insertions, changes and removals mixed
+// with queries, every result checked against a plain vector scanned linearly.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "internals/search_index.h"
+#include "test.h"
+
+using wl::_wli::search_index;
+static const size_t npos = search_index::npos;
+
+static void test_basics() {
+	search_index idx;
+	CHECK_EQ(idx.find_prefix(L"a"), npos);
+	CHECK(idx.find_substring(L"abc").empty());
+
+	idx.push_back(L"Maçã").push_back(L"banana").push_back(L"MAC").push_back(L"Apple").push_back(L"mac");
+	CHECK(search_index::fold(L"AÇÃO É") == L"acao e");
+	CHECK_EQ(idx.size(), 5u);
+	CHECK_EQ(idx.find_prefix(L"mac"), 0u); // diacritics and case ignored
+	CHECK_EQ(idx.find_prefix(L"mac", 1), 2u);
+	CHECK_EQ(idx.find_prefix(L"mac", 5), 0u); // wrapped
+	CHECK_EQ(idx.find_prefix(L"mac", 5, false), npos);
+	CHECK_EQ(idx.find(L"mac", false), 2u); // exact
+	CHECK_EQ(idx.find(L"mac", false, 3), 4u);
+	CHECK_EQ(idx.find(L"ma", false), npos);
+	CHECK(idx.find_all_prefix(L"M") == (std::vector<size_t>{0, 2, 4}));
+	CHECK(idx.find_substring(L"ANA") == (std::vector<size_t>{1}));
+	CHECK(idx.find_substring(L"a") == (std::vector<size_t>{0, 1, 2, 3, 4}));
+
+	idx.insert(0, L"Banco").erase(3); // positions shift both ways
+	CHECK_EQ(idx.find_prefix(L"ban"), 0u);
+	CHECK_EQ(idx.find_prefix(L"ban", 1), 2u);
+	CHECK_EQ(idx.find(L"mac", false), 4u);
+	CHECK(idx.find_substring(L"anc") == (std::vector<size_t>{0}));
+
+	idx.set(0, L"pear");
+	CHECK(idx.find_substring(L"anc").empty());
+	CHECK_EQ(idx.find_prefix(L"PE"), 0u);
+
+	idx.clear();
+	CHECK_EQ(idx.size(), 0u);
+	CHECK_EQ(idx.find_prefix(L"p"), npos);
+	idx.push_back(L"again");
+	CHECK_EQ(idx.find_prefix(L"AG"), 0u);
+}
+
+static std::wstring random_word() {
+	static const wchar_t letters[] = L"abcdeABCDEáÉ";
+	std::wstring w(1 + test::rand_below(7), L' ');
+	for (wchar_t& ch : w) ch = letters[test::rand_below(12)];
+	return w;
+}
+
+static void check_queries(const search_index& idx, const std::vector<std::wstring>& model) {
+	std::wstring q = random_word();
+	q.resize(1 + test::rand_below(std::min<size_t>(q.length(), 4)));
+	std::wstring fq = search_index::fold(q);
+	size_t start = test::rand_below(model.size() + 2);
+	bool wrap = test::rand_below(2) == 0;
+
+	for (bool partial : {true, false}) {
+		size_t expected = npos;
+		for (size_t pass = 0; pass < 2 && expected == npos; ++pass) {
+			size_t from = pass ? 0 : start, to = pass ? std::min(start, model.size()) : model.size();
+			if (pass && !wrap) break;
+			for (size_t i = from; i < to; ++i) {
+				bool match = partial ? model[i].compare(0, fq.length(), fq) == 0 : model[i] == fq;
+				if (match) { expected = i; break; }
+			}
+		}
+		CHECK_EQ(idx.find(q.c_str(), partial, start, wrap), expected);
+	}
+
+	std::vector<size_t> prefixed, contained;
+	for (size_t i = 0; i < model.size(); ++i) {
+		if (model[i].compare(0, fq.length(), fq) == 0) prefixed.push_back(i);
+		if (model[i].find(fq) != std::wstring::npos) contained.push_back(i);
+	}
+	CHECK(idx.find_all_prefix(q.c_str()) == prefixed);
+	CHECK(idx.find_substring(q.c_str()) == contained);
+}
+
+static void test_random_operations() {
+	for (int round = 0; round < 40; ++round) {
+		search_index idx;
+		std::vector<std::wstring> model; // folded strings, by position
+		size_t numOps = 100 + test::rand_below(3000);
+		for (size_t op = 0; op < numOps; ++op) {
+			size_t what = test::rand_below(20);
+			if (what < 8 || model.empty()) { // insert, often in the middle, like sorted controls do
+				std::wstring w = random_word();
+				size_t pos = test::rand_below(3) ? test::rand_below(model.size() + 1) : model.size();
+				idx.insert(pos, w);
+				model.insert(model.begin() + pos, search_index::fold(w));
+			} else if (what < 12) {
+				size_t pos = test::rand_below(model.size());
+				idx.erase(pos);
+				model.erase(model.begin() + pos);
+			} else if (what < 14) {
+				size_t pos = test::rand_below(model.size());
+				std::wstring w = random_word();
+				idx.set(pos, w);
+				model[pos] = search_index::fold(w);
+			} else if (what == 14 && test::rand_below(40) == 0) {
+				idx.clear();
+				model.clear();
+			} else {
+				check_queries(idx, model);
+			}
+			CHECK_EQ(idx.size(), model.size());
+		}
+		for (int q = 0; q < 50; ++q) check_queries(idx, model);
+	}
+}
+
+static void test_many_blocks() {
+	search_index idx;
+	std::vector<std::wstring> model;
+	for (size_t i = 0; i < 20000; ++i) { // enough for many blocks, with splits all over
+		std::wstring w = random_word() + std::to_wstring(i % 97);
+		size_t pos = test::rand_below(model.size() + 1);
+		idx.insert(pos, w);
+		model.insert(model.begin() + pos, search_index::fold(w));
+		if (i % 1000 == 0) check_queries(idx, model);
+	}
+	while (model.size() > 100) { // then empty most blocks
+		size_t pos = test::rand_below(model.size());
+		idx.erase(pos);
+		model.erase(model.begin() + pos);
+		if (model.size() % 1000 == 0) check_queries(idx, model);
+	}
+	for (int q = 0; q < 200; ++q) check_queries(idx, model);
+}
+
+int main(int argc, char** argv) {
+	test::rng(argc, argv);
+	test_basics();
+	test_random_operations();
+	test_many_blocks();
+	std::puts("search_index: OK");
+	return 0;
+}
@@ -0,0 +1,236 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+// Accuracy of str_decoder over a corpus of texts in several scripts, each one encoded
+// in every encoding it fits, with and without BOM; the detected encoding must be the
+// right one, and the decoded text must be the original. Then, fed in random chunks,
+// any data must decode to exactly the same of decoding it at once.
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "internals/str_decoder.h"
+#include "test.h"
+
+using wl::_wli::BYTE;
+using wl::_wli::encoding;
+using wl::_wli::encoding_info;
+using wl::_wli::str_decoder;
+using wl::_wli::str_transcode;
+using units = std::vector<uint32_t>; // UTF-16 units, whatever the size of wchar_t
+
+static const char* latinTexts[] = {
+	"The quick brown fox jumps over the lazy dog.",
+	"A\xC3\xA7\xC3\xA3o r\xC3\xA1pida, cora\xC3\xA7\xC3\xA3o \xC3\xA0 m\xC3\xA3o; n\xC3\xA3o \xC3\xA9 f\xC3\xA1""cil.",
+	"D\xC3\xA9j\xC3\xA0 vu: l'\xC3\xA9t\xC3\xA9 \xC3\xA0 No\xC3\xABl, o\xC3\xB9 est le caf\xC3\xA9?",
+	"Gr\xC3\xBC\xC3\x9F""e aus M\xC3\xBCnchen \xE2\x80\x93 Stra\xC3\x9F""e, \xC3\x84pfel, \xC3\x96l.",
+	"\xC2\xA1Se\xC3\xB1or! \xC2\xBF""D\xC3\xB3nde est\xC3\xA1 el ni\xC3\xB1o? \xC2\xABOl\xC3\xA9\xC2\xBB \xE2\x80\x94 50\xE2\x82\xAC",
+	"Sm\xC3\xB6rg\xC3\xA5sbord och bl\xC3\xA5""b\xC3\xA4r p\xC3\xA5 t\xC3\xA5get.",
+	"id;name;price\r\n1;\"caf\xC3\xA9\";3,50\r\n2;\"p\xC3\xA3o\";0,75\r\n",
+};
+
+static const char* otherTexts[] = {
+	"\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82, \xD0\xBA\xD0\xB0\xD0\xBA \xD0\xB4\xD0\xB5\xD0\xBB\xD0\xB0?",
+	"\xCE\x95\xCE\xBB\xCE\xBB\xCE\xB7\xCE\xBD\xCE\xB9\xCE\xBA\xCE\xAC \xCE\xB3\xCF\x81\xCE\xAC\xCE\xBC\xCE\xBC\xCE\xB1\xCF\x84\xCE\xB1",
+	"\xE4\xB8\xAD\xE6\x96\x87\xE6\xB5\x8B\xE8\xAF\x95\xEF\xBC\x8C\xE6\x95\xB0\xE6\x8D\xAE\xE5\xAF\xBC\xE5\x87\xBA\xE3\x80\x82",
+	"\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E\xE3\x81\xAE\xE3\x83\x86\xE3\x82\xAD\xE3\x82\xB9\xE3\x83\x88\xE3\x81\xA7\xE3\x81\x99\xE3\x80\x82",
+	"Emoji \xF0\x9F\x98\x80\xF0\x9F\x9A\x80 mixed with ASCII",
+};
+
+static units code_points(const std::string& utf8) {
+	units cps;
+	for (size_t i = 0; i < utf8.size(); ) {
+		uint32_t cp = 0;
+		size_t len = 0;
+		CHECK(str_transcode::decode_utf8_char(reinterpret_cast<const BYTE*>(&utf8[i]), utf8.size() - i, cp, len));
+		cps.push_back(cp);
+		i += len;
+	}
+	return cps;
+}
+
+static units to_utf16(const units& cps) {
+	units out;
+	for (uint32_t cp : cps) {
+		if (cp >= 0x10000) {
+			out.push_back(0xD800 + ((cp - 0x10000) >> 10));
+			out.push_back(0xDC00 + ((cp - 0x10000) & 0x3FF));
+		} else {
+			out.push_back(cp);
+		}
+	}
+	return out;
+}
+
+static bool to_win1252(const units& cps, std::vector<BYTE>& out) {
+	static const uint32_t high[] = {0x20AC, 0x2013, 0x2014}; // the ones used in the corpus
+	static const BYTE highBytes[] = {0x80, 0x96, 0x97};
+	for (uint32_t cp : cps) {
+		if (cp < 0x80 || (cp >= 0xA0 && cp <= 0xFF)) {
+			out.push_back(static_cast<BYTE>(cp));
+			continue;
+		}
+		size_t k = 0;
+		while (k < 3 && high[k] != cp) ++k;
+		if (k == 3) return false;
+		out.push_back(highBytes[k]);
+	}
+	return true;
+}
+
+static void put_units(std::vector<BYTE>& out, const units& u, size_t unitSize, bool bigEndian) {
+	for (uint32_t v : u) {
+		for (size_t k = 0; k < unitSize; ++k) {
+			out.push_back(static_cast<BYTE>(v >> (8 * (bigEndian ? unitSize - 1 - k : k))));
+		}
+	}
+}
+
+static units to_units(const std::wstring& s) {
+	units out(s.length());
+	for (size_t i = 0; i < s.length(); ++i) out[i] = static_cast<uint32_t>(s[i]);
+	return out;
+}
+
+// Decodes in chunks of random sizes, some of them tiny, so units are split.
+static std::wstring decode_chunked(const std::vector<BYTE>& data, str_decoder& dec) {
+	std::wstring out;
+	size_t i = 0;
+	while (i < data.size()) {
+		size_t len = std::min(data.size() - i, test::rand_below(3) ? test::rand_below(6) : test::rand_below(9000));
+		dec.decode(data.data() + i, len, out);
+		i += len;
+	}
+	dec.finish(out);
+	return out;
+}
+
+static std::wstring decode_whole(const std::vector<BYTE>& data, str_decoder& dec) {
+	std::wstring out;
+	dec.decode(data, out).finish(out);
+	return out;
+}
+
+static void test_corpus() {
+	struct scheme final { encoding enc; size_t unitSize; bool bigEndian; const BYTE* bom; size_t bomSize; };
+	static const BYTE bom8[] = {0xEF, 0xBB, 0xBF}, bom16be[] = {0xFE, 0xFF}, bom16le[] = {0xFF, 0xFE},
+		bom32be[] = {0x00, 0x00, 0xFE, 0xFF}, bom32le[] = {0xFF, 0xFE, 0x00, 0x00};
+	static const scheme schemes[] = {
+		{encoding::UTF8, 1, false, bom8, 3}, {encoding::UTF16BE, 2, true, bom16be, 2},
+		{encoding::UTF16LE, 2, false, bom16le, 2}, {encoding::UTF32BE, 4, true, bom32be, 4},
+		{encoding::UTF32LE, 4, false, bom32le, 4}, {encoding::WIN1252, 1, false, nullptr, 0},
+	};
+
+	size_t numDocs = 0, numRight = 0;
+	for (int round = 0; round < 1500; ++round) {
+		bool isLatin = test::rand_below(2) == 0;
+		std::string text;
+		if (test::rand_below(5) == 0) { // a long ASCII prefix, so non-ASCII text is found after the detection prefix
+			while (text.size() < 3000 + test::rand_below(6000)) text += "abc,def,123\n";
+		}
+		size_t len = std::vector<size_t>{10, 100, 1000, 5000, 20000}[test::rand_below(5)];
+		while (text.size() < len) {
+			text += isLatin ? latinTexts[test::rand_below(7)] : otherTexts[test::rand_below(5)];
+			text += " \n"[test::rand_below(2)];
+		}
+		units cps = code_points(text), expected = to_utf16(cps);
+		bool isAscii = std::all_of(cps.begin(), cps.end(), [](uint32_t cp) { return cp < 0x80; });
+
+		for (const scheme& sch : schemes) {
+			for (bool withBom : {false, true}) {
+				if (withBom && !sch.bom) continue;
+				std::vector<BYTE> data;
+				if (withBom) data.assign(sch.bom, sch.bom + sch.bomSize);
+				if (sch.enc == encoding::WIN1252) {
+					if (!to_win1252(cps, data)) continue;
+				} else {
+					put_units(data, sch.enc == encoding::UTF8 ? units{} : (sch.unitSize == 4 ? cps : expected),
+						sch.unitSize, sch.bigEndian);
+					if (sch.enc == encoding::UTF8) data.insert(data.end(), text.begin(), text.end());
+				}
+
+				encoding_info info = str_decoder::detect(data.data(), data.size());
+				str_decoder dec;
+				std::wstring out = decode_chunked(data, dec);
+				bool isSingleByte = sch.enc == encoding::UTF8 || sch.enc == encoding::WIN1252;
+				bool right = (info.encType == sch.enc && dec.get_encoding() == sch.enc) ||
+					(isAscii && isSingleByte && !withBom); // pure ASCII is any of them
+				CHECK_EQ(info.bomSize, withBom ? sch.bomSize : 0);
+				++numDocs;
+				numRight += right;
+
+				// Text of Latin scripts must always be right, and so must be anything with a BOM or in
+				// UTF-8; without a BOM, UTF-16 of other scripts has too few zero bytes to be told apart.
+				bool mustBeRight = withBom || isLatin || sch.enc == encoding::UTF8 || sch.unitSize == 4;
+				if (mustBeRight) CHECK(right);
+				if (right) CHECK(to_units(out) == expected);
+			}
+		}
+	}
+	std::printf("corpus: %zu of %zu documents detected right\n", numRight, numDocs);
+	CHECK(numRight * 100 >= numDocs * 90);
+}
+
+static void test_chunked_equals_whole() {
+	for (int round = 0; round < 3000; ++round) {
+		std::vector<BYTE> data(test::rand_below(3) ? test::rand_below(100) : test::rand_below(12000));
+		size_t mode = test::rand_below(4);
+		for (size_t i = 0; i < data.size(); ++i) {
+			switch (mode) {
+			case 0:  data[i] = static_cast<BYTE>(test::rand_below(256)); break; // noise
+			case 1:  data[i] = static_cast<BYTE>(i % 2 ? 0 : 0x20 + test::rand_below(0x5F)); break; // UTF-16LE-ish
+			case 2:  data[i] = static_cast<BYTE>(test::rand_below(8) ? 0x20 + test::rand_below(0x5F) : 0x80 + test::rand_below(0x80)); break;
+			default: data[i] = static_cast<BYTE>(test::rand_below(50) ? 0x20 + test::rand_below(0x5F) : test::rand_below(256));
+			}
+		}
+		if (test::rand_below(4) == 0 && data.size() >= 4) { // some BOM
+			static const BYTE boms[][4] = {{0xEF, 0xBB, 0xBF, 0x41}, {0xFF, 0xFE, 0x41, 0x00}, {0xFE, 0xFF, 0x00, 0x41}, {0xFF, 0xFE, 0x00, 0x00}};
+			const BYTE* bom = boms[test::rand_below(4)];
+			std::copy(bom, bom + 4, data.begin());
+		}
+		encoding forced = test::rand_below(3) ? encoding::UNKNOWN :
+			static_cast<encoding>(1 + test::rand_below(static_cast<size_t>(encoding::UTF32LE)));
+
+		str_decoder whole(forced), chunked(forced);
+		std::wstring expected = decode_whole(data, whole);
+		CHECK(decode_chunked(data, chunked) == expected);
+		CHECK(whole.get_encoding() == chunked.get_encoding());
+
+		chunked.reset(); // reusable after reset()
+		CHECK(decode_chunked(data, chunked) == expected);
+	}
+}
+
+static void test_errors() {
+	str_decoder dec(encoding::UTF8);
+	std::wstring out;
+	const BYTE cut[] = {0x41, 0x42, 0x43, 0xE2, 0x82}; // truncated euro sign
+	dec.decode(cut, 5, out);
+	CHECK(out == L"ABC"); // kept until the next chunk
+	dec.finish(out);
+	CHECK(to_units(out) == (units{0x41, 0x42, 0x43, 0xFFFD}));
+
+	const BYTE scsu[] = {0x0E, 0xFE, 0xFF, 0x41};
+	bool threw = false;
+	try {
+		str_decoder().decode(scsu, 4, out).finish(out);
+	} catch (const std::invalid_argument&) {
+		threw = true;
+	}
+	CHECK(threw);
+}
+
+int main(int argc, char** argv) {
+	test::rng(argc, argv);
+	test_corpus();
+	test_chunked_equals_whole();
+	test_errors();
+	std::puts("str_decoder: OK");
+	return 0;
+}
@@ -0,0 +1,312 @@
+/**
+ * Part of WinLamb - Win32 API Lambda Library
+ * https://github.com/rodrigocfd/winlamb
+ * Copyright 2017-present Rodrigo Cesar de Freitas Dias
+ * This library is released under the MIT License
+ */
+
+// Fuzz tests of str_transcode against straightforward reference conversions. Inputs
+// mix long ASCII runs, so the vector paths are taken, with valid and broken sequences,
+// and are converted at every alignment.
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "internals/str_transcode.h"
+#include "test.h"
+
+using wl::_wli::BYTE;
+using wl::_wli::str_transcode;
+using units = std::vector<uint32_t>; // UTF-16 units, whatever the size of wchar_t
+
+static void append_utf16(units& out, uint32_t cp) {
+	if (cp >= 0x10000) {
+		cp -= 0x10000;
+		out.push_back(0xD800 + (cp >> 10));
+		out.push_back(0xDC00 + (cp & 0x3FF));
+	} else {
+		out.push_back(cp);
+	}
+}
+
+static void append_utf8(std::vector<BYTE>& out, uint32_t cp) {
+	if (cp < 0x80) {
+		out.push_back(static_cast<BYTE>(cp));
+	} else if (cp < 0x800) {
+		out.push_back(static_cast<BYTE>(0xC0 | (cp >> 6)));
+		out.push_back(static_cast<BYTE>(0x80 | (cp & 0x3F)));
+	} else if (cp < 0x10000) {
+		out.push_back(static_cast<BYTE>(0xE0 | (cp >> 12)));
+		out.push_back(static_cast<BYTE>(0x80 | ((cp >> 6) & 0x3F)));
+		out.push_back(static_cast<BYTE>(0x80 | (cp & 0x3F)));
+	} else {
+		out.push_back(static_cast<BYTE>(0xF0 | (cp >> 18)));
+		out.push_back(static_cast<BYTE>(0x80 | ((cp >> 12) & 0x3F)));
+		out.push_back(static_cast<BYTE>(0x80 | ((cp >> 6) & 0x3F)));
+		out.push_back(static_cast<BYTE>(0x80 | (cp & 0x3F)));
+	}
+}
+
+// UTF-8 decoding by the well-formed byte sequences table of the Unicode standard
+// (table 3-7), replacing each maximal subpart of an ill-formed sequence by U+FFFD.
+static units ref_utf8_to_utf16(const std::vector<BYTE>& in) {
+	struct row final { BYTE first, last, lo1, hi1; int len; };
+	static const row table[] = {
+		{0x00, 0x7F, 0x00, 0x00, 1}, {0xC2, 0xDF, 0x80, 0xBF, 2},
+		{0xE0, 0xE0, 0xA0, 0xBF, 3}, {0xE1, 0xEC, 0x80, 0xBF, 3},
+		{0xED, 0xED, 0x80, 0x9F, 3}, {0xEE, 0xEF, 0x80, 0xBF, 3},
+		{0xF0, 0xF0, 0x90, 0xBF, 4}, {0xF1, 0xF3, 0x80, 0xBF, 4},
+		{0xF4, 0xF4, 0x80, 0x8F, 4},
+	};
+	units out;
+	size_t i = 0;
+	while (i < in.size()) {
+		const row* r = nullptr;
+		for (const row& t : table) {
+			if (in[i] >= t.first && in[i] <= t.last) r = &t;
+		}
+		if (!r) {
+			out.push_back(0xFFFD);
+			++i;
+			continue;
+		}
+		int good = 1; // bytes of the sequence which are well-formed so far
+		while (good < r->len && i + good < in.size()) {
+			BYTE c = in[i + good];
+			bool ok = (good == 1) ? (c >= r->lo1 && c <= r->hi1) : (c >= 0x80 && c <= 0xBF);
+			if (!ok) break;
+			++good;
+		}
+		if (good < r->len) {
+			out.push_back(0xFFFD);
+		} else {
+			uint32_t cp = r->len == 1 ? in[i] : in[i] & (0xFF >> (r->len + 1));
+			for (int k = 1; k < r->len; ++k) cp = (cp << 6) | (in[i + k] & 0x3F);
+			append_utf16(out, cp);
+		}
+		i += good;
+	}
+	return out;
+}
+
+// UTF-16 to UTF-8, with each lone surrogate as U+FFFD.
+static std::vector<BYTE> ref_utf16_to_utf8(const units& in) {
+	std::vector<BYTE> out;
+	for (size_t i = 0; i < in.size(); ++i) {
+		uint32_t u = in[i];
+		if (u >= 0xD800 && u <= 0xDBFF && i + 1 < in.size() && in[i + 1] >= 0xDC00 && in[i + 1] <= 0xDFFF) {
+			append_utf8(out, 0x10000 + ((u - 0xD800) << 10) + (in[++i] - 0xDC00));
+		} else {
+			append_utf8(out, (u >= 0xD800 && u <= 0xDFFF) ? 0xFFFD : u);
+		}
+	}
+	return out;
+}
+
+static uint32_t random_code_point() {
+	switch (test::rand_below(4)) {
+	case 0:  return static_cast<uint32_t>(0x80 + test::rand_below(0x800 - 0x80));
+	case 1:  return static_cast<uint32_t>(0x10000 + test::rand_below(0x110000 - 0x10000));
+	default: {
+		uint32_t cp = static_cast<uint32_t>(0x800 + test::rand_below(0x10000 - 0x800));
+		return (cp >= 0xD800 && cp <= 0xDFFF) ? 0x20AC : cp;
+	}
+	}
+}
+
+// Random bytes: ASCII runs long enough for the vector paths, valid sequences, and noise.
+static std::vector<BYTE> random_bytes(size_t len) {
+	std::vector<BYTE> out;
+	while (out.size() < len) {
+		switch (test::rand_below(8)) {
+		case 0: case 1: case 2: {
+			size_t run = test::rand_below(80);
+			for (size_t k = 0; k < run; ++k) out.push_back(static_cast<BYTE>(0x20 + test::rand_below(0x5F)));
+			break;
+		}
+		case 3: case 4: case 5:
+			append_utf8(out, random_code_point());
+			break;
+		case 6: { // a valid sequence cut short
+			std::vector<BYTE> seq;
+			append_utf8(seq, random_code_point());
+			out.insert(out.end(), seq.begin(), seq.begin() + 1 + test::rand_below(seq.size() - 1));
+			break;
+		}
+		default:
+			out.push_back(static_cast<BYTE>(test::rand_below(256)));
+		}
+	}
+	out.resize(len);
+	return out;
+}
+
+static units to_units(const wchar_t* p, size_t len) {
+	units out(len);
+	for (size_t i = 0; i < len; ++i) out[i] = static_cast<uint32_t>(p[i]);
+	return out;
+}
+
+static void test_unicode_example() {
+	// Example of U+FFFD substitution of maximal subparts, from the Unicode standard.
+	std::vector<BYTE> in = {0x61, 0xF1, 0x80, 0x80, 0xE1, 0x80, 0xC2, 0x62, 0x80, 0x63, 0x80, 0xBF, 0x64};
+	units expected = {0x61, 0xFFFD, 0xFFFD, 0xFFFD, 0x62, 0xFFFD, 0x63, 0xFFFD, 0xFFFD, 0x64};
+	std::vector<wchar_t> out(in.size());
+	size_t numErrors = 0;
+	size_t len = str_transcode::utf8_to_utf16(in.data(), in.size(), out.data(), &numErrors);
+	CHECK(to_units(out.data(), len) == expected);
+	CHECK_EQ(numErrors, 6u);
+	CHECK(ref_utf8_to_utf16(in) == expected);
+}
+
+static void test_utf8_to_utf16() {
+	std::vector<BYTE> buf;
+	std::vector<wchar_t> out;
+	for (int round = 0; round < 4000; ++round) {
+		std::vector<BYTE> in = random_bytes(test::rand_below(300));
+		units expected = ref_utf8_to_utf16(in);
+		for (size_t shift = 0; shift < 3; ++shift) { // unaligned source and destination
+			buf.assign(shift, 0);
+			buf.insert(buf.end(), in.begin(), in.end());
+			out.assign(in.size() + shift + 1, L'\0');
+			size_t len = str_transcode::utf8_to_utf16(buf.data() + shift, in.size(), out.data() + shift);
+			CHECK(len <= in.size());
+			CHECK(to_units(out.data() + shift, len) == expected);
+		}
+		CHECK_EQ(str_transcode::ascii_length(in.data(), in.size()),
+			static_cast<size_t>(std::find_if(in.begin(), in.end(), [](BYTE b) { return b >= 0x80; }) - in.begin()));
+	}
+}
+
+static void test_utf16_to_utf8() {
+	std::vector<wchar_t> in;
+	for (int round = 0; round < 4000; ++round) {
+		in.clear();
+		size_t len = test::rand_below(300);
+		while (in.size() < len) {
+			switch (test::rand_below(6)) {
+			case 0: case 1: case 2: {
+				size_t run = test::rand_below(60);
+				for (size_t k = 0; k < run; ++k) in.push_back(static_cast<wchar_t>(0x20 + test::rand_below(0x5F)));
+				break;
+			}
+			case 3: { // a pair, or a lone surrogate
+				units u;
+				append_utf16(u, static_cast<uint32_t>(0x10000 + test::rand_below(0x100000)));
+				for (uint32_t v : u) in.push_back(static_cast<wchar_t>(v));
+				if (test::rand_below(3) == 0) in.pop_back();
+				break;
+			}
+			default:
+				in.push_back(static_cast<wchar_t>(0x80 + test::rand_below(0x10000 - 0x80)));
+			}
+		}
+		std::vector<BYTE> expected = ref_utf16_to_utf8(to_units(in.data(), in.size()));
+		CHECK_EQ(str_transcode::utf8_length(in.data(), in.size()), expected.size());
+
+		std::vector<BYTE> out(expected.size() + 1, 0xAA);
+		size_t written = str_transcode::utf16_to_utf8(in.data(), in.size(), out.data());
+		CHECK_EQ(written, expected.size());
+		CHECK(std::equal(expected.begin(), expected.end(), out.begin()));
+		CHECK_EQ(out[written], 0xAA); // nothing written past the computed length
+	}
+}
+
+static void test_round_trip() {
+	for (int round = 0; round < 2000; ++round) {
+		std::vector<uint32_t> cps(test::rand_below(200));
+		std::vector<BYTE> utf8;
+		units utf16;
+		for (uint32_t& cp : cps) {
+			cp = test::rand_below(2) ? static_cast<uint32_t>(0x20 + test::rand_below(0x5F)) : random_code_point();
+			append_utf8(utf8, cp);
+			append_utf16(utf16, cp);
+		}
+		std::vector<wchar_t> wide(utf8.size());
+		size_t numErrors = 1;
+		size_t len = str_transcode::utf8_to_utf16(utf8.data(), utf8.size(), wide.data(), &numErrors);
+		CHECK(to_units(wide.data(), len) == utf16);
+		CHECK_EQ(numErrors, 0u);
+
+		std::vector<BYTE> back(str_transcode::utf8_length(wide.data(), len));
+		CHECK_EQ(str_transcode::utf16_to_utf8(wide.data(), len, back.data(), &numErrors), utf8.size());
+		CHECK(back == utf8);
+		CHECK_EQ(numErrors, 0u);
+	}
+}
+
+static void test_single_byte() {
+	std::vector<wchar_t> out, one(1);
+	for (int round = 0; round < 2000; ++round) {
+		std::vector<BYTE> in(test::rand_below(200));
+		for (BYTE& b : in) b = static_cast<BYTE>(test::rand_below(4) ? 0x20 + test::rand_below(0x5F) : test::rand_below(256));
+		out.assign(in.size() + 1, L'\0');
+
+		str_transcode::latin1_to_utf16(in.data(), in.size(), out.data());
+		for (size_t i = 0; i < in.size(); ++i) CHECK_EQ(static_cast<uint32_t>(out[i]), in[i]);
+
+		str_transcode::win1252_to_utf16(in.data(), in.size(), out.data());
+		for (size_t i = 0; i < in.size(); ++i) { // one at a time is always scalar
+			str_transcode::win1252_to_utf16(&in[i], 1, one.data());
+			CHECK_EQ(out[i], one[0]);
+		}
+	}
+
+	BYTE specials[] = {0x41, 0x80, 0x81, 0x8D, 0x99, 0x9F, 0xA0, 0xE9};
+	uint32_t expected[] = {0x41, 0x20AC, 0x81, 0x8D, 0x2122, 0x178, 0xA0, 0xE9};
+	wchar_t out8[8];
+	str_transcode::win1252_to_utf16(specials, 8, out8);
+	for (size_t i = 0; i < 8; ++i) CHECK_EQ(static_cast<uint32_t>(out8[i]), expected[i]);
+}
+
+static void test_wide() {
+	for (int round = 0; round < 2000; ++round) {
+		units u(test::rand_below(150));
+		for (uint32_t& v : u) v = static_cast<uint32_t>(test::rand_below(2) ? 0x20 + test::rand_below(0x5F) : test::rand_below(0x10000));
+		std::vector<BYTE> le, be;
+		for (uint32_t v : u) {
+			le.push_back(static_cast<BYTE>(v)); le.push_back(static_cast<BYTE>(v >> 8));
+			be.push_back(static_cast<BYTE>(v >> 8)); be.push_back(static_cast<BYTE>(v));
+		}
+		std::vector<wchar_t> out(u.size() + 1);
+		CHECK_EQ(str_transcode::utf16_to_utf16(le.data(), u.size(), false, out.data()), u.size());
+		CHECK(to_units(out.data(), u.size()) == u);
+		CHECK_EQ(str_transcode::utf16_to_utf16(be.data(), u.size(), true, out.data()), u.size());
+		CHECK(to_units(out.data(), u.size()) == u);
+
+		std::vector<uint32_t> cps(test::rand_below(100));
+		std::vector<BYTE> le32, be32;
+		units expected;
+		size_t expectedErrors = 0;
+		for (uint32_t& cp : cps) {
+			cp = test::rand_below(10) ? random_code_point() :
+				(test::rand_below(2) ? 0xD800 + static_cast<uint32_t>(test::rand_below(0x800)) : 0x110000 + static_cast<uint32_t>(test::rand_below(1000)));
+			bool invalid = cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF);
+			append_utf16(expected, invalid ? 0xFFFD : cp);
+			expectedErrors += invalid;
+			for (int k = 0; k < 4; ++k) {
+				le32.push_back(static_cast<BYTE>(cp >> (8 * k)));
+				be32.push_back(static_cast<BYTE>(cp >> (8 * (3 - k))));
+			}
+		}
+		out.assign(cps.size() * 2 + 1, L'\0');
+		size_t numErrors = 0;
+		size_t len = str_transcode::utf32_to_utf16(le32.data(), cps.size(), false, out.data(), &numErrors);
+		CHECK(to_units(out.data(), len) == expected);
+		CHECK_EQ(numErrors, expectedErrors);
+		len = str_transcode::utf32_to_utf16(be32.data(), cps.size(), true, out.data());
+		CHECK(to_units(out.data(), len) == expected);
+	}
+}
+
+int main(int argc, char** argv) {
+	test::rng(argc, argv);
+	test_unicode_example();
+	test_utf8_to_utf16();
+	test_utf16_to_utf8();
+	test_round_trip();
+	test_single_byte();
+	test_wide();
+	std::puts("str_transcode: OK");
+	return 0;
+}
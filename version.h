@@ -42,24 +42,21 @@ public:
 	}
 
 	std::wstring to_string(BYTE numDigits = 4) const {
-		std::wstring ret;
-		if (numDigits) {
-			ret.append(std::to_wstring(this->num[0]));
-			for (size_t i = 1; i < numDigits && i <= 4; ++i) {
-				ret.append(L".")
-					.append(std::to_wstring(this->num[i]));
-			}
+		str::builder ret; // on the stack, no allocations until the final string
+		for (size_t i = 0; i < numDigits && i < this->num.size(); ++i) {
+			if (i) ret.append(L'.');
+			ret.append_fmt(L"{}", this->num[i]);
 		}
-		return ret;
+		return ret.str();
 	}
 
 	bool parse(const std::wstring& text) {
-		std::vector<std::wstring> fields = str::split(text, L".");
-		for (size_t i = 0; i < fields.size() && i <= 4; ++i) {
-			if (!str::is_uint(fields[i])) {
+		size_t i = 0;
+		for (std::wstring_view field : str::split_view(text, L".")) {
+			if (i == this->num.size()) break;
+			if (!str::parse_int(field, this->num[i++])) { // validated and parsed at once
 				return false;
 			}
-			this->num[i] = std::stoi(fields[i]);
 		}
 		return true;
 	}
@@ -6,7 +6,7 @@
  */
 
 #pragma once
-#include "internals/base_loop.h"
+#include "internals/base_loop_pubm.h"
 #include "internals/base_msg_pubm.h"
 #include "internals/base_scroll.h"
 #include "internals/base_text_pubm.h"
@@ -17,16 +17,17 @@
 #include "wnd.h"
 
 namespace wl {
-namespace _wli { class dialog_modeless; } // friend forward declaration
+class dialog_modeless; // friend forward declaration
 
 // Inherit from this class to have an ordinary main window for your application.
 class window_main :
 	public wnd,
 	public _wli::base_msg_pubm<LRESULT>,
 	public _wli::base_thread_pubm<LRESULT, 0>,
+	public _wli::base_loop_pubm,
 	public _wli::base_text_pubm<window_main>
 {
-	friend _wli::dialog_modeless; // needs to access _baseLoop
+	friend dialog_modeless; // needs to access _baseLoop
 
 protected:
 	// Variables to be set by user, used only during window creation.
@@ -50,7 +51,8 @@ public:
 
 protected:
 	window_main() :
-		wnd(_hWnd), base_msg_pubm(_baseMsg), base_thread_pubm(_baseThread), base_text_pubm(_hWnd)
+		wnd(_hWnd), base_msg_pubm(_baseMsg), base_thread_pubm(_baseThread), base_loop_pubm(_baseLoop),
+		base_text_pubm(_hWnd)
 	{
 		this->_init_setup_styles();
 